@@ -3,12 +3,14 @@
 #include <sstream>
 #include <fstream>
 #include <algorithm>
+#include <cstring>
 #ifdef _WIN32
 #include <direct.h>
 #endif
 #include <sys/stat.h>
 #include "BlpConvert.h"
 #include "BlpConvertException.h"
+#include "DdsStructure.h"
 #include <cassert>
 
 #include <cuttlefish/Image.h>
@@ -58,6 +60,126 @@ namespace BLP
         }
     }
 
+    static inline u32 QuantizeBc1Endpoint(u32 red, u32 green, u32 blue)
+    {
+        const u32 r = (red * 31u + 127u) / 255u;
+        const u32 g = (green * 63u + 127u) / 255u;
+        const u32 b = (blue * 31u + 127u) / 255u;
+
+        return (r << 11u) | (g << 5u) | b;
+    }
+
+    static inline void ExpandBc1Endpoint(u32 color, i32 (&out)[3])
+    {
+        const u32 r = (color >> 11u) & 0x1Fu;
+        const u32 g = (color >> 5u) & 0x3Fu;
+        const u32 b = color & 0x1Fu;
+
+        out[0] = static_cast<i32>((r << 3u) | (r >> 2u));
+        out[1] = static_cast<i32>((g << 2u) | (g >> 4u));
+        out[2] = static_cast<i32>((b << 3u) | (b >> 2u));
+    }
+
+    // Range fit BC1 encoder for opaque BGRA8 pixels. The endpoints are the inset bounding box of the block, with
+    // the diagonal flipped per channel when it is anti-correlated with the widest channel, and every pixel is
+    // assigned by projecting it onto the quantized endpoint axis
+    static void EncodeBc1Block(const u8* pixels, u32 rowPitch, u8* outBlock)
+    {
+        i32 colors[16][3];
+        i32 minColor[3] = { 255, 255, 255 };
+        i32 maxColor[3] = { 0, 0, 0 };
+
+        for (u32 y = 0; y < 4; y++)
+        {
+            const u8* row = pixels + (y * rowPitch);
+
+            for (u32 x = 0; x < 4; x++)
+            {
+                i32* color = colors[y * 4 + x];
+                color[0] = row[x * 4 + 2];
+                color[1] = row[x * 4 + 1];
+                color[2] = row[x * 4 + 0];
+
+                for (u32 c = 0; c < 3; c++)
+                {
+                    minColor[c] = std::min(minColor[c], color[c]);
+                    maxColor[c] = std::max(maxColor[c], color[c]);
+                }
+            }
+        }
+
+        u32 referenceChannel = 0;
+        for (u32 c = 1; c < 3; c++)
+        {
+            if (maxColor[c] - minColor[c] > maxColor[referenceChannel] - minColor[referenceChannel])
+                referenceChannel = c;
+        }
+
+        i32 start[3];
+        i32 end[3];
+        for (u32 c = 0; c < 3; c++)
+        {
+            const i32 inset = (maxColor[c] - minColor[c]) >> 4;
+            start[c] = minColor[c] + inset;
+            end[c] = maxColor[c] - inset;
+        }
+
+        // Blend weights are mostly exclusive, so flip the channels that decrease while the reference channel increases
+        const i32 referenceCenter = minColor[referenceChannel] + maxColor[referenceChannel];
+        for (u32 c = 0; c < 3; c++)
+        {
+            if (c == referenceChannel)
+                continue;
+
+            const i32 center = minColor[c] + maxColor[c];
+
+            i32 covariance = 0;
+            for (u32 i = 0; i < 16; i++)
+            {
+                covariance += ((colors[i][referenceChannel] * 2) - referenceCenter) * ((colors[i][c] * 2) - center);
+            }
+
+            if (covariance < 0)
+                std::swap(start[c], end[c]);
+        }
+
+        u32 color0 = QuantizeBc1Endpoint(end[0], end[1], end[2]);
+        u32 color1 = QuantizeBc1Endpoint(start[0], start[1], start[2]);
+
+        u32 indices = 0;
+        if (color0 != color1)
+        {
+            // color0 must be the larger value to select the four color mode
+            if (color0 < color1)
+                std::swap(color0, color1);
+
+            i32 endpoint0[3];
+            i32 endpoint1[3];
+            ExpandBc1Endpoint(color0, endpoint0);
+            ExpandBc1Endpoint(color1, endpoint1);
+
+            const i32 axis[3] = { endpoint0[0] - endpoint1[0], endpoint0[1] - endpoint1[1], endpoint0[2] - endpoint1[2] };
+            const i32 axisLengthSquared = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+
+            // Maps the projected step (0 = color1, 3 = color0) to the BC1 palette index
+            static constexpr u32 stepToIndex[4] = { 1, 3, 2, 0 };
+
+            for (u32 i = 0; i < 16; i++)
+            {
+                const i32 dot = (colors[i][0] - endpoint1[0]) * axis[0] + (colors[i][1] - endpoint1[1]) * axis[1] + (colors[i][2] - endpoint1[2]) * axis[2];
+                const i32 step = std::clamp((dot * 6 + axisLengthSquared) / (axisLengthSquared * 2), 0, 3);
+
+                indices |= stepToIndex[step] << (i * 2u);
+            }
+        }
+
+        outBlock[0] = static_cast<u8>(color0 & 0xFF);
+        outBlock[1] = static_cast<u8>(color0 >> 8);
+        outBlock[2] = static_cast<u8>(color1 & 0xFF);
+        outBlock[3] = static_cast<u8>(color1 >> 8);
+        memcpy(&outBlock[4], &indices, sizeof(u32));
+    }
+
     namespace _detail
     {
         static const uint32_t alphaLookup1[] = { 0x00, 0xFF };
@@ -370,6 +492,71 @@ namespace BLP
         return true;
     }
 
+    bool BlpConvert::ConvertRawToBC1Buffer(uint32_t width, uint32_t height, uint32_t layers, const unsigned char* inputBytes, std::size_t size, std::vector<u8>& outBuffer)
+    {
+        outBuffer.clear();
+        if (!inputBytes || width == 0 || height == 0 || layers == 0 || (width % 4) != 0 || (height % 4) != 0)
+            return false;
+
+        const std::size_t inputSize = static_cast<std::size_t>(width) * height * layers * sizeof(uint32_t);
+        if (size < inputSize)
+            return false;
+
+        const uint32_t numBlocksX = width / 4;
+        const uint32_t numBlocksY = height / 4;
+        const std::size_t layerSize = static_cast<std::size_t>(numBlocksX) * numBlocksY * 8;
+        const bool isVolume = layers != 1;
+
+        DdsHeader header = { };
+        header.size = sizeof(DdsHeader);
+        header.flags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT | DDSD_LINEARSIZE | (isVolume ? DDSD_DEPTH : 0);
+        header.height = height;
+        header.width = width;
+        header.pitchOrLinearSize = numBlocksX * 8;
+        header.depth = isVolume ? layers : 0;
+        header.mipMapCount = 1;
+        header.pixelFormat.size = sizeof(DdsPixelFormat);
+        header.pixelFormat.flags = DDPF_FOURCC;
+        header.pixelFormat.fourCC = DDS_FOURCC_DX10;
+        header.caps = DDSCAPS_TEXTURE;
+        header.caps2 = isVolume ? DDSCAPS2_VOLUME : 0;
+
+        DdsHeaderDX10 headerDX10 = { };
+        headerDX10.dxgiFormat = DXGI_FORMAT_BC1_UNORM;
+        headerDX10.resourceDimension = isVolume ? DDS_DIMENSION_TEXTURE3D : DDS_DIMENSION_TEXTURE2D;
+        headerDX10.arraySize = 1;
+
+        const std::size_t headerSize = sizeof(DDS_MAGIC) + sizeof(DdsHeader) + sizeof(DdsHeaderDX10);
+        outBuffer.resize(headerSize + (layerSize * layers));
+
+        u8* dst = outBuffer.data();
+        memcpy(dst, &DDS_MAGIC, sizeof(DDS_MAGIC));
+        dst += sizeof(DDS_MAGIC);
+        memcpy(dst, &header, sizeof(DdsHeader));
+        dst += sizeof(DdsHeader);
+        memcpy(dst, &headerDX10, sizeof(DdsHeaderDX10));
+        dst += sizeof(DdsHeaderDX10);
+
+        const uint32_t rowPitch = width * sizeof(uint32_t);
+        for (uint32_t layer = 0; layer < layers; layer++)
+        {
+            const unsigned char* layerPixels = inputBytes + (static_cast<std::size_t>(layer) * height * rowPitch);
+
+            for (uint32_t blockY = 0; blockY < numBlocksY; blockY++)
+            {
+                for (uint32_t blockX = 0; blockX < numBlocksX; blockX++)
+                {
+                    const unsigned char* blockPixels = layerPixels + (blockY * 4 * rowPitch) + (blockX * 4 * sizeof(uint32_t));
+
+                    EncodeBc1Block(blockPixels, rowPitch, dst);
+                    dst += 8;
+                }
+            }
+        }
+
+        return true;
+    }
+
     void BlpConvert::LoadFirstLayer(const BlpHeader& header, ByteStream& data, std::vector<uint32_t>& imageData) const
     {
         Format format = GetFormat(header);
@@ -70,6 +70,9 @@ namespace BLP
         void ConvertRaw(uint32_t width, uint32_t height, uint32_t layers, unsigned char* inputBytes, std::size_t size, InputFormat inputFormat, Format outputFormat, const std::string& outputPath, bool generateMipmaps);
         bool ConvertRawToBuffer(uint32_t width, uint32_t height, uint32_t layers, unsigned char* inputBytes, std::size_t size, InputFormat inputFormat, Format outputFormat, std::vector<u8>& outBuffer, bool generateMipmaps);
 
+        // Encodes opaque BGRA8 layers straight into a BC1 DDS without going through cuttlefish, used for terrain blend maps
+        bool ConvertRawToBC1Buffer(uint32_t width, uint32_t height, uint32_t layers, const unsigned char* inputBytes, std::size_t size, std::vector<u8>& outBuffer);
+
     private:
         void LoadFirstLayer(const BlpHeader& header, ByteStream& data, std::vector<uint32_t>& imageData) const;
 
@@ -0,0 +1,269 @@
+#include "DdsLayout.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace BLP
+{
+    static bool GetDXGIFormatSize(u32 dxgiFormat, u32& blockSize, u32& bytesPerPixel)
+    {
+        switch (dxgiFormat)
+        {
+            case DXGI_FORMAT_BC1_UNORM:
+            case DXGI_FORMAT_BC1_UNORM_SRGB:
+            case DXGI_FORMAT_BC4_UNORM:
+            case DXGI_FORMAT_BC4_SNORM:
+                blockSize = 8;
+                return true;
+
+            case DXGI_FORMAT_BC2_UNORM:
+            case DXGI_FORMAT_BC2_UNORM_SRGB:
+            case DXGI_FORMAT_BC3_UNORM:
+            case DXGI_FORMAT_BC3_UNORM_SRGB:
+            case DXGI_FORMAT_BC5_UNORM:
+            case DXGI_FORMAT_BC5_SNORM:
+            case DXGI_FORMAT_BC7_UNORM:
+            case DXGI_FORMAT_BC7_UNORM_SRGB:
+                blockSize = 16;
+                return true;
+
+            case DXGI_FORMAT_R8G8B8A8_UNORM:
+            case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+            case DXGI_FORMAT_B8G8R8A8_UNORM:
+            case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+                bytesPerPixel = 4;
+                return true;
+
+            default:
+                return false;
+        }
+    }
+
+    static bool GetFourCCSize(u32 fourCC, u32& blockSize)
+    {
+        switch (fourCC)
+        {
+            case DDS_FOURCC_DXT1:
+                blockSize = 8;
+                return true;
+
+            case DDS_FOURCC_DXT3:
+            case DDS_FOURCC_DXT5:
+            case DDS_FOURCC_ATI2:
+            case DDS_FOURCC_BC5U:
+                blockSize = 16;
+                return true;
+
+            default:
+                return false;
+        }
+    }
+
+    bool DdsLayout::Parse(const u8* data, std::size_t size)
+    {
+        mips.clear();
+        hasHeaderDX10 = false;
+        blockSize = 0;
+        bytesPerPixel = 0;
+
+        if (!data || size < sizeof(DDS_MAGIC) + sizeof(DdsHeader))
+            return false;
+
+        u32 magic = 0;
+        memcpy(&magic, data, sizeof(u32));
+        if (magic != DDS_MAGIC)
+            return false;
+
+        memcpy(&header, data + sizeof(DDS_MAGIC), sizeof(DdsHeader));
+        if (header.size != sizeof(DdsHeader) || header.width == 0 || header.height == 0)
+            return false;
+
+        // Only plain 2D textures can be split into mip ranges
+        if ((header.caps2 & (DDSCAPS2_CUBEMAP | DDSCAPS2_VOLUME)) != 0)
+            return false;
+
+        std::size_t dataOffset = sizeof(DDS_MAGIC) + sizeof(DdsHeader);
+
+        if ((header.pixelFormat.flags & DDPF_FOURCC) != 0 && header.pixelFormat.fourCC == DDS_FOURCC_DX10)
+        {
+            if (size < dataOffset + sizeof(DdsHeaderDX10))
+                return false;
+
+            memcpy(&headerDX10, data + dataOffset, sizeof(DdsHeaderDX10));
+            dataOffset += sizeof(DdsHeaderDX10);
+            hasHeaderDX10 = true;
+
+            if (headerDX10.resourceDimension != DDS_DIMENSION_TEXTURE2D || headerDX10.arraySize > 1)
+                return false;
+
+            if (!GetDXGIFormatSize(headerDX10.dxgiFormat, blockSize, bytesPerPixel))
+                return false;
+        }
+        else if ((header.pixelFormat.flags & DDPF_FOURCC) != 0)
+        {
+            if (!GetFourCCSize(header.pixelFormat.fourCC, blockSize))
+                return false;
+        }
+        else if ((header.pixelFormat.flags & DDPF_RGB) != 0 && (header.pixelFormat.rgbBitCount % 8) == 0 && header.pixelFormat.rgbBitCount > 0)
+        {
+            bytesPerPixel = header.pixelFormat.rgbBitCount / 8;
+        }
+        else
+        {
+            return false;
+        }
+
+        const u32 numMips = std::max(1u, (header.flags & DDSD_MIPMAPCOUNT) ? header.mipMapCount : 1u);
+        mips.reserve(numMips);
+
+        u32 width = header.width;
+        u32 height = header.height;
+
+        for (u32 i = 0; i < numMips; i++)
+        {
+            std::size_t mipSize = 0;
+            if (blockSize > 0)
+            {
+                mipSize = static_cast<std::size_t>(std::max(1u, (width + 3) / 4)) * std::max(1u, (height + 3) / 4) * blockSize;
+            }
+            else
+            {
+                mipSize = static_cast<std::size_t>(width) * height * bytesPerPixel;
+            }
+
+            if (dataOffset + mipSize > size)
+            {
+                mips.clear();
+                return false;
+            }
+
+            DdsMipLevel& mip = mips.emplace_back();
+            mip.width = width;
+            mip.height = height;
+            mip.dataOffset = static_cast<u32>(dataOffset);
+            mip.dataSize = static_cast<u32>(mipSize);
+
+            dataOffset += mipSize;
+            width = std::max(1u, width / 2);
+            height = std::max(1u, height / 2);
+        }
+
+        return true;
+    }
+
+    bool DdsLayout::WriteMipRange(const u8* data, u32 firstMip, u32 numMips, std::vector<u8>& outBuffer) const
+    {
+        outBuffer.clear();
+        if (!data || numMips == 0 || firstMip + numMips > mips.size())
+            return false;
+
+        const DdsMipLevel& baseMip = mips[firstMip];
+
+        DdsHeader rangeHeader = header;
+        rangeHeader.width = baseMip.width;
+        rangeHeader.height = baseMip.height;
+        rangeHeader.mipMapCount = numMips;
+        rangeHeader.flags |= DDSD_MIPMAPCOUNT;
+        rangeHeader.caps |= DDSCAPS_TEXTURE;
+
+        if (numMips > 1)
+        {
+            rangeHeader.caps |= DDSCAPS_COMPLEX | DDSCAPS_MIPMAP;
+        }
+        else
+        {
+            rangeHeader.caps &= ~(DDSCAPS_COMPLEX | DDSCAPS_MIPMAP);
+        }
+
+        if (blockSize > 0)
+        {
+            rangeHeader.flags = (rangeHeader.flags & ~DDSD_PITCH) | DDSD_LINEARSIZE;
+            rangeHeader.pitchOrLinearSize = baseMip.dataSize;
+        }
+        else
+        {
+            rangeHeader.flags = (rangeHeader.flags & ~DDSD_LINEARSIZE) | DDSD_PITCH;
+            rangeHeader.pitchOrLinearSize = baseMip.width * bytesPerPixel;
+        }
+
+        std::size_t dataSize = 0;
+        for (u32 i = firstMip; i < firstMip + numMips; i++)
+        {
+            dataSize += mips[i].dataSize;
+        }
+
+        const std::size_t headerSize = sizeof(DDS_MAGIC) + sizeof(DdsHeader) + (hasHeaderDX10 ? sizeof(DdsHeaderDX10) : 0);
+        outBuffer.resize(headerSize + dataSize);
+
+        u8* dst = outBuffer.data();
+        memcpy(dst, &DDS_MAGIC, sizeof(DDS_MAGIC));
+        dst += sizeof(DDS_MAGIC);
+        memcpy(dst, &rangeHeader, sizeof(DdsHeader));
+        dst += sizeof(DdsHeader);
+
+        if (hasHeaderDX10)
+        {
+            memcpy(dst, &headerDX10, sizeof(DdsHeaderDX10));
+            dst += sizeof(DdsHeaderDX10);
+        }
+
+        // Mips are stored consecutively, so the range is a single copy
+        memcpy(dst, data + baseMip.dataOffset, dataSize);
+
+        return true;
+    }
+
+    bool DdsLayout::WriteMipStream(const u8* data, u32 numMips, std::vector<u8>& outBuffer) const
+    {
+        outBuffer.clear();
+        if (!data || numMips == 0 || numMips >= mips.size())
+            return false;
+
+        const std::size_t tableSize = sizeof(DdsMipStreamHeader) + (sizeof(DdsMipStreamLevel) * numMips);
+
+        std::size_t dataSize = 0;
+        for (u32 i = 0; i < numMips; i++)
+        {
+            dataSize += mips[i].dataSize;
+        }
+
+        outBuffer.resize(tableSize + dataSize);
+
+        DdsMipStreamHeader streamHeader = { };
+        streamHeader.signature = DDS_MIP_STREAM_SIGNATURE;
+        streamHeader.version = DDS_MIP_STREAM_VERSION;
+        streamHeader.numMips = numMips;
+        streamHeader.tailWidth = mips[numMips].width;
+        streamHeader.tailHeight = mips[numMips].height;
+        memcpy(outBuffer.data(), &streamHeader, sizeof(DdsMipStreamHeader));
+
+        u32 dataOffset = static_cast<u32>(tableSize);
+        for (u32 i = 0; i < numMips; i++)
+        {
+            DdsMipStreamLevel level = { };
+            level.width = mips[i].width;
+            level.height = mips[i].height;
+            level.dataOffset = dataOffset;
+            level.dataSize = mips[i].dataSize;
+
+            memcpy(outBuffer.data() + sizeof(DdsMipStreamHeader) + (sizeof(DdsMipStreamLevel) * i), &level, sizeof(DdsMipStreamLevel));
+            dataOffset += level.dataSize;
+        }
+
+        // The high resolution mips are the first ones in the DDS, so they are a single consecutive range
+        memcpy(outBuffer.data() + tableSize, data + mips[0].dataOffset, dataSize);
+
+        return true;
+    }
+
+    u32 DdsLayout::GetFirstMipWithinSize(u32 maxSize) const
+    {
+        for (u32 i = 0; i < mips.size(); i++)
+        {
+            if (std::max(mips[i].width, mips[i].height) <= maxSize)
+                return i;
+        }
+
+        return mips.empty() ? 0 : static_cast<u32>(mips.size()) - 1;
+    }
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include "DdsStructure.h"
+
+#include <Base/Types.h>
+
+#include <cstdlib>
+#include <vector>
+
+namespace BLP
+{
+    struct DdsMipLevel
+    {
+        u32 width = 0;
+        u32 height = 0;
+        u32 dataOffset = 0;
+        u32 dataSize = 0;
+    };
+
+    // Describes where every mip of a single 2D DDS texture lives inside its file
+    struct DdsLayout
+    {
+    public:
+        bool Parse(const u8* data, std::size_t size);
+
+        // Writes a standalone DDS containing the mips [firstMip, firstMip + numMips) of the parsed file
+        bool WriteMipRange(const u8* data, u32 firstMip, u32 numMips, std::vector<u8>& outBuffer) const;
+
+        // Writes the mips [0, numMips) as a mip stream sidecar, the remaining mips are expected to be written with WriteMipRange
+        bool WriteMipStream(const u8* data, u32 numMips, std::vector<u8>& outBuffer) const;
+
+        // Returns the first mip whose largest dimension is smaller than or equal to maxSize, or the last mip if none are
+        u32 GetFirstMipWithinSize(u32 maxSize) const;
+
+    public:
+        DdsHeader header = { };
+        DdsHeaderDX10 headerDX10 = { };
+        bool hasHeaderDX10 = false;
+
+        u32 blockSize = 0; // Bytes per 4x4 block, 0 for uncompressed formats
+        u32 bytesPerPixel = 0;
+
+        std::vector<DdsMipLevel> mips;
+    };
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace BLP
+{
+    static constexpr uint32_t DDS_MAGIC = 0x20534444; // "DDS "
+    static constexpr uint32_t DDS_FOURCC_DX10 = 0x30315844; // "DX10"
+    static constexpr uint32_t DDS_FOURCC_DXT1 = 0x31545844; // "DXT1"
+    static constexpr uint32_t DDS_FOURCC_DXT3 = 0x33545844; // "DXT3"
+    static constexpr uint32_t DDS_FOURCC_DXT5 = 0x35545844; // "DXT5"
+    static constexpr uint32_t DDS_FOURCC_ATI2 = 0x32495441; // "ATI2"
+    static constexpr uint32_t DDS_FOURCC_BC5U = 0x55354342; // "BC5U"
+
+    static constexpr uint32_t DDSD_CAPS = 0x1;
+    static constexpr uint32_t DDSD_HEIGHT = 0x2;
+    static constexpr uint32_t DDSD_WIDTH = 0x4;
+    static constexpr uint32_t DDSD_PITCH = 0x8;
+    static constexpr uint32_t DDSD_PIXELFORMAT = 0x1000;
+    static constexpr uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+    static constexpr uint32_t DDSD_LINEARSIZE = 0x80000;
+    static constexpr uint32_t DDSD_DEPTH = 0x800000;
+
+    static constexpr uint32_t DDPF_FOURCC = 0x4;
+
+    static constexpr uint32_t DDSCAPS_COMPLEX = 0x8;
+    static constexpr uint32_t DDSCAPS_TEXTURE = 0x1000;
+    static constexpr uint32_t DDSCAPS_MIPMAP = 0x400000;
+    static constexpr uint32_t DDSCAPS2_CUBEMAP = 0x200;
+    static constexpr uint32_t DDSCAPS2_VOLUME = 0x200000;
+
+    static constexpr uint32_t DDPF_RGB = 0x40;
+
+    static constexpr uint32_t DXGI_FORMAT_R8G8B8A8_UNORM = 28;
+    static constexpr uint32_t DXGI_FORMAT_R8G8B8A8_UNORM_SRGB = 29;
+    static constexpr uint32_t DXGI_FORMAT_BC1_UNORM = 71;
+    static constexpr uint32_t DXGI_FORMAT_BC1_UNORM_SRGB = 72;
+    static constexpr uint32_t DXGI_FORMAT_BC2_UNORM = 74;
+    static constexpr uint32_t DXGI_FORMAT_BC2_UNORM_SRGB = 75;
+    static constexpr uint32_t DXGI_FORMAT_BC3_UNORM = 77;
+    static constexpr uint32_t DXGI_FORMAT_BC3_UNORM_SRGB = 78;
+    static constexpr uint32_t DXGI_FORMAT_BC4_UNORM = 80;
+    static constexpr uint32_t DXGI_FORMAT_BC4_SNORM = 81;
+    static constexpr uint32_t DXGI_FORMAT_BC5_UNORM = 83;
+    static constexpr uint32_t DXGI_FORMAT_BC5_SNORM = 84;
+    static constexpr uint32_t DXGI_FORMAT_B8G8R8A8_UNORM = 87;
+    static constexpr uint32_t DXGI_FORMAT_B8G8R8A8_UNORM_SRGB = 91;
+    static constexpr uint32_t DXGI_FORMAT_BC7_UNORM = 98;
+    static constexpr uint32_t DXGI_FORMAT_BC7_UNORM_SRGB = 99;
+
+    static constexpr uint32_t DDS_DIMENSION_TEXTURE2D = 3;
+    static constexpr uint32_t DDS_DIMENSION_TEXTURE3D = 4;
+
+#pragma pack(push, 1)
+    struct DdsPixelFormat
+    {
+        uint32_t size;
+        uint32_t flags;
+        uint32_t fourCC;
+        uint32_t rgbBitCount;
+        uint32_t rBitMask;
+        uint32_t gBitMask;
+        uint32_t bBitMask;
+        uint32_t aBitMask;
+    };
+
+    struct DdsHeader
+    {
+        uint32_t size;
+        uint32_t flags;
+        uint32_t height;
+        uint32_t width;
+        uint32_t pitchOrLinearSize;
+        uint32_t depth;
+        uint32_t mipMapCount;
+        uint32_t reserved1[11];
+        DdsPixelFormat pixelFormat;
+        uint32_t caps;
+        uint32_t caps2;
+        uint32_t caps3;
+        uint32_t caps4;
+        uint32_t reserved2;
+    };
+
+    struct DdsHeaderDX10
+    {
+        uint32_t dxgiFormat;
+        uint32_t resourceDimension;
+        uint32_t miscFlag;
+        uint32_t arraySize;
+        uint32_t miscFlags2;
+    };
+#pragma pack(pop)
+
+    // Sidecar holding the high resolution mips of a texture whose DDS only contains the mip tail.
+    // The header is followed by numMips DdsMipStreamLevel entries (largest first) and then the mip data
+    static constexpr uint32_t DDS_MIP_STREAM_SIGNATURE = 0x50494D4E; // "NMIP"
+    static constexpr uint32_t DDS_MIP_STREAM_VERSION = 1;
+
+#pragma pack(push, 1)
+    struct DdsMipStreamHeader
+    {
+        uint32_t signature;
+        uint32_t version;
+        uint32_t numMips;
+        uint32_t tailWidth; // Size of the first mip stored in the DDS
+        uint32_t tailHeight;
+    };
+
+    struct DdsMipStreamLevel
+    {
+        uint32_t width;
+        uint32_t height;
+        uint32_t dataOffset; // From the start of the sidecar
+        uint32_t dataSize;
+    };
+#pragma pack(pop)
+
+    static_assert(sizeof(DdsHeader) == 124, "DdsHeader must match the DDS file layout");
+    static_assert(sizeof(DdsHeaderDX10) == 20, "DdsHeaderDX10 must match the DDS file layout");
+}
@@ -26,6 +26,11 @@ bool CascListFile::Initialize()
     return true;
 }
 
+bool CascListFile::IsM2Path(const std::string& filePath)
+{
+    return StringUtils::EndsWith(filePath, ".m2") || StringUtils::EndsWith(filePath, ".mdx") || StringUtils::EndsWith(filePath, ".mdl");
+}
+
 void CascListFile::ParseListFile()
 {
     char* buffer = reinterpret_cast<char*>(_fileBuffer->GetDataPointer());
@@ -96,7 +101,7 @@ void CascListFile::ParseListFile()
         _fileIDToPath[fileID] = filePath;
         _filePathToID[filePath] = fileID;
 
-        if (StringUtils::EndsWith(filePath, ".m2") || StringUtils::EndsWith(filePath, ".mdx"))
+        if (IsM2Path(filePath))
         {
             _m2Files.push_back(fileID);
         }
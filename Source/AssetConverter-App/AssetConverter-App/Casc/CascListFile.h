@@ -19,6 +19,9 @@ public:
     bool HasFileWithPath(const std::string& filePath) const { return _filePathToID.find(filePath) != _filePathToID.end(); }
     u32 GetFileIDFromPath(const std::string& filePath) const { return _filePathToID.at(filePath); }
 
+    // M2s are also listed under the legacy .mdx and .mdl extensions the client normalizes to .m2
+    static bool IsM2Path(const std::string& filePath);
+
     const std::vector<u32>& GetM2FileIDs() const { return _m2Files; }
     const std::vector<u32>& GetWMOFileIDs() const { return _wmoFiles; }
     const std::vector<u32>& GetBLPFileIDs() const { return _blpFiles; }
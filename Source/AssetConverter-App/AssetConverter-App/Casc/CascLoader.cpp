@@ -145,6 +145,21 @@ bool CascLoader::FileExistsInCasc(u32 fileID)
     return true;
 }
 
+bool CascLoader::GetFileContentKeyByID(u32 fileID, std::array<u8, MD5_HASH_SIZE>& contentKey)
+{
+    void* fileHandle = nullptr;
+    if (!CascOpenFile(_storageHandle, CASC_FILE_DATA_ID(fileID), 0xFFFFFFFF, CASC_OPEN_BY_FILEID | CASC_OVERCOME_ENCRYPTED, &fileHandle))
+        return false;
+
+    // Empty files have no content to convert or share
+    DWORD fileSize = CascGetFileSize(fileHandle, nullptr);
+    bool result = fileSize != CASC_INVALID_SIZE && fileSize != 0 &&
+                  CascGetFileInfo(fileHandle, CascFileContentKey, contentKey.data(), contentKey.size(), nullptr);
+    CascCloseFile(fileHandle);
+
+    return result;
+}
+
 static LPCSTR GetProgressMessageAsText(CASC_PROGRESS_MSG Message)
 {
     switch (Message)
@@ -6,6 +6,8 @@
 
 #include <Casc/CascLib.h>
 
+#include <array>
+
 class CascLoader
 {
 public:
@@ -30,6 +32,7 @@ public:
     std::shared_ptr<Bytebuffer> GetFileByPath(const std::string& filePath);
     std::shared_ptr<Bytebuffer> GetFileByListFilePath(const std::string& filePath);
     bool FileExistsInCasc(u32 fileID);
+    bool GetFileContentKeyByID(u32 fileID, std::array<u8, MD5_HASH_SIZE>& contentKey);
     bool ListFileContainsID(u32 fileID) { return _listFile.HasFileWithID(fileID); }
     bool InCascAndListFile(u32 fileID) { return FileExistsInCasc(fileID) && ListFileContainsID(fileID); }
 
@@ -69,6 +69,9 @@ ClientDB::Data ClientDBExtractor::lightSkyboxStorage;
 robin_hood::unordered_map<u32, std::vector<u32>> ClientDBExtractor::modelResourcesIDToModelFileDataEntry;
 robin_hood::unordered_map<u32, std::vector<u32>> ClientDBExtractor::materialResourcesIDToTextureFileDataEntry;
 
+robin_hood::unordered_set<u32> ClientDBExtractor::referencedModelFileIDs;
+robin_hood::unordered_set<u32> ClientDBExtractor::referencedTextureFileIDs;
+
 void ClientDBExtractor::Process()
 {
     for (u32 i = 0; i < _extractionEntries.size(); i++)
@@ -210,6 +213,7 @@ bool ClientDBExtractor::ExtractModelFileData(const std::string& name)
         {
             const std::string& fileStr = cascLoader->GetFilePathFromListFileID(modelFileID);
             filePath = fs::path("model") / fs::path(fileStr).replace_extension(Model::FILE_EXTENSION);
+            referencedModelFileIDs.insert(modelFileID);
         }
 
         modelFileData.model = modelFileDataStorage.AddString(filePath.generic_string());
@@ -275,6 +279,7 @@ bool ClientDBExtractor::ExtractTextureFileData(const std::string& name)
         {
             const std::string& fileStr = cascLoader->GetFilePathFromListFileID(textureFileID);
             filePath = fs::path("texture") / fs::path(fileStr).replace_extension("dds");
+            referencedTextureFileIDs.insert(textureFileID);
         }
 
         textureFileData.texture = textureFileDataStorage.AddString(filePath.generic_string());
@@ -625,6 +630,7 @@ bool ClientDBExtractor::ExtractCinematicCamera(const std::string& name)
         {
             const std::string& fileStr = cascLoader->GetFilePathFromListFileID(fileID);
             filePath = fs::path("model") / fs::path(fileStr).replace_extension(Model::FILE_EXTENSION);
+            referencedModelFileIDs.insert(fileID);
         }
         cinematicCamera.model = cinematicCameraStorage.AddString(filePath.generic_string());
 
@@ -803,6 +809,7 @@ bool ClientDBExtractor::ExtractCreatureModelData(const std::string& name)
         {
             const std::string& fileStr = cascLoader->GetFilePathFromListFileID(fileID);
             filePath = fs::path("model") / fs::path(fileStr).replace_extension(Model::FILE_EXTENSION);
+            referencedModelFileIDs.insert(fileID);
         }
 
         creatureModelData.model = creatureModelDataStorage.AddString(filePath.generic_string());
@@ -880,6 +887,7 @@ bool ClientDBExtractor::ExtractCreatureDisplayInfo(const std::string& name)
             {
                 const std::string& fileStr = cascLoader->GetFilePathFromListFileID(textureFileID);
                 filePath = fs::path("texture") / fs::path(fileStr).replace_extension("dds");
+                referencedTextureFileIDs.insert(textureFileID);
                 creatureDisplayInfo.textureVariations[textureVariantIndex] = creatureDisplayInfoStorage.AddString(filePath.generic_string());
             }
 
@@ -1463,6 +1471,7 @@ bool ClientDBExtractor::ExtractLightSkybox(const std::string& name)
                 {
                     const std::string& fileStr = cascLoader->GetFilePathFromListFileID(fileID);
                     filePath = fs::path("model") / fs::path(fileStr).replace_extension(Model::FILE_EXTENSION);
+                    referencedModelFileIDs.insert(fileID);
                 }
             }
 
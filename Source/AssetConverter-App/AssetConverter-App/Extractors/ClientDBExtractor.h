@@ -61,6 +61,10 @@ public:
     static robin_hood::unordered_map<u32, std::vector<u32>> modelResourcesIDToModelFileDataEntry;
     static robin_hood::unordered_map<u32, std::vector<u32>> materialResourcesIDToTextureFileDataEntry;
 
+    // Every model and texture FileID referenced by an extracted ClientDB, used as roots by the DependencyResolver
+    static robin_hood::unordered_set<u32> referencedModelFileIDs;
+    static robin_hood::unordered_set<u32> referencedTextureFileIDs;
+
 private:
     struct ExtractionEntry
     {
@@ -1,8 +1,11 @@
 #include "ComplexModelExtractor.h"
+#include "DependencyResolver.h"
 #include "AssetConverter-App/Runtime.h"
 #include "AssetConverter-App/Casc/CascLoader.h"
 #include "AssetConverter-App/Util/JoltStream.h"
+#include "AssetConverter-App/Util/MeshOptimizer.h"
 #include "AssetConverter-App/Util/ServiceLocator.h"
+#include "AssetConverter-App/Util/VertexQuantizer.h"
 
 #include <Base/Container/ConcurrentQueue.h>
 #include <Base/Util/DebugHandler.h>
@@ -23,6 +26,149 @@
 #include <filesystem>
 namespace fs = std::filesystem;
 
+namespace
+{
+    void ResolveTextureHashes(CascLoader* cascLoader, Model::ComplexModel& cmodel)
+    {
+        for (u32 i = 0; i < cmodel.textures.size(); i++)
+        {
+            Model::ComplexModel::Texture& texture = cmodel.textures[i];
+
+            u32 fileID = static_cast<u32>(texture.textureHash); // This has not been converted to a textureHash yet.
+            texture.textureHash = std::numeric_limits<u64>().max(); // Default to invalid
+
+            if (fileID == 0 || fileID == std::numeric_limits<u32>().max())
+                continue;
+
+            if (!cascLoader->InCascAndListFile(fileID))
+                continue;
+
+            const std::string& cascFilePath = cascLoader->GetFilePathFromListFileID(fileID);
+            if (cascFilePath.size() == 0)
+                continue;
+
+            fs::path texturePath = fs::path("texture") / cascFilePath;
+            texturePath.replace_extension("dds").make_preferred();
+
+            std::string textureName = texturePath.string();
+            std::transform(textureName.begin(), textureName.end(), textureName.begin(), ::tolower);
+            std::replace(textureName.begin(), textureName.end(), '\\', '/');
+
+            texture.textureHash = XXHash64::hash(textureName.c_str(), textureName.length(), 0);
+        }
+    }
+
+    void CreatePhysicsData(Model::ComplexModel& cmodel)
+    {
+        u32 numCollisionVertices = static_cast<u32>(cmodel.collisionVertexPositions.size());
+        u32 numCollisionIndices = static_cast<u32>(cmodel.collisionIndices.size());
+        u32 indexRemainder = numCollisionIndices % 3;
+
+        if (numCollisionVertices > 0 && numCollisionIndices > 0 && indexRemainder == 0)
+        {
+            u32 numTriangles = numCollisionIndices / 3;
+
+            JPH::VertexList vertexList;
+            vertexList.reserve(numCollisionVertices);
+
+            JPH::IndexedTriangleList triangleList;
+            triangleList.reserve(numTriangles);
+
+            for (u32 i = 0; i < numCollisionVertices; i++)
+            {
+                const vec3& vertexPos = cmodel.collisionVertexPositions[i];
+                vertexList.push_back({ vertexPos.x, vertexPos.y, vertexPos.z });
+            }
+
+            for (u32 i = 0; i < numTriangles; i++)
+            {
+                u32 offset = i * 3;
+
+                u16 indexA = cmodel.collisionIndices[offset + 2];
+                u16 indexB = cmodel.collisionIndices[offset + 1];
+                u16 indexC = cmodel.collisionIndices[offset + 0];
+
+                triangleList.push_back({ indexA, indexB, indexC });
+            }
+
+            JPH::MeshShapeSettings shapeSetting(vertexList, triangleList);
+            JPH::ShapeSettings::ShapeResult shapeResult = shapeSetting.Create();
+            JPH::ShapeRefC shape = shapeResult.Get();
+
+            JPH::Shape::ShapeToIDMap shapeMap;
+            JPH::Shape::MaterialToIDMap materialMap;
+
+            std::shared_ptr<Bytebuffer> joltChunkBuffer = Bytebuffer::Borrow<16777216>();
+            JoltStream joltStream(joltChunkBuffer);
+
+            shape->SaveWithChildren(joltStream, shapeMap, materialMap);
+
+            if (!joltStream.IsFailed() && joltChunkBuffer->writtenData > 0)
+            {
+                cmodel.physicsData.resize(joltChunkBuffer->writtenData);
+                memcpy(&cmodel.physicsData[0], joltChunkBuffer->GetDataPointer(), joltChunkBuffer->writtenData);
+            }
+        }
+    }
+
+    bool SaveComplexModel(Runtime* runtime, Model::ComplexModel& cmodel, const std::string& fileName, const std::string& path, std::shared_ptr<Bytebuffer>& buffer)
+    {
+        constexpr size_t MAX_SERIALIZED_MODEL_SIZE = 64 * 1024 * 1024;
+        const size_t serializedSize = cmodel.GetSerializedSize();
+        bool serialized = false;
+
+        if (serializedSize <= MAX_SERIALIZED_MODEL_SIZE)
+        {
+            if (!buffer || buffer->size < serializedSize)
+                buffer = Bytebuffer::BorrowRuntime(serializedSize);
+            else
+                buffer->Reset();
+
+            serialized = cmodel.Save(buffer);
+            if (serialized && buffer->writtenData != serializedSize)
+            {
+                NC_LOG_ERROR("[ComplexModel Extractor] Serialized size mismatch for {0} (Expected: {1}, Actual: {2})", fileName, serializedSize, buffer->writtenData);
+                serialized = false;
+            }
+        }
+        else
+        {
+            NC_LOG_WARNING("[ComplexModel Extractor] {0} exceeds the maximum serialized size ({1} bytes)", fileName, serializedSize);
+        }
+
+        if (!serialized)
+        {
+            NC_LOG_WARNING("[ComplexModel Extractor] Failed to extract {0}", fileName);
+            return false;
+        }
+
+        auto& manifest = runtime->pactInfo.GetManifestForFile(runtime, buffer->writtenData);
+        if (!manifest.AddFile(runtime, path, buffer))
+        {
+            NC_LOG_WARNING("[ComplexModel Extractor] Failed to add {0} to PACT storage", fileName);
+            return false;
+        }
+
+        if (runtime->isInDebugMode)
+        {
+            NC_LOG_INFO("[ComplexModel Extractor] Extracted {0}", fileName);
+        }
+
+        return true;
+    }
+
+    // LOD N > 0 is stored next to the full detail model as <name>_lodN, LOD 0 keeps the model's own path
+    std::string GetLodPath(const std::string& path, u32 lodIndex)
+    {
+        if (lodIndex == 0)
+            return path;
+
+        fs::path lodPath = path;
+        lodPath.replace_filename(lodPath.stem().string() + "_lod" + std::to_string(lodIndex) + lodPath.extension().string());
+        return lodPath.generic_string();
+    }
+}
+
 void ComplexModelExtractor::Process()
 {
     Runtime* runtime = ServiceLocator::GetRuntime();
@@ -59,6 +205,9 @@ void ComplexModelExtractor::Process()
                     break;
             }
     
+            if (!DependencyResolver::IsModelReachable(m2FileID))
+                continue;
+
             if (!cascLoader->InCascAndListFile(m2FileID))
                 continue;
     
@@ -87,7 +236,17 @@ void ComplexModelExtractor::Process()
     u32 numModelsToProcess = static_cast<u32>(fileListQueue.size_approx());
     NC_LOG_INFO("[ComplexModel Extractor] Processing {0} files", numModelsToProcess);
 
-    enki::TaskSet convertM2Task(numModelsToProcess, [&runtime, &cascLoader, &fileListQueue, &numProcessedFiles, &progressFlags, &printMutex, numModelsToProcess](enki::TaskSetPartition range, uint32_t threadNum)
+    const auto& complexModelConfig = runtime->json["Extraction"]["ComplexModel"];
+    const auto& lodsConfig = complexModelConfig.contains("Lods") ? complexModelConfig["Lods"] : nlohmann::ordered_json::object();
+    const u32 maxLods = lodsConfig.value("Enabled", false) ? std::max(1u, lodsConfig.value("MaxLods", 4u)) : 1u;
+    const bool optimizeGeometry = complexModelConfig.value("OptimizeGeometry", false);
+    MeshOptimizer::Statistics geometryStatistics;
+
+    VertexQuantizer::Tolerances vertexTolerances;
+    const bool compactVertices = VertexQuantizer::LoadTolerances("ComplexModel", vertexTolerances);
+    VertexQuantizer::Statistics vertexStatistics;
+
+    enki::TaskSet convertM2Task(numModelsToProcess, [&runtime, &cascLoader, &fileListQueue, &numProcessedFiles, &progressFlags, &printMutex, &geometryStatistics, &vertexTolerances, &vertexStatistics, numModelsToProcess, maxLods, optimizeGeometry, compactVertices](enki::TaskSetPartition range, uint32_t threadNum)
     {
         M2::Parser m2Parser = {};
         std::shared_ptr<Bytebuffer> buffer;
@@ -106,141 +265,63 @@ void ComplexModelExtractor::Process()
                 continue;
             }
 
-            std::shared_ptr<Bytebuffer> skinBuffer = cascLoader->GetFileByID(m2.sfid.skinFileIDs[0]);
-            if (!skinBuffer || skinBuffer->size == 0 || skinBuffer->writtenData == 0)
-                continue;
-
-            if (!m2Parser.TryParse(M2::Parser::ParseType::Skin, skinBuffer, m2))
-                continue;
+            // Every skin profile is a LOD of the same root, the first one is the full detail model. The IDs are copied
+            // since the last LOD takes over the root's layout.
+            const auto skinFileIDs = m2.sfid.skinFileIDs;
 
-            Model::ComplexModel cmodel = { };
-            if (!Model::ComplexModel::FromM2(rootBuffer, skinBuffer, m2, cmodel))
-                continue;
-
-            // Post Process
+            // Parses the LOD's skin into lodLayout and saves the model, returns false when the LOD can't be
+            // converted, which also ends the LODs after it
+            auto ConvertLod = [&](u32 lodIndex, M2::Layout& lodLayout)
             {
-                for (u32 i = 0; i < cmodel.textures.size(); i++)
-                {
-                    Model::ComplexModel::Texture& texture = cmodel.textures[i];
-
-                    u32 fileID = static_cast<u32>(texture.textureHash); // This has not been converted to a textureHash yet.
-                    texture.textureHash = std::numeric_limits<u64>().max(); // Default to invalid
-
-                    if (fileID == 0 || fileID == std::numeric_limits<u32>().max())
-                        continue;
-
-                    if (!cascLoader->InCascAndListFile(fileID))
-                        continue;
-
-                    const std::string& cascFilePath = cascLoader->GetFilePathFromListFileID(fileID);
-                    if (cascFilePath.size() == 0)
-                        continue;
-
-                    fs::path texturePath = fs::path("texture") / cascFilePath;
-                    texturePath.replace_extension("dds").make_preferred();
-
-                    std::string textureName = texturePath.string();
-                    std::transform(textureName.begin(), textureName.end(), textureName.begin(), ::tolower);
-                    std::replace(textureName.begin(), textureName.end(), '\\', '/');
+                const u32 skinFileID = skinFileIDs[lodIndex];
+                const auto previousSkinFileIDs = skinFileIDs.begin() + lodIndex;
+                if (lodIndex > 0 && (skinFileID == 0 || std::find(skinFileIDs.begin(), previousSkinFileIDs, skinFileID) != previousSkinFileIDs))
+                    return false;
 
-                    texture.textureHash = XXHash64::hash(textureName.c_str(), textureName.length(), 0);
-                }
-
-                // if build physics shapes
-                {
-                    u32 numCollisionVertices = static_cast<u32>(cmodel.collisionVertexPositions.size());
-                    u32 numCollisionIndices = static_cast<u32>(cmodel.collisionIndices.size());
-                    u32 indexRemainder = numCollisionIndices % 3;
-
-                    if (numCollisionVertices > 0 && numCollisionIndices > 0 && indexRemainder == 0)
-                    {
-                        u32 numTriangles = numCollisionIndices / 3;
+                std::shared_ptr<Bytebuffer> skinBuffer = cascLoader->GetFileByID(skinFileID);
+                if (!skinBuffer || skinBuffer->size == 0 || skinBuffer->writtenData == 0)
+                    return false;
 
-                        JPH::VertexList vertexList;
-                        vertexList.reserve(numCollisionVertices);
+                if (!m2Parser.TryParse(M2::Parser::ParseType::Skin, skinBuffer, lodLayout))
+                    return false;
 
-                        JPH::IndexedTriangleList triangleList;
-                        triangleList.reserve(numTriangles);
+                Model::ComplexModel cmodel = { };
+                if (!Model::ComplexModel::FromM2(rootBuffer, skinBuffer, lodLayout, cmodel))
+                    return false;
 
-                        for (u32 i = 0; i < numCollisionVertices; i++)
-                        {
-                            const vec3& vertexPos = cmodel.collisionVertexPositions[i];
-                            vertexList.push_back({ vertexPos.x, vertexPos.y, vertexPos.z });
-                        }
+                ResolveTextureHashes(cascLoader, cmodel);
 
-                        for (u32 i = 0; i < numTriangles; i++)
-                        {
-                            u32 offset = i * 3;
+                // The collision geometry comes from the root, only the full detail model carries the physics shape
+                if (lodIndex == 0)
+                    CreatePhysicsData(cmodel);
 
-                            u16 indexA = cmodel.collisionIndices[offset + 2];
-                            u16 indexB = cmodel.collisionIndices[offset + 1];
-                            u16 indexC = cmodel.collisionIndices[offset + 0];
+                const std::string lodPath = GetLodPath(fileListEntry.path, lodIndex);
+                if (optimizeGeometry)
+                    MeshOptimizer::Optimize(cmodel, lodPath, "ComplexModel Extractor", geometryStatistics);
 
-                            triangleList.push_back({ indexA, indexB, indexC });
-                        }
+                if (!SaveComplexModel(runtime, cmodel, fs::path(lodPath).filename().string(), lodPath, buffer))
+                    return false;
 
-                        JPH::MeshShapeSettings shapeSetting(vertexList, triangleList);
-                        JPH::ShapeSettings::ShapeResult shapeResult = shapeSetting.Create();
-                        JPH::ShapeRefC shape = shapeResult.Get();
+                if (compactVertices)
+                    VertexQuantizer::SaveCompactVertices(cmodel, vertexTolerances, lodPath, "ComplexModel Extractor", vertexStatistics);
 
-                        JPH::Shape::ShapeToIDMap shapeMap;
-                        JPH::Shape::MaterialToIDMap materialMap;
+                return true;
+            };
 
-                        std::shared_ptr<Bytebuffer> joltChunkBuffer = Bytebuffer::Borrow<16777216>();
-                        JoltStream joltStream(joltChunkBuffer);
-
-                        shape->SaveWithChildren(joltStream, shapeMap, materialMap);
-
-                        if (!joltStream.IsFailed() && joltChunkBuffer->writtenData > 0)
-                        {
-                            cmodel.physicsData.resize(joltChunkBuffer->writtenData);
-                            memcpy(&cmodel.physicsData[0], joltChunkBuffer->GetDataPointer(), joltChunkBuffer->writtenData);
-                        }
-                    }
-                }
-            }
-
-            constexpr size_t MAX_SERIALIZED_MODEL_SIZE = 64 * 1024 * 1024;
-            const size_t serializedSize = cmodel.GetSerializedSize();
-            bool serialized = false;
-
-            if (serializedSize <= MAX_SERIALIZED_MODEL_SIZE)
-            {
-                if (!buffer || buffer->size < serializedSize)
-                    buffer = Bytebuffer::BorrowRuntime(serializedSize);
-                else
-                    buffer->Reset();
-
-                serialized = cmodel.Save(buffer);
-                if (serialized && buffer->writtenData != serializedSize)
-                {
-                    NC_LOG_ERROR("[ComplexModel Extractor] Serialized size mismatch for {0} (Expected: {1}, Actual: {2})", fileListEntry.fileName, serializedSize, buffer->writtenData);
-                    serialized = false;
-                }
-            }
-            else
+            // Every LOD but the last is parsed into a copy of the root, the last one is handed the root itself
+            const u32 numLods = std::min(maxLods, static_cast<u32>(skinFileIDs.size()));
+            u32 lodIndex = 0;
+            for (; lodIndex + 1 < numLods; lodIndex++)
             {
-                NC_LOG_WARNING("[ComplexModel Extractor] {0} exceeds the maximum serialized size ({1} bytes)", fileListEntry.fileName, serializedSize);
+                M2::Layout lodLayout = m2;
+                if (!ConvertLod(lodIndex, lodLayout))
+                    break;
             }
 
-            if (serialized)
+            if (lodIndex + 1 == numLods)
             {
-                auto& manifest = runtime->pactInfo.GetManifestForFile(runtime, buffer->writtenData);
-                if (manifest.AddFile(runtime, fileListEntry.path, buffer))
-                {
-                    if (runtime->isInDebugMode)
-                    {
-                        NC_LOG_INFO("[ComplexModel Extractor] Extracted {0}", fileListEntry.fileName);
-                    }
-                }
-                else
-                {
-                    NC_LOG_WARNING("[ComplexModel Extractor] Failed to add {0} to PACT storage", fileListEntry.fileName);
-                }
-            }
-            else
-            {
-                NC_LOG_WARNING("[ComplexModel Extractor] Failed to extract {0}", fileListEntry.fileName);
+                M2::Layout lodLayout = std::move(m2);
+                ConvertLod(lodIndex, lodLayout);
             }
 
             {
@@ -264,4 +345,10 @@ void ComplexModelExtractor::Process()
     convertM2Task.m_Priority = enki::TaskPriority::TASK_PRIORITY_HIGH;
     runtime->scheduler.AddTaskSetToPipe(&convertM2Task);
     runtime->scheduler.WaitforTask(&convertM2Task);
+
+    if (optimizeGeometry)
+        MeshOptimizer::LogStatistics("ComplexModel Extractor", geometryStatistics);
+
+    if (compactVertices)
+        VertexQuantizer::LogStatistics("ComplexModel Extractor", vertexStatistics);
 }
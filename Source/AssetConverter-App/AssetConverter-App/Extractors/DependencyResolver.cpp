@@ -0,0 +1,379 @@
+#include "DependencyResolver.h"
+#include "AssetConverter-App/Runtime.h"
+#include "AssetConverter-App/Casc/CascLoader.h"
+#include "AssetConverter-App/Extractors/ClientDBExtractor.h"
+#include "AssetConverter-App/Util/MapSelection.h"
+#include "AssetConverter-App/Util/ServiceLocator.h"
+
+#include <Base/Util/DebugHandler.h>
+#include <Base/Util/StringUtils.h>
+
+#include <FileFormat/Novus/Map/Map.h>
+#include <FileFormat/Novus/Map/MapChunk.h>
+#include <FileFormat/Novus/Model/ComplexModel.h>
+#include <FileFormat/Novus/Model/MapObject.h>
+#include <FileFormat/Warcraft/ADT/Adt.h>
+#include <FileFormat/Warcraft/M2/M2.h>
+#include <FileFormat/Warcraft/Parsers/AdtParser.h>
+#include <FileFormat/Warcraft/Parsers/M2Parser.h>
+#include <FileFormat/Warcraft/Parsers/WdtParser.h>
+#include <FileFormat/Warcraft/Parsers/WmoParser.h>
+#include <FileFormat/Warcraft/WMO/Wmo.h>
+
+#include <MetaGen/Shared/ClientDB/ClientDB.h>
+
+#include <enkiTS/TaskScheduler.h>
+
+#include <tracy/Tracy.hpp>
+
+#include <limits>
+#include <mutex>
+#include <vector>
+
+bool DependencyResolver::_isEnabled = false;
+robin_hood::unordered_set<u32> DependencyResolver::_reachableModelFileIDs;
+robin_hood::unordered_set<u32> DependencyResolver::_reachableTextureFileIDs;
+
+namespace
+{
+    // Textures under these prefixes are referenced by name from code or ClientDB strings rather than by FileID,
+    // so they are kept regardless of what the resolver found
+    const char* const ALWAYS_REACHABLE_TEXTURE_PREFIXES[] =
+    {
+        "interface/",
+        "xtextures/"
+    };
+
+    struct References
+    {
+    public:
+        void AddTexture(u32 fileID)
+        {
+            if (fileID != 0 && fileID != std::numeric_limits<u32>().max())
+                textures.push_back(fileID);
+        }
+
+        void AddModel(CascLoader* cascLoader, u32 fileID)
+        {
+            if (fileID == 0 || fileID == std::numeric_limits<u32>().max())
+                return;
+
+            const std::string& path = cascLoader->GetFilePathFromListFileID(fileID);
+            if (StringUtils::EndsWith(path, ".wmo"))
+            {
+                mapObjects.push_back(fileID);
+            }
+            else if (CascListFile::IsM2Path(path))
+            {
+                complexModels.push_back(fileID);
+            }
+        }
+
+        void Clear()
+        {
+            textures.clear();
+            mapObjects.clear();
+            complexModels.clear();
+        }
+
+    public:
+        std::vector<u32> textures;
+        std::vector<u32> mapObjects;
+        std::vector<u32> complexModels;
+    };
+
+    struct ReachableSet
+    {
+    public:
+        void Merge(const References& references)
+        {
+            std::scoped_lock lock(mutex);
+
+            textures.insert(references.textures.begin(), references.textures.end());
+            mapObjects.insert(references.mapObjects.begin(), references.mapObjects.end());
+            complexModels.insert(references.complexModels.begin(), references.complexModels.end());
+        }
+
+    public:
+        std::mutex mutex;
+        robin_hood::unordered_set<u32> textures;
+        robin_hood::unordered_set<u32> mapObjects;
+        robin_hood::unordered_set<u32> complexModels;
+    };
+
+    void ResolveMap(Runtime* runtime, CascLoader* cascLoader, u32 mapID, const Adt::Wdt& wdt, ReachableSet& reachable)
+    {
+        enki::TaskSet resolveMapTask(Terrain::CHUNK_NUM_PER_MAP, [&, mapID](enki::TaskSetPartition range, uint32_t threadNum)
+        {
+            Adt::Parser adtParser = { };
+            References references;
+
+            for (u32 chunkID = range.start; chunkID < range.end; chunkID++)
+            {
+                u32 originalChunkGridPosX = chunkID % 64;
+                u32 originalChunkGridPosY = chunkID / 64;
+
+                const Adt::MAIN::AreaInfo& areaInfo = wdt.main.areaInfos[originalChunkGridPosX][originalChunkGridPosY];
+                if (!areaInfo.flags.IsUsed)
+                    continue;
+
+                const Adt::MAID::FileIDs& fileIDs = wdt.maid.fileIDs[originalChunkGridPosX][originalChunkGridPosY];
+                if (fileIDs.adtRootFileID == 0 || fileIDs.adtTextureFileID == 0 || fileIDs.adtObject1FileID == 0)
+                    continue;
+
+                std::shared_ptr<Bytebuffer> rootBuffer = cascLoader->GetFileByID(fileIDs.adtRootFileID);
+                std::shared_ptr<Bytebuffer> textBuffer = cascLoader->GetFileByID(fileIDs.adtTextureFileID);
+                std::shared_ptr<Bytebuffer> objBuffer = cascLoader->GetFileByID(fileIDs.adtObject1FileID);
+                if (!rootBuffer)
+                    continue;
+
+                Adt::Layout adt = { };
+                {
+                    adt.mapID = mapID;
+                    adt.chunkID = (chunkID / 64) + ((chunkID % 64) * Terrain::CHUNK_NUM_PER_MAP_STRIDE);
+                }
+
+                Adt::Parser::Context context = { };
+                if (!adtParser.TryParse(context, rootBuffer, textBuffer, objBuffer, wdt, adt))
+                    continue;
+
+                Map::Chunk chunk = { };
+                std::vector<Terrain::Placement> modelPlacements;
+                Map::LiquidInfo liquidInfo;
+                if (!Map::Chunk::FromADT(adt, chunk, modelPlacements, liquidInfo))
+                    continue;
+
+                for (u32 cellIndex = 0; cellIndex < Terrain::CHUNK_NUM_CELLS; cellIndex++)
+                {
+                    for (u32 layer = 0; layer < 4; layer++)
+                    {
+                        references.AddTexture(static_cast<u32>(chunk.cellsData.layerTextureIDs[cellIndex][layer]));
+                    }
+                }
+
+                for (const Terrain::Placement& placement : modelPlacements)
+                {
+                    references.AddModel(cascLoader, static_cast<u32>(placement.nameHash));
+                }
+            }
+
+            reachable.Merge(references);
+        });
+
+        runtime->scheduler.AddTaskSetToPipe(&resolveMapTask);
+        runtime->scheduler.WaitforTask(&resolveMapTask);
+    }
+
+    void ResolveMapObjects(Runtime* runtime, CascLoader* cascLoader, const std::vector<u32>& mapObjectFileIDs, ReachableSet& reachable)
+    {
+        if (mapObjectFileIDs.empty())
+            return;
+
+        enki::TaskSet resolveMapObjectsTask(static_cast<u32>(mapObjectFileIDs.size()), [&](enki::TaskSetPartition range, uint32_t threadNum)
+        {
+            Wmo::Parser wmoParser = { };
+            References references;
+
+            for (u32 index = range.start; index < range.end; index++)
+            {
+                Wmo::Layout wmo = { };
+                std::shared_ptr<Bytebuffer> rootBuffer = cascLoader->GetFileByID(mapObjectFileIDs[index]);
+                if (!rootBuffer || !wmoParser.TryParse(Wmo::Parser::ParseType::Root, rootBuffer, wmo))
+                    continue;
+
+                for (u32 i = 0; i < wmo.mohd.groupCount; i++)
+                {
+                    u32 fileID = wmo.gfid.data[i].fileID;
+                    if (fileID == 0)
+                        continue;
+
+                    std::shared_ptr<Bytebuffer> groupBuffer = cascLoader->GetFileByID(fileID);
+                    if (!groupBuffer)
+                        continue;
+
+                    wmoParser.TryParse(Wmo::Parser::ParseType::Group, groupBuffer, wmo);
+                }
+
+                Model::MapObject mapObject = { };
+                if (!Model::MapObject::FromWMO(wmo, mapObject))
+                    continue;
+
+                for (const Model::MapObject::Material& material : mapObject.materials)
+                {
+                    for (u32 j = 0; j < 3; j++)
+                    {
+                        references.AddTexture(static_cast<u32>(material.textureID[j]));
+                    }
+                }
+
+                for (const Model::MapObject::Decoration& decoration : mapObject.decorations)
+                {
+                    references.AddModel(cascLoader, static_cast<u32>(decoration.nameID));
+                }
+            }
+
+            reachable.Merge(references);
+        });
+
+        runtime->scheduler.AddTaskSetToPipe(&resolveMapObjectsTask);
+        runtime->scheduler.WaitforTask(&resolveMapObjectsTask);
+    }
+
+    void ResolveComplexModels(Runtime* runtime, CascLoader* cascLoader, const std::vector<u32>& complexModelFileIDs, ReachableSet& reachable)
+    {
+        if (complexModelFileIDs.empty())
+            return;
+
+        enki::TaskSet resolveComplexModelsTask(static_cast<u32>(complexModelFileIDs.size()), [&](enki::TaskSetPartition range, uint32_t threadNum)
+        {
+            M2::Parser m2Parser = { };
+            References references;
+
+            for (u32 index = range.start; index < range.end; index++)
+            {
+                std::shared_ptr<Bytebuffer> rootBuffer = cascLoader->GetFileByID(complexModelFileIDs[index]);
+                if (!rootBuffer || rootBuffer->size == 0 || rootBuffer->writtenData == 0)
+                    continue;
+
+                M2::Layout m2 = { };
+                if (!m2Parser.TryParse(M2::Parser::ParseType::Root, rootBuffer, m2))
+                    continue;
+
+                std::shared_ptr<Bytebuffer> skinBuffer = cascLoader->GetFileByID(m2.sfid.skinFileIDs[0]);
+                if (!skinBuffer || skinBuffer->size == 0 || skinBuffer->writtenData == 0)
+                    continue;
+
+                if (!m2Parser.TryParse(M2::Parser::ParseType::Skin, skinBuffer, m2))
+                    continue;
+
+                Model::ComplexModel cmodel = { };
+                if (!Model::ComplexModel::FromM2(rootBuffer, skinBuffer, m2, cmodel))
+                    continue;
+
+                for (const Model::ComplexModel::Texture& texture : cmodel.textures)
+                {
+                    references.AddTexture(static_cast<u32>(texture.textureHash)); // This has not been converted to a textureHash yet.
+                }
+            }
+
+            reachable.Merge(references);
+        });
+
+        runtime->scheduler.AddTaskSetToPipe(&resolveComplexModelsTask);
+        runtime->scheduler.WaitforTask(&resolveComplexModelsTask);
+    }
+}
+
+void DependencyResolver::Process()
+{
+    ZoneScopedN("DependencyResolver::Process");
+
+    Runtime* runtime = ServiceLocator::GetRuntime();
+    CascLoader* cascLoader = ServiceLocator::GetCascLoader();
+
+    _isEnabled = false;
+    _reachableModelFileIDs.clear();
+    _reachableTextureFileIDs.clear();
+
+    const MapSelection mapSelection = LoadMapSelection();
+    const bool includeClientDB = !mapSelection.IsRestricted();
+
+    if (includeClientDB && ClientDBExtractor::referencedModelFileIDs.empty() && ClientDBExtractor::referencedTextureFileIDs.empty())
+    {
+        NC_LOG_WARNING("[Dependency Resolver] Pruning without a MapSelection requires the ClientDB extractor, every asset will be extracted");
+        return;
+    }
+
+    ReachableSet reachable;
+
+    // Roots : Selected maps
+    auto& mapStorage = ClientDBExtractor::mapStorage;
+    mapStorage.Each([&](const u32 id, const MetaGen::Shared::ClientDB::MapRecord& map) -> bool
+    {
+        std::string internalName = mapStorage.GetString(map.nameInternal);
+        StringUtils::ToLower(internalName);
+        if (!mapSelection.Contains(id, internalName))
+            return true;
+
+        std::string wdtPath = "world/maps/" + internalName + "/" + internalName + ".wdt";
+        u32 wdtFileID = cascLoader->GetFileIDFromListFilePath(wdtPath.data());
+        if (!wdtFileID)
+            return true;
+
+        std::shared_ptr<Bytebuffer> fileWDT = cascLoader->GetFileByID(wdtFileID);
+        if (!fileWDT)
+            return true;
+
+        Adt::WdtParser wdtParser = { };
+
+        Adt::Wdt wdt = { };
+        if (!wdtParser.TryParse(fileWDT, wdt))
+            return true;
+
+        if (wdt.mphd.flags.UseGlobalMapObj)
+        {
+            if (wdt.modf.data.size() && wdt.modf.data[0].flags.EntryIsFiledataID)
+            {
+                std::scoped_lock lock(reachable.mutex);
+                reachable.mapObjects.insert(wdt.modf.data[0].fileID);
+            }
+
+            return true;
+        }
+
+        ResolveMap(runtime, cascLoader, id, wdt, reachable);
+        return true;
+    });
+
+    // Roots : ClientDB, only when every map is selected as ClientDB records are not tied to a map
+    if (includeClientDB)
+    {
+        References references;
+
+        for (u32 fileID : ClientDBExtractor::referencedModelFileIDs)
+            references.AddModel(cascLoader, fileID);
+
+        references.textures.insert(references.textures.end(), ClientDBExtractor::referencedTextureFileIDs.begin(), ClientDBExtractor::referencedTextureFileIDs.end());
+        reachable.Merge(references);
+    }
+
+    // Map Objects can place Complex Models, Complex Models only reference textures so two passes reach everything
+    std::vector<u32> mapObjectFileIDs(reachable.mapObjects.begin(), reachable.mapObjects.end());
+    ResolveMapObjects(runtime, cascLoader, mapObjectFileIDs, reachable);
+
+    std::vector<u32> complexModelFileIDs(reachable.complexModels.begin(), reachable.complexModels.end());
+    ResolveComplexModels(runtime, cascLoader, complexModelFileIDs, reachable);
+
+    _reachableModelFileIDs.reserve(reachable.mapObjects.size() + reachable.complexModels.size());
+    _reachableModelFileIDs.insert(reachable.mapObjects.begin(), reachable.mapObjects.end());
+    _reachableModelFileIDs.insert(reachable.complexModels.begin(), reachable.complexModels.end());
+    _reachableTextureFileIDs = std::move(reachable.textures);
+    _isEnabled = true;
+
+    NC_LOG_INFO("[Dependency Resolver] Reachable assets : {0} map objects, {1} complex models, {2} textures", reachable.mapObjects.size(), reachable.complexModels.size(), _reachableTextureFileIDs.size());
+}
+
+bool DependencyResolver::IsModelReachable(u32 fileID)
+{
+    if (!_isEnabled)
+        return true;
+
+    return _reachableModelFileIDs.contains(fileID);
+}
+
+bool DependencyResolver::IsTextureReachable(u32 fileID, const std::string& listFilePath)
+{
+    if (!_isEnabled)
+        return true;
+
+    if (_reachableTextureFileIDs.contains(fileID))
+        return true;
+
+    for (const char* prefix : ALWAYS_REACHABLE_TEXTURE_PREFIXES)
+    {
+        if (StringUtils::BeginsWith(listFilePath, prefix))
+            return true;
+    }
+
+    return false;
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include <Base/Types.h>
+
+#include <robinhood/robinhood.h>
+
+#include <string>
+
+class DependencyResolver
+{
+public:
+    static void Process();
+
+    // When the resolver is disabled every asset is reachable
+    static bool IsEnabled() { return _isEnabled; }
+    static bool IsModelReachable(u32 fileID);
+    static bool IsTextureReachable(u32 fileID, const std::string& listFilePath);
+
+private:
+    static bool _isEnabled;
+    static robin_hood::unordered_set<u32> _reachableModelFileIDs;
+    static robin_hood::unordered_set<u32> _reachableTextureFileIDs;
+};
@@ -1,11 +1,17 @@
 #include "MapExtractor.h"
+#include "NavMeshBenchmark.h"
 #include "NavMeshBuilder.h"
+#include "NavMeshCompactHeight.h"
+#include "NavMeshContainer.h"
+#include "NavMeshPathGraph.h"
+#include "NavMeshTileCache.h"
 #include "NavMeshValidator.h"
 #include "AssetConverter-App/Runtime.h"
 #include "AssetConverter-App/Blp/BlpConvert.h"
 #include "AssetConverter-App/Casc/CascLoader.h"
 #include "AssetConverter-App/Extractors/ClientDBExtractor.h"
 #include "AssetConverter-App/Util/JoltStream.h"
+#include "AssetConverter-App/Util/MapSelection.h"
 #include "AssetConverter-App/Util/ServiceLocator.h"
 
 #include <Base/Container/ConcurrentQueue.h>
@@ -16,9 +22,14 @@
 #include <FileFormat/Novus/Map/Map.h>
 #include <FileFormat/Novus/Map/MapChunk.h>
 #include <FileFormat/Novus/Model/ComplexModel.h>
+#include <FileFormat/Novus/Model/MapObject.h>
 #include <FileFormat/Warcraft/ADT/Adt.h>
+#include <FileFormat/Warcraft/M2/M2.h>
+#include <FileFormat/Warcraft/WMO/Wmo.h>
 #include <FileFormat/Warcraft/Parsers/WdtParser.h>
 #include <FileFormat/Warcraft/Parsers/AdtParser.h>
+#include <FileFormat/Warcraft/Parsers/M2Parser.h>
+#include <FileFormat/Warcraft/Parsers/WmoParser.h>
 
 #include <MetaGen/Shared/ClientDB/ClientDB.h>
 
@@ -28,87 +39,36 @@
 #include <Jolt/Jolt.h>
 #include <Jolt/Geometry/Triangle.h>
 #include <Jolt/Physics/Body/BodyCreationSettings.h>
+#include <Jolt/Physics/Collision/Shape/HeightFieldShape.h>
 #include <Jolt/Physics/Collision/Shape/MeshShape.h>
 
 #include <tracy/Tracy.hpp>
 
 #include <robinhood/robinhood.h>
 
+#include <xxhash/xxhash64.h>
+
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <chrono>
+#include <cmath>
+#include <cstring>
 #include <filesystem>
 #include <limits>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <string_view>
+#include <thread>
+#include <vector>
 
 using namespace ClientDB;
 
 namespace
 {
-    struct MapSelection
-    {
-        robin_hood::unordered_set<u32> ids;
-        robin_hood::unordered_set<std::string> internalNames;
-
-        bool IsRestricted() const
-        {
-            return !ids.empty() || !internalNames.empty();
-        }
-
-        bool Contains(u32 id, const std::string& internalName) const
-        {
-            if (!IsRestricted())
-                return true;
-
-            return ids.contains(id) || internalNames.contains(internalName);
-        }
-    };
-
-    MapSelection LoadMapSelection()
-    {
-        Runtime* runtime = ServiceLocator::GetRuntime();
-        MapSelection selection;
-
-        const auto& extractionConfig = runtime->json["Extraction"];
-        if (!extractionConfig.contains("MapSelection"))
-            return selection;
-
-        const auto& mapSelectionConfig = extractionConfig["MapSelection"];
-        if (mapSelectionConfig.contains("IDs") && mapSelectionConfig["IDs"].is_array())
-        {
-            for (const auto& idValue : mapSelectionConfig["IDs"])
-            {
-                if (idValue.is_number_unsigned())
-                {
-                    selection.ids.insert(idValue.get<u32>());
-                }
-                else if (idValue.is_number_integer())
-                {
-                    const i64 signedID = idValue.get<i64>();
-                    if (signedID >= 0 && signedID <= std::numeric_limits<u32>::max())
-                        selection.ids.insert(static_cast<u32>(signedID));
-                }
-            }
-        }
-
-        if (mapSelectionConfig.contains("InternalNames") && mapSelectionConfig["InternalNames"].is_array())
-        {
-            for (const auto& nameValue : mapSelectionConfig["InternalNames"])
-            {
-                if (!nameValue.is_string())
-                    continue;
-
-                std::string internalName = nameValue.get<std::string>();
-                StringUtils::ToLower(internalName);
-                selection.internalNames.insert(std::move(internalName));
-            }
-        }
-
-        return selection;
-    }
-
-    bool PrepareNavMeshOutputDirectory(const std::filesystem::path& outputDirectory, const std::string& mapName)
+    // An incremental build keeps the previous container and TileCache layers, the unchanged tiles are copied out of them
+    bool PrepareNavMeshOutputDirectory(const std::filesystem::path& outputDirectory, const std::string& mapName, bool keepContainer, bool keepTileCacheLayers)
     {
         std::error_code error;
         std::filesystem::create_directories(outputDirectory, error);
@@ -134,7 +94,17 @@ namespace
 
             const std::filesystem::path& path = entry.path();
             const std::string extension = path.extension().string();
-            if (extension != NavMesh::TILE_FILE_EXTENSION && extension != NavMesh::TerrainHeight::FILE_EXTENSION)
+            const bool isContainer = extension == NavMesh::Container::FILE_EXTENSION;
+            const bool isTileCacheLayers = extension == NavMesh::TileCache::LAYERS_FILE_EXTENSION;
+            const bool isArtifact = isContainer || isTileCacheLayers ||
+                extension == NavMesh::TILE_FILE_EXTENSION ||
+                extension == NavMesh::TerrainHeight::FILE_EXTENSION ||
+                extension == NavMesh::CompactTerrainHeight::FILE_EXTENSION ||
+                extension == NavMesh::TileCache::PARAMS_FILE_EXTENSION ||
+                extension == NavMesh::PathGraph::FILE_EXTENSION;
+            if (!isArtifact ||
+                (isContainer && keepContainer) ||
+                (isTileCacheLayers && keepTileCacheLayers))
             {
                 iterator.increment(error);
                 continue;
@@ -157,29 +127,1736 @@ namespace
             success = false;
         }
 
-        return success;
+        return success;
+    }
+
+    // Collision meshes of the models placed on the maps, parsed from CASC once and shared by every placement.
+    // The models are converted after the maps, so their cooked collision data does not exist yet.
+    class CollisionMeshCache
+    {
+    public:
+        std::shared_ptr<const NavMesh::CollisionMesh> Get(CascLoader* cascLoader, u32 fileID)
+        {
+            {
+                std::scoped_lock scopedLock(_mutex);
+                auto itr = _meshes.find(fileID);
+                if (itr != _meshes.end())
+                    return itr->second;
+            }
+
+            // Models without collision are cached as well, two tiles racing for a model parse it twice at worst
+            std::shared_ptr<const NavMesh::CollisionMesh> mesh = Load(cascLoader, fileID);
+
+            std::scoped_lock scopedLock(_mutex);
+            return _meshes.emplace(fileID, std::move(mesh)).first->second;
+        }
+
+    private:
+        static bool LoadMapObject(CascLoader* cascLoader, std::shared_ptr<Bytebuffer>& rootBuffer, Model::ComplexModel& cmodel)
+        {
+            Wmo::Parser wmoParser = { };
+            Wmo::Layout wmo = { };
+            if (!wmoParser.TryParse(Wmo::Parser::ParseType::Root, rootBuffer, wmo))
+                return false;
+
+            for (u32 i = 0; i < wmo.mohd.groupCount; i++)
+            {
+                u32 groupFileID = wmo.gfid.data[i].fileID;
+                if (groupFileID == 0)
+                    continue;
+
+                std::shared_ptr<Bytebuffer> groupBuffer = cascLoader->GetFileByID(groupFileID);
+                if (!groupBuffer)
+                    continue;
+
+                if (!wmoParser.TryParse(Wmo::Parser::ParseType::Group, groupBuffer, wmo))
+                    continue;
+            }
+
+            Model::MapObject mapObject = { };
+            if (!Model::MapObject::FromWMO(wmo, mapObject))
+                return false;
+
+            return Model::ComplexModel::FromMapObject(mapObject, cmodel);
+        }
+
+        static bool LoadM2(CascLoader* cascLoader, std::shared_ptr<Bytebuffer>& rootBuffer, Model::ComplexModel& cmodel)
+        {
+            M2::Parser m2Parser = { };
+            M2::Layout m2 = { };
+            if (!m2Parser.TryParse(M2::Parser::ParseType::Root, rootBuffer, m2))
+                return false;
+
+            std::shared_ptr<Bytebuffer> skinBuffer = cascLoader->GetFileByID(m2.sfid.skinFileIDs[0]);
+            if (!skinBuffer || skinBuffer->size == 0 || skinBuffer->writtenData == 0)
+                return false;
+
+            if (!m2Parser.TryParse(M2::Parser::ParseType::Skin, skinBuffer, m2))
+                return false;
+
+            return Model::ComplexModel::FromM2(rootBuffer, skinBuffer, m2, cmodel);
+        }
+
+        static std::shared_ptr<const NavMesh::CollisionMesh> Load(CascLoader* cascLoader, u32 fileID)
+        {
+            ZoneScopedN("MapExtractor::CollisionMeshCache::Load");
+
+            if (!cascLoader->InCascAndListFile(fileID))
+                return nullptr;
+
+            std::shared_ptr<Bytebuffer> rootBuffer = cascLoader->GetFileByID(fileID);
+            if (!rootBuffer || rootBuffer->size < sizeof(u32) || rootBuffer->writtenData == 0)
+                return nullptr;
+
+            // Placements do not say which kind of model they reference, WMO roots start with an MVER chunk
+            u32 chunkToken = 0;
+            std::memcpy(&chunkToken, rootBuffer->GetDataPointer(), sizeof(chunkToken));
+
+            Model::ComplexModel cmodel = { };
+            const bool isLoaded = chunkToken == 'MVER' ? LoadMapObject(cascLoader, rootBuffer, cmodel) : LoadM2(cascLoader, rootBuffer, cmodel);
+            if (!isLoaded)
+                return nullptr;
+
+            const size_t numVertices = cmodel.collisionVertexPositions.size();
+            const size_t numIndices = cmodel.collisionIndices.size();
+            if (numVertices == 0 || numIndices == 0 || (numIndices % 3) != 0)
+                return nullptr;
+
+            std::shared_ptr<NavMesh::CollisionMesh> mesh = std::make_shared<NavMesh::CollisionMesh>();
+            mesh->vertices.assign(cmodel.collisionVertexPositions.begin(), cmodel.collisionVertexPositions.end());
+            mesh->indices.assign(cmodel.collisionIndices.begin(), cmodel.collisionIndices.end());
+
+            for (u32 index : mesh->indices)
+            {
+                if (index >= numVertices)
+                {
+                    NC_LOG_WARNING("[Map Extractor] Skipped collision of model {0} for NavMesh, index {1} is out of range", fileID, index);
+                    return nullptr;
+                }
+            }
+
+            mesh->boundsMin = mesh->vertices[0];
+            mesh->boundsMax = mesh->vertices[0];
+            for (const vec3& vertex : mesh->vertices)
+            {
+                mesh->boundsMin = glm::min(mesh->boundsMin, vertex);
+                mesh->boundsMax = glm::max(mesh->boundsMax, vertex);
+            }
+
+            XXHash64 hasher(0);
+            hasher.add(mesh->vertices.data(), mesh->vertices.size() * sizeof(vec3));
+            hasher.add(mesh->indices.data(), mesh->indices.size() * sizeof(u32));
+            mesh->hash = hasher.hash();
+
+            return mesh;
+        }
+
+        std::mutex _mutex;
+        robin_hood::unordered_map<u32, std::shared_ptr<const NavMesh::CollisionMesh>> _meshes;
+    };
+
+    struct ExtractionSettings
+    {
+        bool extractMapAssets = false;
+        bool generateNavMesh = false;
+        bool includeNavMeshObjects = true;
+        bool validateNavMesh = false;
+        bool buildNavPathGraph = false;
+
+        // Validation and the path graph both load the built tiles into one dtNavMesh per agent
+        bool loadNavMesh = false;
+        bool packNavMeshTiles = true;
+        bool incrementalNavMesh = true;
+        bool useMeshTerrainPhysics = false;
+        bool benchmarkNavMesh = false;
+        i32 tileCacheMaxObstacles = 128;
+        NavMesh::BuildSettings navMeshBuildSettings;
+        NavMesh::Benchmark::Settings navMeshBenchmarkSettings;
+    };
+
+    // The tile set of one NavMesh agent profile within a map
+    struct NavAgentOutput
+    {
+        std::string label;
+        std::filesystem::path outputDirectory;
+        std::unique_ptr<NavMesh::Container::Writer> container;
+        std::unique_ptr<NavMesh::Container::Reader> previousContainer;
+        std::atomic<u32> numReusedTiles = 0;
+        moodycamel::ConcurrentQueue<NavMesh::TileData> builtTiles;
+        u32 numBuiltTiles = 0;
+        std::atomic<u32> numTileCacheLayers = 0;
+        std::unique_ptr<NavMesh::SeamValidator> seamValidator;
+
+        // Reads the seam validator's dtNavMesh, so it is declared after it and released first
+        std::unique_ptr<NavMesh::PathGraph::Builder> pathGraphBuilder;
+    };
+
+    // Everything one selected map needs while its tiles are spread over the shared work list.
+    // The last tile to finish publishes the MapHeader, the last NavMesh tile validates the map.
+    struct MapContext
+    {
+        u32 id = 0;
+        std::string internalName;
+        Adt::Wdt wdt = { };
+        Map::MapHeader mapHeader = { };
+        std::filesystem::path navOutputDirectory;
+
+        moodycamel::ConcurrentQueue<u64> chunkHashes;
+        NavMesh::SourceStore navSources;
+        CollisionMeshCache* collisionMeshes = nullptr;
+        std::atomic<u32> remainingTiles = 0;
+        std::once_flag terrainExtractionStarted;
+        std::chrono::steady_clock::time_point terrainExtractionStart;
+        f64 terrainExtractionSeconds = 0.0;
+
+        // Indexed by NavMesh tile ID, a tile becomes buildable once all of its tracked neighbours are done
+        std::array<bool, Terrain::CHUNK_NUM_PER_MAP> hasTileWork = { };
+        std::array<std::atomic<u8>, Terrain::CHUNK_NUM_PER_MAP> pendingNeighbourTiles;
+
+        // The same neighbourhood seen from the source side, a source is freed once all tiles reading it are resolved
+        std::array<std::atomic<u8>, Terrain::CHUNK_NUM_PER_MAP> remainingSourceDependents;
+        std::atomic<u32> remainingNavTiles = 0;
+        std::atomic<u32> numQueuedNavTiles = 0;
+
+        std::vector<std::unique_ptr<NavMesh::Worker>> navMeshWorkers;
+        std::vector<std::unique_ptr<NavAgentOutput>> navAgents;
+        std::once_flag navMeshBuildStarted;
+        std::chrono::steady_clock::time_point navMeshBuildStart;
+        NavMesh::BuildTimings navMeshBuildTimings;
+        f64 navMeshBuildSeconds = 0.0;
+        u32 numBuiltNavTiles = 0;
+
+        // Seam validation and the path graph run as pipeline work once the last NavMesh tile of the map
+        // is built, the batches of all agents count towards the same total
+        std::atomic<u32> remainingValidationBatches = 0;
+        std::chrono::steady_clock::time_point validationStart;
+    };
+
+    struct TileWorkItem
+    {
+        MapContext* mapContext = nullptr;
+        u32 chunkID = 0;
+    };
+
+    struct NavMeshWorkItem
+    {
+        MapContext* mapContext = nullptr;
+        u32 tileID = 0;
+    };
+
+    // first and end index the agent's tile pairs, or its loaded tiles when the batch builds the path graph
+    struct ValidationWorkItem
+    {
+        MapContext* mapContext = nullptr;
+        NavAgentOutput* agentOutput = nullptr;
+        u32 first = 0;
+        u32 end = 0;
+        bool buildsPathGraph = false;
+    };
+
+    struct TileScratch
+    {
+        Adt::Parser adtParser = { };
+        std::vector<u8> outBytes;
+        std::shared_ptr<Bytebuffer> buffer;
+    };
+
+    struct PrefetchedTile
+    {
+        MapContext* mapContext = nullptr;
+        u32 chunkID = 0;
+        std::shared_ptr<Bytebuffer> rootBuffer;
+        std::shared_ptr<Bytebuffer> textBuffer;
+        std::shared_ptr<Bytebuffer> objBuffer;
+    };
+
+    struct ParsedTile
+    {
+        MapContext* mapContext = nullptr;
+        u32 chunkID = 0;
+        std::unique_ptr<Adt::Layout> adt;
+    };
+
+    struct PipelineStage
+    {
+        const char* name = "";
+        u32 maxWorkers = std::numeric_limits<u32>::max();
+        std::atomic<u32> numActiveWorkers = 0;
+        std::atomic<u32> numProcessed = 0;
+        std::atomic<u64> busyNanoseconds = 0;
+
+        bool TryEnter()
+        {
+            u32 numActive = numActiveWorkers.load(std::memory_order_relaxed);
+            while (numActive < maxWorkers)
+            {
+                if (numActiveWorkers.compare_exchange_weak(numActive, numActive + 1, std::memory_order_acquire, std::memory_order_relaxed))
+                    return true;
+            }
+
+            return false;
+        }
+
+        void Leave()
+        {
+            numActiveWorkers.fetch_sub(1, std::memory_order_release);
+        }
+
+        void Record(std::chrono::steady_clock::time_point start)
+        {
+            const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+            busyNanoseconds.fetch_add(static_cast<u64>(elapsed.count()), std::memory_order_relaxed);
+            numProcessed.fetch_add(1, std::memory_order_relaxed);
+        }
+    };
+
+    // The queue itself is unbounded, producers reserve a slot before doing any work so
+    // at most `depth` tiles are ever buffered between two stages
+    template <typename T>
+    struct BoundedTileQueue
+    {
+        u32 depth = 1;
+        std::atomic<u32> numReserved = 0;
+        moodycamel::ConcurrentQueue<T> queue;
+
+        bool TryReserve()
+        {
+            u32 numUsed = numReserved.load(std::memory_order_relaxed);
+            while (numUsed < depth)
+            {
+                if (numReserved.compare_exchange_weak(numUsed, numUsed + 1, std::memory_order_acquire, std::memory_order_relaxed))
+                    return true;
+            }
+
+            return false;
+        }
+
+        void CancelReservation()
+        {
+            numReserved.fetch_sub(1, std::memory_order_release);
+        }
+
+        bool TryDequeue(T& item)
+        {
+            if (!queue.try_dequeue(item))
+                return false;
+
+            numReserved.fetch_sub(1, std::memory_order_release);
+            return true;
+        }
+    };
+
+    // Prefetch (CASC reads) -> parse (Adt::Parser) -> convert (blend maps, physics, save) -> NavMesh.
+    // Every worker prefers the most downstream stage that has input, so CASC reads for upcoming
+    // tiles overlap with the CPU heavy conversion and the Recast builds of the ones already parsed.
+    struct TilePipeline
+    {
+        PipelineStage prefetchStage;
+        PipelineStage parseStage;
+        PipelineStage convertStage;
+        PipelineStage navMeshStage;
+        PipelineStage validationStage;
+
+        u32 numWorkItems = 0;
+        std::atomic<u32> nextWorkItem = 0;
+        BoundedTileQueue<PrefetchedTile> prefetchedTiles;
+        BoundedTileQueue<ParsedTile> parsedTiles;
+        moodycamel::ConcurrentQueue<NavMeshWorkItem> navMeshTiles;
+        moodycamel::ConcurrentQueue<ValidationWorkItem> validationBatches;
+
+        // Completing a tile queues its NavMesh dependents before it is counted, so pending
+        // NavMesh work is always visible once the last tile has been counted. The last NavMesh
+        // tile of a map likewise queues its validation batches before it is counted.
+        std::atomic<u32> numCompletedTiles = 0;
+        std::atomic<u32> numPendingNavTiles = 0;
+        std::atomic<u32> numPendingValidationBatches = 0;
+
+        u32 maxResidentSources = std::numeric_limits<u32>::max();
+        std::atomic<u32> numResidentSources = 0;
+        std::atomic<u32> peakResidentSources = 0;
+
+        void AddResidentSource()
+        {
+            const u32 numResident = numResidentSources.fetch_add(1, std::memory_order_relaxed) + 1;
+            u32 peak = peakResidentSources.load(std::memory_order_relaxed);
+            while (numResident > peak && !peakResidentSources.compare_exchange_weak(peak, numResident, std::memory_order_relaxed))
+            {
+            }
+        }
+
+        void RemoveResidentSource()
+        {
+            numResidentSources.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        // Soft limit, new tiles are only held back while other work can still free sources
+        bool IsOverSourceBudget() const
+        {
+            if (numResidentSources.load(std::memory_order_relaxed) < maxResidentSources)
+                return false;
+
+            const u32 numStarted = std::min(nextWorkItem.load(std::memory_order_relaxed), numWorkItems);
+            const bool hasTilesInFlight = numStarted > numCompletedTiles.load(std::memory_order_relaxed);
+            return hasTilesInFlight || numPendingNavTiles.load(std::memory_order_relaxed) > 0;
+        }
+
+        bool IsFinished() const
+        {
+            return numCompletedTiles.load(std::memory_order_acquire) >= numWorkItems &&
+                numPendingNavTiles.load(std::memory_order_acquire) == 0 &&
+                numPendingValidationBatches.load(std::memory_order_acquire) == 0;
+        }
+    };
+}
+
+vec2 GetCellVertexPosition(u32 cellID, u32 vertexID)
+{
+    const i32 cellX = ((cellID % Terrain::CHUNK_NUM_CELLS_PER_STRIDE));
+    const i32 cellY = ((cellID / Terrain::CHUNK_NUM_CELLS_PER_STRIDE));
+
+    const i32 vX = vertexID % 17;
+    const i32 vY = vertexID / 17;
+
+    bool isOddRow = vX > 8;
+
+    vec2 vertexOffset;
+    vertexOffset.x = -(8.5f * isOddRow);
+    vertexOffset.y = (0.5f * isOddRow);
+
+    ivec2 globalVertex = ivec2(vX + cellX * 8, vY + cellY * 8);
+
+    vec2 finalPos = (vec2(globalVertex) + vertexOffset) * Terrain::PATCH_SIZE;
+
+    return vec2(finalPos.x, -finalPos.y);
+}
+
+namespace
+{
+    bool HasTileSources(const Adt::Wdt& wdt, u32 chunkID, bool extractMapAssets)
+    {
+        u32 originalChunkGridPosX = chunkID % 64;
+        u32 originalChunkGridPosY = chunkID / 64;
+
+        const Adt::MAIN::AreaInfo& areaInfo = wdt.main.areaInfos[originalChunkGridPosX][originalChunkGridPosY];
+        if (!areaInfo.flags.IsUsed)
+            return false;
+
+        const Adt::MAID::FileIDs& fileIDs = wdt.maid.fileIDs[originalChunkGridPosX][originalChunkGridPosY];
+        if (fileIDs.adtRootFileID == 0 ||
+            (extractMapAssets && (fileIDs.adtTextureFileID == 0 || fileIDs.adtObject1FileID == 0)))
+        {
+            return false;
+        }
+
+        return true;
+    }
+
+    bool PrefetchMapTile(CascLoader* cascLoader, bool loadObjectFiles, PrefetchedTile& tile)
+    {
+        ZoneScopedN("MapExtractor::Process::PrefetchMapTile");
+
+        u32 originalChunkGridPosX = tile.chunkID % 64;
+        u32 originalChunkGridPosY = tile.chunkID / 64;
+
+        const Adt::MAID::FileIDs& fileIDs = tile.mapContext->wdt.maid.fileIDs[originalChunkGridPosX][originalChunkGridPosY];
+        tile.rootBuffer = cascLoader->GetFileByID(fileIDs.adtRootFileID);
+        if (!tile.rootBuffer)
+            return false;
+
+        if (loadObjectFiles)
+        {
+            tile.textBuffer = cascLoader->GetFileByID(fileIDs.adtTextureFileID);
+            tile.objBuffer = cascLoader->GetFileByID(fileIDs.adtObject1FileID);
+        }
+
+        return true;
+    }
+
+    bool ParseMapTile(PrefetchedTile& tile, TileScratch& scratch, ParsedTile& parsedTile)
+    {
+        ZoneScopedN("MapExtractor::Process::ParseMapTile");
+
+        u32 chunkGridPosX = tile.chunkID / 64;
+        u32 chunkGridPosY = tile.chunkID % 64;
+        u32 newChunkID = chunkGridPosX + (chunkGridPosY * Terrain::CHUNK_NUM_PER_MAP_STRIDE);
+
+        parsedTile.mapContext = tile.mapContext;
+        parsedTile.chunkID = tile.chunkID;
+        parsedTile.adt = std::make_unique<Adt::Layout>();
+
+        Adt::Layout& adt = *parsedTile.adt;
+        {
+            adt.mapID = tile.mapContext->id;
+            adt.chunkID = newChunkID;
+        }
+
+        Adt::Parser::Context context = { };
+        return scratch.adtParser.TryParse(context, tile.rootBuffer, tile.textBuffer, tile.objBuffer, tile.mapContext->wdt, adt);
+    }
+
+    // Terrain vertices lie on a regular grid with half a patch spacing, outer vertices on even rows and
+    // columns and the patch centers on odd ones. Jolt wants the sample count to be a multiple of its
+    // block size, so the 257 sample grid is padded with one row and column of holes.
+    //
+    // The grid does not reproduce the ADT triangulation exactly. A patch is four triangles fanned from its
+    // center to its edges, while Jolt splits every quad of the grid along the same diagonal. Only two of the
+    // four quads of a patch get the center to corner diagonal, the other two are split between the edge
+    // midpoints and deviate by up to |hCenter + hCorner - hMid0 - hMid1| / 2 at the quad center. Chunks where
+    // that exceeds TERRAIN_HEIGHTFIELD_MAX_ERROR keep the triangle mesh shape.
+    constexpr u32 TERRAIN_HEIGHTFIELD_GRID_SIZE = Terrain::CHUNK_NUM_CELLS_PER_STRIDE * Terrain::CELL_NUM_PATCHES_PER_STRIDE * 2 + 1;
+    constexpr u32 TERRAIN_HEIGHTFIELD_BLOCK_SIZE = 2;
+    constexpr u32 TERRAIN_HEIGHTFIELD_SAMPLE_COUNT = TERRAIN_HEIGHTFIELD_GRID_SIZE + 1;
+    constexpr f32 TERRAIN_HEIGHTFIELD_MAX_ERROR = 0.01f;
+    static_assert(TERRAIN_HEIGHTFIELD_SAMPLE_COUNT % TERRAIN_HEIGHTFIELD_BLOCK_SIZE == 0);
+
+    f32 GetOuterVertexHeight(const Map::Chunk& chunk, u32 patchX, u32 patchY)
+    {
+        constexpr u32 lastCell = Terrain::CHUNK_NUM_CELLS_PER_STRIDE - 1;
+        const u32 cellX = std::min(patchX / Terrain::CELL_NUM_PATCHES_PER_STRIDE, lastCell);
+        const u32 cellY = std::min(patchY / Terrain::CELL_NUM_PATCHES_PER_STRIDE, lastCell);
+        const u32 vertexX = patchX - (cellX * Terrain::CELL_NUM_PATCHES_PER_STRIDE);
+        const u32 vertexY = patchY - (cellY * Terrain::CELL_NUM_PATCHES_PER_STRIDE);
+
+        return chunk.cellsData.heightField[cellX + (cellY * Terrain::CHUNK_NUM_CELLS_PER_STRIDE)][vertexX + (vertexY * Terrain::CELL_GRID_ROW_SIZE)];
+    }
+
+    f32 GetInnerVertexHeight(const Map::Chunk& chunk, u32 patchX, u32 patchY, bool& isHole)
+    {
+        const u32 cellX = patchX / Terrain::CELL_NUM_PATCHES_PER_STRIDE;
+        const u32 cellY = patchY / Terrain::CELL_NUM_PATCHES_PER_STRIDE;
+        const u32 cellID = cellX + (cellY * Terrain::CHUNK_NUM_CELLS_PER_STRIDE);
+        const u32 patchColumn = patchX % Terrain::CELL_NUM_PATCHES_PER_STRIDE;
+        const u32 patchRow = patchY % Terrain::CELL_NUM_PATCHES_PER_STRIDE;
+
+        const u32 patchID = patchColumn + (patchRow * Terrain::CELL_NUM_PATCHES_PER_STRIDE);
+        isHole = (chunk.cellsData.holes[cellID] & (1ull << patchID)) != 0;
+
+        return chunk.cellsData.heightField[cellID][Terrain::CELL_OUTER_GRID_STRIDE + patchColumn + (patchRow * Terrain::CELL_GRID_ROW_SIZE)];
+    }
+
+    // Largest height difference between Jolt's split of each quad and the other diagonal, quads touching a hole
+    // are dropped by Jolt and don't count
+    f32 GetHeightFieldTriangulationError(const std::vector<f32>& samples)
+    {
+        f32 maxError = 0.0f;
+        for (u32 sampleY = 0; sampleY + 1 < TERRAIN_HEIGHTFIELD_GRID_SIZE; sampleY++)
+        {
+            for (u32 sampleX = 0; sampleX + 1 < TERRAIN_HEIGHTFIELD_GRID_SIZE; sampleX++)
+            {
+                // Jolt splits along (x, y) - (x + 1, y + 1), which passes through the patch center exactly when
+                // x and y share their parity (the flipped rows keep the parity as the grid size is odd)
+                if ((sampleX & 1) == (sampleY & 1))
+                    continue;
+
+                const f32 h00 = samples[sampleX + (sampleY * TERRAIN_HEIGHTFIELD_SAMPLE_COUNT)];
+                const f32 h10 = samples[sampleX + 1 + (sampleY * TERRAIN_HEIGHTFIELD_SAMPLE_COUNT)];
+                const f32 h01 = samples[sampleX + ((sampleY + 1) * TERRAIN_HEIGHTFIELD_SAMPLE_COUNT)];
+                const f32 h11 = samples[sampleX + 1 + ((sampleY + 1) * TERRAIN_HEIGHTFIELD_SAMPLE_COUNT)];
+
+                constexpr f32 noCollision = JPH::HeightFieldShapeConstants::cNoCollisionValue;
+                if (h00 == noCollision || h10 == noCollision || h01 == noCollision || h11 == noCollision)
+                    continue;
+
+                maxError = std::max(maxError, std::abs(h00 + h11 - h01 - h10) * 0.5f);
+            }
+        }
+
+        return maxError;
+    }
+
+    // Returns nullptr when the height field can't stay within TERRAIN_HEIGHTFIELD_MAX_ERROR of the terrain surface
+    JPH::ShapeRefC CreateTerrainHeightFieldShape(const Map::Chunk& chunk)
+    {
+        std::vector<f32> samples(TERRAIN_HEIGHTFIELD_SAMPLE_COUNT * TERRAIN_HEIGHTFIELD_SAMPLE_COUNT, JPH::HeightFieldShapeConstants::cNoCollisionValue);
+
+        for (u32 gridY = 0; gridY < TERRAIN_HEIGHTFIELD_GRID_SIZE; gridY++)
+        {
+            // Terrain extends towards -Z while Jolt needs a positive scale, so rows are stored flipped
+            f32* row = &samples[(TERRAIN_HEIGHTFIELD_GRID_SIZE - 1 - gridY) * TERRAIN_HEIGHTFIELD_SAMPLE_COUNT];
+            const u32 patchY = gridY / 2;
+            const bool isOddRow = (gridY & 1) != 0;
+
+            for (u32 gridX = 0; gridX < TERRAIN_HEIGHTFIELD_GRID_SIZE; gridX++)
+            {
+                const u32 patchX = gridX / 2;
+                const bool isOddColumn = (gridX & 1) != 0;
+
+                if (isOddRow && isOddColumn)
+                {
+                    // Every quad of a patch touches its center, so a hole only needs to remove that one sample
+                    bool isHole = false;
+                    const f32 height = GetInnerVertexHeight(chunk, patchX, patchY, isHole);
+                    if (!isHole)
+                        row[gridX] = height;
+                }
+                else if (isOddRow)
+                {
+                    row[gridX] = 0.5f * (GetOuterVertexHeight(chunk, patchX, patchY) + GetOuterVertexHeight(chunk, patchX, patchY + 1));
+                }
+                else if (isOddColumn)
+                {
+                    row[gridX] = 0.5f * (GetOuterVertexHeight(chunk, patchX, patchY) + GetOuterVertexHeight(chunk, patchX + 1, patchY));
+                }
+                else
+                {
+                    row[gridX] = GetOuterVertexHeight(chunk, patchX, patchY);
+                }
+            }
+        }
+
+        // Whatever the triangulation leaves of the error budget goes to the sample quantization
+        const f32 triangulationError = GetHeightFieldTriangulationError(samples);
+        if (triangulationError > TERRAIN_HEIGHTFIELD_MAX_ERROR)
+            return nullptr;
+
+        constexpr f32 sampleSpacing = Terrain::PATCH_SIZE * 0.5f;
+        JPH::HeightFieldShapeSettings shapeSettings(samples.data(), JPH::Vec3(0.0f, 0.0f, -Terrain::CHUNK_SIZE), JPH::Vec3(sampleSpacing, 1.0f, sampleSpacing), TERRAIN_HEIGHTFIELD_SAMPLE_COUNT);
+        shapeSettings.mBlockSize = TERRAIN_HEIGHTFIELD_BLOCK_SIZE;
+        shapeSettings.mBitsPerSample = shapeSettings.CalculateBitsPerSampleForError(TERRAIN_HEIGHTFIELD_MAX_ERROR - triangulationError);
+
+        JPH::ShapeSettings::ShapeResult shapeResult = shapeSettings.Create();
+        if (shapeResult.HasError())
+        {
+            NC_LOG_ERROR("[Map Extractor] Failed to create terrain height field shape: {0}", shapeResult.GetError().c_str());
+            return nullptr;
+        }
+
+        return shapeResult.Get();
+    }
+
+    JPH::ShapeRefC CreateTerrainMeshShape(const Map::Chunk& chunk)
+    {
+        constexpr u32 numVerticesPerChunk = Terrain::CHUNK_NUM_CELLS * Terrain::CELL_TOTAL_GRID_SIZE;
+        constexpr u32 numTrianglePerChunk = Terrain::CHUNK_NUM_CELLS * Terrain::CELL_NUM_TRIANGLES;
+
+        JPH::VertexList vertexList;
+        JPH::IndexedTriangleList triangleList;
+        vertexList.reserve(numVerticesPerChunk);
+        triangleList.reserve(numTrianglePerChunk);
+
+        u32 patchVertexIDs[5] = { 0 };
+        uvec2 triangleComponentOffsets = uvec2(0, 0);
+
+        for (u32 cellID = 0; cellID < Terrain::CHUNK_NUM_CELLS; cellID++)
+        {
+            for (u32 i = 0; i < Terrain::CELL_TOTAL_GRID_SIZE; i++)
+            {
+                f32 height = chunk.cellsData.heightField[cellID][i];
+
+                vec2 pos = GetCellVertexPosition(cellID, i);
+                assert(pos.x <= Terrain::CHUNK_SIZE);
+                assert(pos.y <= Terrain::CHUNK_SIZE);
+
+                vertexList.push_back({ pos.x, height, pos.y });
+            }
+
+            const u32 cellVertexOffset = cellID * Terrain::CELL_TOTAL_GRID_SIZE;
+            const u64 holeData = chunk.cellsData.holes[cellID];
+            for (u32 i = 0; i < Terrain::CELL_NUM_TRIANGLES; i++)
+            {
+                u32 triangleID = i;
+                u32 patchID = triangleID / 4;
+                u32 patchRow = patchID / 8;
+                u32 patchColumn = patchID % 8;
+
+                // Top Left is calculated like this
+                patchVertexIDs[0] = patchColumn + (patchRow * Terrain::CELL_GRID_ROW_SIZE);
+
+                // Top Right is always +1 from Top Left
+                patchVertexIDs[1] = patchVertexIDs[0] + 1;
+
+                // Bottom Left is always NUM_VERTICES_PER_PATCH_ROW from the Top Left vertex
+                patchVertexIDs[2] = patchVertexIDs[0] + Terrain::CELL_GRID_ROW_SIZE;
+
+                // Bottom Right is always +1 from Bottom Left
+                patchVertexIDs[3] = patchVertexIDs[2] + 1;
+
+                // Center is always NUM_VERTICES_PER_OUTER_PATCH_ROW from Top Left
+                patchVertexIDs[4] = patchVertexIDs[0] + Terrain::CELL_OUTER_GRID_STRIDE;
+
+                u32 triangleWithinPatch = triangleID % 4; // 0 - top, 1 - left, 2 - bottom, 3 - right
+                triangleComponentOffsets = uvec2(triangleWithinPatch > 1, // Identify if we are within bottom or right triangle
+                    triangleWithinPatch == 0 || triangleWithinPatch == 3); // Identify if we are within the top or right triangle
+
+                u32 vertexID1 = cellVertexOffset + patchVertexIDs[4];
+                u32 vertexID2 = cellVertexOffset + patchVertexIDs[triangleComponentOffsets.x * 2 + triangleComponentOffsets.y];
+                u32 vertexID3 = cellVertexOffset + patchVertexIDs[(!triangleComponentOffsets.y) * 2 + triangleComponentOffsets.x];
+
+                if ((holeData & (1ull << patchID)) != 0)
+                    continue;
+
+                triangleList.push_back({ vertexID3, vertexID2, vertexID1 });
+            }
+        }
+
+        JPH::MeshShapeSettings shapeSetting(vertexList, triangleList);
+        JPH::ShapeSettings::ShapeResult shapeResult = shapeSetting.Create();
+        if (shapeResult.HasError())
+        {
+            NC_LOG_ERROR("[Map Extractor] Failed to create terrain mesh shape: {0}", shapeResult.GetError().c_str());
+            return nullptr;
+        }
+
+        return shapeResult.Get();
+    }
+
+    void AddNavMeshObjects(CascLoader* cascLoader, MapContext& mapContext, u32 chunkX, u32 chunkY, const std::vector<Terrain::Placement>& modelPlacements)
+    {
+        ZoneScopedN("MapExtractor::Process::AddNavMeshObjects");
+
+        std::vector<NavMesh::ObjectPlacement> objects;
+        objects.reserve(modelPlacements.size());
+
+        for (const Terrain::Placement& placementInfo : modelPlacements)
+        {
+            // The name hash still holds the placement's file ID at this point
+            if (placementInfo.nameHash == 0 ||
+                placementInfo.nameHash == std::numeric_limits<u64>().max())
+                continue;
+
+            std::shared_ptr<const NavMesh::CollisionMesh> mesh = mapContext.collisionMeshes->Get(cascLoader, static_cast<u32>(placementInfo.nameHash));
+            if (!mesh)
+                continue;
+
+            NavMesh::ObjectPlacement& object = objects.emplace_back();
+            object.mesh = std::move(mesh);
+            object.uniqueID = placementInfo.uniqueID;
+            object.position = placementInfo.position;
+            object.rotation = placementInfo.rotation;
+            object.scale = static_cast<f32>(placementInfo.scale) / 1024.0f;
+        }
+
+        if (!mapContext.navSources.AddObjects(chunkX, chunkY, objects))
+        {
+            NC_LOG_ERROR("[Map Extractor] Failed to retain NavMesh objects for Map Tile ({}_{}_{})", mapContext.internalName, chunkX, chunkY);
+        }
+    }
+
+    void ConvertMapTile(Runtime* runtime, CascLoader* cascLoader, MapContext& mapContext, u32 chunkID, Adt::Layout& adt, const ExtractionSettings& settings, TileScratch& scratch)
+    {
+        ZoneScopedN("MapExtractor::Process::ConvertMapTile");
+
+        const std::string& internalName = mapContext.internalName;
+        const Adt::Wdt& wdt = mapContext.wdt;
+        const bool extractMapAssets = settings.extractMapAssets;
+        const bool generateNavMesh = settings.generateNavMesh;
+
+        u32 chunkGridPosX = chunkID / 64;
+        u32 chunkGridPosY = chunkID % 64;
+
+        // Post Processing
+        if (extractMapAssets)
+        {
+            auto& liquidObjects = ClientDBExtractor::liquidObjectStorage;
+            auto& liquidTypes = ClientDBExtractor::liquidTypeStorage;
+            auto& liquidMaterials = ClientDBExtractor::liquidMaterialStorage;
+
+            u32 numInstances = static_cast<u32>(adt.mh2o.instances.size());
+            for (u32 i = 0; i < numInstances; i++)
+            {
+                auto& liquidInstance = adt.mh2o.instances[i];
+                u16 liquidVertexFormat = liquidInstance.liquidVertexFormat;
+
+                if (liquidVertexFormat >= 42)
+                {
+                    if (liquidInstance.liquidType == 2)
+                    {
+                        liquidVertexFormat = 2;
+                    }
+                    else
+                    {
+                        i16 liquidTypeID = -1;
+
+                        if (liquidObjects.Has(liquidVertexFormat))
+                        {
+                            auto& liquidObject = liquidObjects.Get<MetaGen::Shared::ClientDB::LiquidObjectRecord>(liquidVertexFormat);
+                            liquidTypeID = liquidObject.liquidTypeID;
+                        }
+                        else
+                        {
+                            liquidTypeID = liquidInstance.liquidType;
+                        }
+
+                        if (liquidTypes.Has(liquidTypeID))
+                        {
+                            auto& liquidType = liquidTypes.Get<MetaGen::Shared::ClientDB::LiquidTypeRecord>(liquidTypeID);
+
+                            if (liquidMaterials.Has(liquidType.materialID))
+                            {
+                                auto& liquidMaterial = liquidMaterials.Get<MetaGen::Shared::ClientDB::LiquidMaterialRecord>(liquidType.materialID);
+                                liquidVertexFormat = liquidMaterial.liquidVertexFormat;
+                            }
+                        }
+                    }
+
+                }
+
+                if (liquidInstance.vertexDataOffset == 0 && liquidInstance.liquidType != 2)
+                {
+                    liquidVertexFormat = 2;
+                }
+
+                if (liquidVertexFormat == 2)
+                {
+                    liquidInstance.width = 8;
+                    liquidInstance.height = 8;
+                    liquidInstance.offsetX = 0;
+                    liquidInstance.offsetY = 0;
+                }
+
+                liquidInstance.liquidVertexFormat = liquidVertexFormat;
+
+                if (liquidInstance.liquidVertexFormat == 2)
+                    liquidInstance.vertexDataOffset = std::numeric_limits<u32>().max();
+            }
+        }
+
+        if (generateNavMesh && !extractMapAssets && !settings.includeNavMeshObjects)
+        {
+            if (!mapContext.navSources.Add(chunkGridPosX, chunkGridPosY, adt))
+            {
+                NC_LOG_ERROR("[Map Extractor] Failed to retain NavMesh source for Map Tile ({}_{}_{})", internalName, chunkGridPosX, chunkGridPosY);
+            }
+            return;
+        }
+
+        Map::Chunk chunk = { };
+        std::vector<Terrain::Placement> modelPlacements;
+        Map::LiquidInfo liquidInfo;
+        std::vector<u8> physicsData;
+        if (!Map::Chunk::FromADT(adt, chunk, modelPlacements, liquidInfo))
+            return;
+
+        if (generateNavMesh)
+        {
+            if (!mapContext.navSources.Add(chunkGridPosX, chunkGridPosY, chunk))
+            {
+                NC_LOG_ERROR("[Map Extractor] Failed to retain NavMesh source for Map Tile ({}_{}_{})", internalName, chunkGridPosX, chunkGridPosY);
+            }
+
+            if (settings.includeNavMeshObjects)
+                AddNavMeshObjects(cascLoader, mapContext, chunkGridPosX, chunkGridPosY, modelPlacements);
+        }
+
+        if (!extractMapAssets)
+            return;
+
+        // Post Processing
+        {
+            for (u32 i = 0; i < modelPlacements.size(); i++)
+            {
+                Terrain::Placement& placementInfo = modelPlacements[i];
+
+                if (placementInfo.nameHash == 0 ||
+                    placementInfo.nameHash == std::numeric_limits<u64>().max())
+                    continue;
+
+                u32 placementFileID = static_cast<u32>(placementInfo.nameHash);
+                if (!cascLoader->InCascAndListFile(placementFileID))
+                {
+                    NC_LOG_ERROR("Skipped model placement because file doesn't exist");
+                    continue;
+                }
+
+                const std::string& modelPathStr = cascLoader->GetFilePathFromListFileID(placementFileID);
+                std::filesystem::path modelPath = std::filesystem::path("model") / std::filesystem::path(modelPathStr).replace_extension(Model::FILE_EXTENSION);
+                modelPath.make_preferred();
+                std::string modelPathHashStr = modelPath.string();
+                std::transform(modelPathHashStr.begin(), modelPathHashStr.end(), modelPathHashStr.begin(), ::tolower);
+                std::replace(modelPathHashStr.begin(), modelPathHashStr.end(), '\\', '/');
+
+                u64 nameHash = XXHash64::hash(modelPathHashStr.c_str(), modelPathHashStr.size(), 0);
+                placementInfo.nameHash = nameHash;
+            }
+
+            // Layer 1, 2 and 3 are written to the r, g and b channels of the BGRA pixels
+            static const u8 emptyAlphaLayer[Terrain::CHUNK_ALPHAMAP_CELL_RESOLUTION] = { };
+
+            // Every cell writes all of its pixels below, so the buffer does not need to be cleared
+            std::shared_ptr<Bytebuffer> alphaMapBuffer = Bytebuffer::Borrow<Terrain::CHUNK_ALPHAMAP_TOTAL_BYTE_SIZE>();
+
+            bool isAlphaMapSet = false;
+
+            for (u16 i = 0; i < Terrain::CHUNK_NUM_CELLS; i++)
+            {
+                u16 cellIndex = i;
+
+                const u32 numLayers = static_cast<u32>(adt.cellInfos[i].mcly.data.size());
+                const u8* layerAlpha[3] = { emptyAlphaLayer, emptyAlphaLayer, emptyAlphaLayer };
+
+                for (u32 j = 0; j < 4; j++)
+                {
+                    u32 fileID = static_cast<u32>(chunk.cellsData.layerTextureIDs[cellIndex][j]);
+                    if (fileID == 0 || fileID == std::numeric_limits<u32>().max())
+                        continue;
+
+                    std::filesystem::path texturePath = cascLoader->GetFilePathFromListFileID(fileID);
+                    if (texturePath.empty())
+                    {
+                        chunk.cellsData.layerTextureIDs[cellIndex][j] = std::numeric_limits<u64>().max();
+                        continue;
+                    }
+
+                    texturePath = std::filesystem::path("texture") / texturePath;
+                    texturePath.replace_extension("dds").make_preferred();
+
+                    std::string texturePathStr = texturePath.string();
+                    std::transform(texturePathStr.begin(), texturePathStr.end(), texturePathStr.begin(), ::tolower);
+                    std::replace(texturePathStr.begin(), texturePathStr.end(), '\\', '/');
+
+                    u64 textureNameHash = XXHash64::hash(texturePathStr.c_str(), texturePathStr.length(), 0);
+                    chunk.cellsData.layerTextureIDs[cellIndex][j] = textureNameHash;
+
+                    // If the layer has alpha data, add it to our per-chunk alphamap
+                    if (j > 0 && (j - 1) < adt.cellInfos[i].mcal.data.size())
+                    {
+                        layerAlpha[j - 1] = &adt.cellInfos[i].mcal.data[j - 1].alphaMap[0];
+                    }
+                }
+
+                u32* cellPixels = reinterpret_cast<u32*>(alphaMapBuffer->GetDataPointer()) + (i * Terrain::CHUNK_ALPHAMAP_CELL_RESOLUTION);
+                const u8* red = layerAlpha[0];
+                const u8* green = layerAlpha[1];
+                const u8* blue = layerAlpha[2];
+
+                u32 anyAlpha = 0;
+
+                if (!wdt.mphd.flags.UseBigAlpha && numLayers > 1)
+                {
+                    // Convert Old Alpha to New Alpha, this is the integer form of mixing (1,0,0,0) towards g, b and a by each layer in turn:
+                    // r' = r(1-g)(1-b), g' = g(1-b), b' = b, a' = 1/255 with both divisions rounded to nearest
+                    for (u32 pixel = 0; pixel < Terrain::CHUNK_ALPHAMAP_CELL_RESOLUTION; pixel++)
+                    {
+                        const u32 r = red[pixel];
+                        const u32 g = green[pixel];
+                        const u32 b = blue[pixel];
+                        anyAlpha |= r | g | b;
+
+                        const u32 invB = 255 - b;
+                        const u32 newRed = ((r * (255 - g) * invB) + 32512) / 65025;
+                        const u32 newGreen = ((g * invB) + 127) / 255;
+
+                        cellPixels[pixel] = (1u << 24) | (newRed << 16) | (newGreen << 8) | b;
+                    }
+                }
+                else
+                {
+                    for (u32 pixel = 0; pixel < Terrain::CHUNK_ALPHAMAP_CELL_RESOLUTION; pixel++)
+                    {
+                        const u32 r = red[pixel];
+                        const u32 g = green[pixel];
+                        const u32 b = blue[pixel];
+                        anyAlpha |= r | g | b;
+
+                        cellPixels[pixel] = (r << 16) | (g << 8) | b;
+                    }
+                }
+
+                isAlphaMapSet |= anyAlpha != 0;
+            }
+
+            std::string localChunkBlendMapPath = "texture/blendmaps/" + internalName + "/" + internalName + "_" + std::to_string(chunkGridPosX) + "_" + std::to_string(chunkGridPosY) + ".dds";
+            chunk.chunkAlphaMapTextureHash = (XXHash64::hash(localChunkBlendMapPath.c_str(), localChunkBlendMapPath.length(), 0) * isAlphaMapSet) + (std::numeric_limits<u64>().max() * !isAlphaMapSet);
+
+            if (isAlphaMapSet)
+            {
+                BLP::BlpConvert blpConvert;
+                scratch.outBytes.clear();
+
+                if (!blpConvert.ConvertRawToBC1Buffer(64, 64, Terrain::CHUNK_NUM_CELLS, alphaMapBuffer->GetDataPointer(), Terrain::CHUNK_ALPHAMAP_TOTAL_BYTE_SIZE, scratch.outBytes))
+                {
+                    runtime->pactInfo.MarkFailed();
+                    NC_LOG_ERROR("[Map Extractor] Failed to convert blend map {0}", localChunkBlendMapPath);
+                    return;
+                }
+
+                auto& manifest = runtime->pactInfo.GetManifestForFile(runtime, scratch.outBytes.size());
+                if (!manifest.AddFile(runtime, localChunkBlendMapPath, scratch.outBytes))
+                {
+                    NC_LOG_ERROR("[Map Extractor] Failed to add blend map {0} to PACT storage", localChunkBlendMapPath);
+                    return;
+                }
+            }
+
+            // if build physics shapes
+            {
+                JPH::ShapeRefC shape = settings.useMeshTerrainPhysics ? nullptr : CreateTerrainHeightFieldShape(chunk);
+                const bool isMeshShape = shape == nullptr;
+                if (isMeshShape)
+                    shape = CreateTerrainMeshShape(chunk);
+
+                if (shape)
+                {
+                    JPH::Shape::ShapeToIDMap shapeMap;
+                    JPH::Shape::MaterialToIDMap materialMap;
+
+                    std::shared_ptr<Bytebuffer> joltChunkBuffer = isMeshShape ? Bytebuffer::Borrow<16777216>() : Bytebuffer::Borrow<1048576>();
+                    JoltStream joltStream(joltChunkBuffer);
+                    shape->SaveWithChildren(joltStream, shapeMap, materialMap);
+
+                    if (!joltStream.IsFailed() && joltChunkBuffer->writtenData > 0)
+                    {
+                        physicsData.resize(joltChunkBuffer->writtenData);
+                        memcpy(&physicsData[0], joltChunkBuffer->GetDataPointer(), joltChunkBuffer->writtenData);
+                    }
+                }
+            }
+
+            scratch.buffer->Reset();
+            if (chunk.Save(scratch.buffer, modelPlacements, liquidInfo, physicsData))
+            {
+                std::string localChunkPath = "map/" + internalName + "/" + internalName + "_" + std::to_string(chunkGridPosX) + "_" + std::to_string(chunkGridPosY) + Map::CHUNK_FILE_EXTENSION;
+
+                auto& manifest = runtime->pactInfo.GetManifestForFile(runtime, scratch.buffer->writtenData);
+                if (manifest.AddFile(runtime, localChunkPath, scratch.buffer))
+                {
+                    u64 hash = XXHash64::hash(localChunkPath.c_str(), localChunkPath.length(), 0);
+                    mapContext.chunkHashes.enqueue(hash);
+                }
+                else
+                {
+                    NC_LOG_ERROR("[Map Extractor] Failed to add Map Tile to PACT storage ({}_{}_{})", internalName, chunkGridPosX, chunkGridPosY);
+                }
+            }
+            else
+            {
+                NC_LOG_ERROR("[Map Extractor] Failed to save Map Tile ({}_{}_{})", internalName, chunkGridPosX, chunkGridPosY);
+            }
+        }
+    }
+
+    void SaveMapHeader(Runtime* runtime, const std::string& internalName, Map::MapHeader& mapHeader)
+    {
+        std::shared_ptr<Bytebuffer> buffer = Bytebuffer::Borrow<1048576>();
+        if (mapHeader.Save(buffer))
+        {
+            std::string mapHeaderPath = "map/" + internalName + "/" + internalName + Map::HEADER_FILE_EXTENSION;
+            auto& manifest = runtime->pactInfo.GetManifestForFile(runtime, buffer->writtenData);
+            if (manifest.AddFile(runtime, mapHeaderPath, buffer))
+            {
+                NC_LOG_INFO("[Map Extractor] Extracted {0}", internalName);
+            }
+            else
+            {
+                NC_LOG_WARNING("[Map Extractor] Failed to add {0} to PACT storage", internalName);
+            }
+        }
+        else
+        {
+            NC_LOG_WARNING("[Map Extractor] Failed to extract {0}", internalName);
+        }
+    }
+
+    u32 GetNavTileID(u32 chunkID)
+    {
+        // Work items use the WDT's column major index, NavMesh tiles are addressed row major
+        u32 chunkGridPosX = chunkID / 64;
+        u32 chunkGridPosY = chunkID % 64;
+        return chunkGridPosX + (chunkGridPosY * Terrain::CHUNK_NUM_PER_MAP_STRIDE);
+    }
+
+    template <typename Func>
+    void ForEachNavTileNeighbour(u32 tileID, Func&& func)
+    {
+        constexpr i32 stride = static_cast<i32>(Terrain::CHUNK_NUM_PER_MAP_STRIDE);
+        const i32 tileX = static_cast<i32>(tileID % Terrain::CHUNK_NUM_PER_MAP_STRIDE);
+        const i32 tileY = static_cast<i32>(tileID / Terrain::CHUNK_NUM_PER_MAP_STRIDE);
+
+        for (i32 neighbourY = std::max(0, tileY - 1); neighbourY <= std::min(stride - 1, tileY + 1); neighbourY++)
+        {
+            for (i32 neighbourX = std::max(0, tileX - 1); neighbourX <= std::min(stride - 1, tileX + 1); neighbourX++)
+            {
+                func(static_cast<u32>(neighbourX + (neighbourY * stride)));
+            }
+        }
+    }
+
+    std::filesystem::path GetNavContainerPath(const MapContext& mapContext, const NavAgentOutput& agentOutput)
+    {
+        return agentOutput.outputDirectory / (mapContext.internalName + NavMesh::Container::FILE_EXTENSION);
+    }
+
+    std::filesystem::path GetNavTileCacheLayersPath(const MapContext& mapContext, const NavAgentOutput& agentOutput, u32 chunkX, u32 chunkY)
+    {
+        return agentOutput.outputDirectory / (mapContext.internalName + "_" + std::to_string(chunkX) + "_" + std::to_string(chunkY) + NavMesh::TileCache::LAYERS_FILE_EXTENSION);
+    }
+
+    void LogMapNavMeshPerformance(const MapContext& mapContext, f64 validationSeconds)
+    {
+        const std::string& internalName = mapContext.internalName;
+        const NavMesh::BuildTimings& buildTimings = mapContext.navMeshBuildTimings;
+        NC_LOG_INFO("[NavMesh Performance] {}: source {}s, build {}s, validation {}s, {} tiles for {} agents", internalName, mapContext.terrainExtractionSeconds, mapContext.navMeshBuildSeconds, validationSeconds, mapContext.numBuiltNavTiles, mapContext.navAgents.size());
+        NC_LOG_INFO("[NavMesh Build Phases] {} worker-seconds: total {}, raster {}, compact {}, regions {}, contours {}, polymesh {}, detail {}, Detour/output {}, TileCache {}", internalName, buildTimings.totalSeconds, buildTimings.rasterizationSeconds, buildTimings.compactHeightfieldSeconds, buildTimings.regionSeconds, buildTimings.contourSeconds, buildTimings.polyMeshSeconds, buildTimings.detailMeshSeconds, buildTimings.detourAndOutputSeconds, buildTimings.tileCacheSeconds);
+    }
+
+    void FinishMapValidation(MapContext& mapContext, const ExtractionSettings& settings)
+    {
+        for (std::unique_ptr<NavAgentOutput>& agentOutput : mapContext.navAgents)
+        {
+            if (!agentOutput->seamValidator)
+                continue;
+
+            const std::string& label = agentOutput->label;
+            if (settings.validateNavMesh)
+            {
+                const NavMesh::SeamValidationResult validation = agentOutput->seamValidator->GetResult();
+                if (validation.failedPairs == 0)
+                {
+                    NC_LOG_INFO("[NavMesh Validator] {} validated {} traversable seams across {} adjacent tile pairs ({} non-traversable)", label, validation.validatedPairs, validation.adjacentPairs, validation.skippedPairs);
+                }
+                else
+                {
+                    NC_LOG_ERROR("[NavMesh Validator] {} failed {} of {} adjacent seam checks", label, validation.failedPairs, validation.adjacentPairs);
+                }
+            }
+
+            if (agentOutput->pathGraphBuilder)
+            {
+                NavMesh::PathGraph::Graph pathGraph;
+                agentOutput->pathGraphBuilder->GetGraph(pathGraph);
+
+                const std::filesystem::path pathGraphPath = agentOutput->outputDirectory / (mapContext.internalName + NavMesh::PathGraph::FILE_EXTENSION);
+                if (NavMesh::PathGraph::WriteFile(pathGraphPath, pathGraph))
+                {
+                    NC_LOG_INFO("[NavMesh PathGraph] {} connected {} seam entrances with {} edges across {} tiles", label, pathGraph.nodes.size(), pathGraph.edges.size(), pathGraph.tiles.size());
+                }
+                else
+                {
+                    NC_LOG_ERROR("[NavMesh PathGraph] Failed to write the path graph for {}", label);
+                }
+            }
+
+            agentOutput->pathGraphBuilder.reset();
+            agentOutput->seamValidator.reset();
+        }
+
+        const f64 validationSeconds = std::chrono::duration<f64>(std::chrono::steady_clock::now() - mapContext.validationStart).count();
+        LogMapNavMeshPerformance(mapContext, validationSeconds);
+    }
+
+    // Runs once the pipeline is done so the queries are timed on an otherwise idle machine
+    void RunNavMeshBenchmarks(const std::vector<std::unique_ptr<MapContext>>& mapContexts, const ExtractionSettings& settings)
+    {
+        for (const std::unique_ptr<MapContext>& mapContext : mapContexts)
+        {
+            for (const std::unique_ptr<NavAgentOutput>& agentOutput : mapContext->navAgents)
+            {
+                const std::filesystem::path containerPath = GetNavContainerPath(*mapContext, *agentOutput);
+                std::error_code error;
+                if (!std::filesystem::exists(containerPath, error))
+                    continue;
+
+                const std::string& label = agentOutput->label;
+                NavMesh::Benchmark::Result result;
+                if (!NavMesh::Benchmark::Run(containerPath, settings.navMeshBenchmarkSettings, result))
+                {
+                    NC_LOG_ERROR("[NavMesh Benchmark] Failed to benchmark {}", label);
+                    continue;
+                }
+
+                const f64 averagePolys = result.numTiles > 0 ? static_cast<f64>(result.numPolys) / static_cast<f64>(result.numTiles) : 0.0;
+                const f64 averageVerts = result.numTiles > 0 ? static_cast<f64>(result.numVerts) / static_cast<f64>(result.numTiles) : 0.0;
+                const u32 maxPolysChunkX = result.maxPolysTileID % Terrain::CHUNK_NUM_PER_MAP_STRIDE;
+                const u32 maxPolysChunkY = result.maxPolysTileID / Terrain::CHUNK_NUM_PER_MAP_STRIDE;
+                NC_LOG_INFO("[NavMesh Benchmark] {}: {} tiles, {} polys ({} per tile, max {} in {}_{}), {} verts ({} per tile, max {}), {} detail tris", label, result.numTiles, result.numPolys, averagePolys, result.maxTilePolys, maxPolysChunkX, maxPolysChunkY, result.numVerts, averageVerts, result.maxTileVerts, result.numDetailTris);
+
+                const std::pair<const char*, const NavMesh::Benchmark::QueryStats*> queryStats[] =
+                {
+                    { "findNearestPoly", &result.nearestPoly },
+                    { "findPath", &result.path },
+                    { "findStraightPath", &result.straightPath },
+                    { "raycast", &result.raycast }
+                };
+
+                for (const auto& [name, stats] : queryStats)
+                {
+                    NC_LOG_INFO("[NavMesh Benchmark] {} {}: {} queries ({} complete), {} queries/s, p50 {}us, p90 {}us, p99 {}us, max {}us", label, name, stats->numQueries, stats->numSucceeded, stats->queriesPerSecond, stats->p50, stats->p90, stats->p99, stats->max);
+                }
+
+                NC_LOG_INFO("[NavMesh Benchmark] {} findPath node pool: {} average, {} peak of {}, {} out of nodes, {} partial paths", label, result.averagePathNodes, result.maxPathNodes, settings.navMeshBenchmarkSettings.maxNodes, result.numOutOfNodes, result.numPartialPaths);
+            }
+        }
+    }
+
+    void FinishMapNavMesh(TilePipeline& pipeline, MapContext& mapContext, const ExtractionSettings& settings)
+    {
+        const std::string& internalName = mapContext.internalName;
+
+        const u32 numThreads = static_cast<u32>(mapContext.navMeshWorkers.size());
+        for (const std::unique_ptr<NavMesh::Worker>& worker : mapContext.navMeshWorkers)
+        {
+            if (worker)
+                mapContext.navMeshBuildTimings.Accumulate(worker->GetBuildTimings());
+        }
+        mapContext.navMeshWorkers.clear();
+        mapContext.navSources.Clear();
+
+        const u32 numQueuedNavTiles = mapContext.numQueuedNavTiles.load(std::memory_order_acquire);
+        if (numQueuedNavTiles == 0)
+        {
+            // Nothing was built, so a container kept from a previous run no longer matches the map
+            if (settings.packNavMeshTiles)
+            {
+                for (const std::unique_ptr<NavAgentOutput>& agentOutput : mapContext.navAgents)
+                {
+                    std::error_code error;
+                    std::filesystem::remove(GetNavContainerPath(mapContext, *agentOutput), error);
+                }
+            }
+
+            NC_LOG_INFO("[NavMesh Performance] {}: source {}s, no terrain tiles", internalName, mapContext.terrainExtractionSeconds);
+            return;
+        }
+
+        mapContext.navMeshBuildSeconds = std::chrono::duration<f64>(std::chrono::steady_clock::now() - mapContext.navMeshBuildStart).count();
+
+        std::vector<std::vector<NavMesh::TileData>> builtNavTiles(mapContext.navAgents.size());
+        for (u32 agentIndex = 0; agentIndex < mapContext.navAgents.size(); agentIndex++)
+        {
+            NavAgentOutput& agentOutput = *mapContext.navAgents[agentIndex];
+            std::vector<NavMesh::TileData>& builtTiles = builtNavTiles[agentIndex];
+            builtTiles.reserve(numQueuedNavTiles);
+
+            NavMesh::TileData builtNavTile;
+            while (agentOutput.builtTiles.try_dequeue(builtNavTile))
+            {
+                builtTiles.push_back(std::move(builtNavTile));
+            }
+            agentOutput.numBuiltTiles = static_cast<u32>(builtTiles.size());
+            mapContext.numBuiltNavTiles += agentOutput.numBuiltTiles;
+
+            // The previous container has to be closed before the new one replaces it
+            agentOutput.previousContainer.reset();
+            if (agentOutput.container)
+            {
+                if (!agentOutput.container->Finish())
+                {
+                    NC_LOG_ERROR("[Map Extractor] Failed to write NavMesh container for {}", agentOutput.label);
+                }
+                agentOutput.container.reset();
+            }
+
+            if (settings.navMeshBuildSettings.buildTileCacheLayers && agentOutput.numBuiltTiles > 0)
+            {
+                NavMesh::TileCache::Params tileCacheParams;
+                NavMesh::GetTileCacheParams(settings.navMeshBuildSettings, agentIndex, tileCacheParams);
+                tileCacheParams.maxTiles = static_cast<i32>(std::max(1u, agentOutput.numTileCacheLayers.load(std::memory_order_relaxed)));
+                tileCacheParams.maxObstacles = settings.tileCacheMaxObstacles;
+
+                const std::filesystem::path paramsPath = agentOutput.outputDirectory / (internalName + NavMesh::TileCache::PARAMS_FILE_EXTENSION);
+                if (!NavMesh::TileCache::WriteParamsFile(paramsPath, tileCacheParams))
+                {
+                    NC_LOG_ERROR("[Map Extractor] Failed to write NavMesh TileCache parameters for {}", agentOutput.label);
+                }
+            }
+
+            if (settings.incrementalNavMesh)
+            {
+                NC_LOG_INFO("[NavMesh Performance] {}: reused {} of {} tiles with unchanged sources", agentOutput.label, agentOutput.numReusedTiles.load(std::memory_order_relaxed), agentOutput.numBuiltTiles);
+            }
+        }
+
+        if (mapContext.numBuiltNavTiles == 0)
+        {
+            NC_LOG_WARNING("[NavMesh Validator] {} produced no NavMesh tiles to validate", internalName);
+            LogMapNavMeshPerformance(mapContext, 0.0);
+            return;
+        }
+
+        if (!settings.loadNavMesh)
+        {
+            NC_LOG_INFO("[NavMesh Validator] Skipped validation for {}", internalName);
+            LogMapNavMeshPerformance(mapContext, 0.0);
+            return;
+        }
+
+        // The adjacent pairs are split into batches that any pipeline worker can pick up, each
+        // worker checks them with its own query against the agent's one shared dtNavMesh.
+        // The path graph is split the same way by tiles, every tile only writes its own entry.
+        mapContext.validationStart = std::chrono::steady_clock::now();
+
+        constexpr u32 numPairsPerBatch = 32;
+        constexpr u32 numPathGraphTilesPerBatch = 4;
+        std::vector<u32> numAgentPairs(mapContext.navAgents.size(), 0);
+        std::vector<u32> numAgentTiles(mapContext.navAgents.size(), 0);
+        u32 numBatches = 0;
+        for (u32 agentIndex = 0; agentIndex < mapContext.navAgents.size(); agentIndex++)
+        {
+            NavAgentOutput& agentOutput = *mapContext.navAgents[agentIndex];
+            if (builtNavTiles[agentIndex].empty())
+                continue;
+
+            agentOutput.seamValidator = std::make_unique<NavMesh::SeamValidator>(agentOutput.label, std::move(builtNavTiles[agentIndex]), std::max(1u, numThreads));
+            numAgentPairs[agentIndex] = settings.validateNavMesh ? agentOutput.seamValidator->GetNumPairs() : 0;
+            const dtNavMesh* navMesh = agentOutput.seamValidator->GetNavMesh();
+            if (settings.buildNavPathGraph && navMesh)
+            {
+                agentOutput.pathGraphBuilder = std::make_unique<NavMesh::PathGraph::Builder>(*navMesh);
+                numAgentTiles[agentIndex] = agentOutput.pathGraphBuilder->GetNumTiles();
+            }
+
+            numBatches += (numAgentPairs[agentIndex] + numPairsPerBatch - 1) / numPairsPerBatch;
+            numBatches += (numAgentTiles[agentIndex] + numPathGraphTilesPerBatch - 1) / numPathGraphTilesPerBatch;
+        }
+
+        if (numBatches == 0)
+        {
+            FinishMapValidation(mapContext, settings);
+            return;
+        }
+
+        // Counted up front, the validators may be released by the last batch while later ones are still queued
+        mapContext.remainingValidationBatches = numBatches;
+        pipeline.numPendingValidationBatches.fetch_add(numBatches, std::memory_order_acq_rel);
+        for (u32 agentIndex = 0; agentIndex < mapContext.navAgents.size(); agentIndex++)
+        {
+            const u32 numPairs = numAgentPairs[agentIndex];
+            for (u32 firstPair = 0; firstPair < numPairs; firstPair += numPairsPerBatch)
+            {
+                pipeline.validationBatches.enqueue({ &mapContext, mapContext.navAgents[agentIndex].get(), firstPair, std::min(firstPair + numPairsPerBatch, numPairs), false });
+            }
+
+            const u32 numTiles = numAgentTiles[agentIndex];
+            for (u32 firstTile = 0; firstTile < numTiles; firstTile += numPathGraphTilesPerBatch)
+            {
+                pipeline.validationBatches.enqueue({ &mapContext, mapContext.navAgents[agentIndex].get(), firstTile, std::min(firstTile + numPathGraphTilesPerBatch, numTiles), true });
+            }
+        }
+    }
+
+    void ResolveNavMeshTile(TilePipeline& pipeline, MapContext& mapContext, u32 tileID, const ExtractionSettings& settings)
+    {
+        ForEachNavTileNeighbour(tileID, [&pipeline, &mapContext](u32 neighbourTileID)
+        {
+            if (!mapContext.hasTileWork[neighbourTileID])
+                return;
+
+            if (mapContext.remainingSourceDependents[neighbourTileID].fetch_sub(1, std::memory_order_acq_rel) != 1)
+                return;
+
+            const u32 chunkGridPosX = neighbourTileID % Terrain::CHUNK_NUM_PER_MAP_STRIDE;
+            const u32 chunkGridPosY = neighbourTileID / Terrain::CHUNK_NUM_PER_MAP_STRIDE;
+            if (mapContext.navSources.Release(chunkGridPosX, chunkGridPosY))
+                pipeline.RemoveResidentSource();
+        });
+
+        if (mapContext.remainingNavTiles.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            FinishMapNavMesh(pipeline, mapContext, settings);
+    }
+
+    // A NavMesh tile reads the sources of its 3x3 neighbourhood, it is queued as soon as every
+    // tile in there has either been converted or failed instead of waiting for the whole map
+    void ReleaseNavMeshDependencies(TilePipeline& pipeline, MapContext& mapContext, u32 tileID, const ExtractionSettings& settings)
+    {
+        ForEachNavTileNeighbour(tileID, [&pipeline, &mapContext, &settings](u32 neighbourTileID)
+        {
+            if (!mapContext.hasTileWork[neighbourTileID])
+                return;
+
+            if (mapContext.pendingNeighbourTiles[neighbourTileID].fetch_sub(1, std::memory_order_acq_rel) != 1)
+                return;
+
+            const u32 chunkGridPosX = neighbourTileID % Terrain::CHUNK_NUM_PER_MAP_STRIDE;
+            const u32 chunkGridPosY = neighbourTileID / Terrain::CHUNK_NUM_PER_MAP_STRIDE;
+            if (!mapContext.navSources.Contains(chunkGridPosX, chunkGridPosY))
+            {
+                ResolveNavMeshTile(pipeline, mapContext, neighbourTileID, settings);
+                return;
+            }
+
+            mapContext.numQueuedNavTiles.fetch_add(1, std::memory_order_relaxed);
+            pipeline.numPendingNavTiles.fetch_add(1, std::memory_order_acq_rel);
+            pipeline.navMeshTiles.enqueue({ &mapContext, neighbourTileID });
+        });
+    }
+
+    void FinishMapTerrain(Runtime* runtime, MapContext& mapContext, const ExtractionSettings& settings)
+    {
+        mapContext.terrainExtractionSeconds = std::chrono::duration<f64>(std::chrono::steady_clock::now() - mapContext.terrainExtractionStart).count();
+
+        if (settings.extractMapAssets)
+        {
+            u64 chunkHash = 0;
+            u32 numHashes = static_cast<u32>(mapContext.chunkHashes.size_approx());
+            mapContext.mapHeader.chunkHashes.reserve(numHashes);
+
+            while (mapContext.chunkHashes.try_dequeue(chunkHash))
+            {
+                mapContext.mapHeader.chunkHashes.push_back(chunkHash);
+            }
+
+            SaveMapHeader(runtime, mapContext.internalName, mapContext.mapHeader);
+        }
+    }
+
+    void CompleteMapTile(Runtime* runtime, TilePipeline& pipeline, MapContext& mapContext, u32 chunkID, const ExtractionSettings& settings)
+    {
+        if (mapContext.remainingTiles.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            FinishMapTerrain(runtime, mapContext, settings);
+
+        if (settings.generateNavMesh)
+        {
+            const u32 tileID = GetNavTileID(chunkID);
+            if (mapContext.navSources.Contains(tileID % Terrain::CHUNK_NUM_PER_MAP_STRIDE, tileID / Terrain::CHUNK_NUM_PER_MAP_STRIDE))
+                pipeline.AddResidentSource();
+
+            ReleaseNavMeshDependencies(pipeline, mapContext, tileID, settings);
+        }
+
+        pipeline.numCompletedTiles.fetch_add(1, std::memory_order_acq_rel);
+    }
+
+    bool RunPrefetchStage(Runtime* runtime, CascLoader* cascLoader, TilePipeline& pipeline, const std::vector<TileWorkItem>& tileWorkItems, const ExtractionSettings& settings)
+    {
+        if (pipeline.IsOverSourceBudget())
+            return false;
+
+        if (!pipeline.prefetchStage.TryEnter())
+            return false;
+
+        if (!pipeline.prefetchedTiles.TryReserve())
+        {
+            pipeline.prefetchStage.Leave();
+            return false;
+        }
+
+        const u32 itemIndex = pipeline.nextWorkItem.fetch_add(1, std::memory_order_acq_rel);
+        if (itemIndex >= pipeline.numWorkItems)
+        {
+            pipeline.prefetchedTiles.CancelReservation();
+            pipeline.prefetchStage.Leave();
+            return false;
+        }
+
+        const TileWorkItem& workItem = tileWorkItems[itemIndex];
+        MapContext& mapContext = *workItem.mapContext;
+        std::call_once(mapContext.terrainExtractionStarted, [&mapContext]()
+        {
+            mapContext.terrainExtractionStart = std::chrono::steady_clock::now();
+        });
+
+        const auto start = std::chrono::steady_clock::now();
+        PrefetchedTile tile;
+        tile.mapContext = &mapContext;
+        tile.chunkID = workItem.chunkID;
+
+        const bool isPrefetched = PrefetchMapTile(cascLoader, settings.extractMapAssets || settings.includeNavMeshObjects, tile);
+        pipeline.prefetchStage.Record(start);
+
+        if (isPrefetched)
+        {
+            pipeline.prefetchedTiles.queue.enqueue(std::move(tile));
+        }
+        else
+        {
+            pipeline.prefetchedTiles.CancelReservation();
+        }
+
+        pipeline.prefetchStage.Leave();
+
+        if (!isPrefetched)
+            CompleteMapTile(runtime, pipeline, mapContext, workItem.chunkID, settings);
+
+        return true;
+    }
+
+    bool RunParseStage(Runtime* runtime, TilePipeline& pipeline, const ExtractionSettings& settings, TileScratch& scratch)
+    {
+        if (!pipeline.parseStage.TryEnter())
+            return false;
+
+        if (!pipeline.parsedTiles.TryReserve())
+        {
+            pipeline.parseStage.Leave();
+            return false;
+        }
+
+        PrefetchedTile tile;
+        if (!pipeline.prefetchedTiles.TryDequeue(tile))
+        {
+            pipeline.parsedTiles.CancelReservation();
+            pipeline.parseStage.Leave();
+            return false;
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        ParsedTile parsedTile;
+        const bool isParsed = ParseMapTile(tile, scratch, parsedTile);
+        pipeline.parseStage.Record(start);
+
+        if (isParsed)
+        {
+            pipeline.parsedTiles.queue.enqueue(std::move(parsedTile));
+        }
+        else
+        {
+            pipeline.parsedTiles.CancelReservation();
+        }
+
+        pipeline.parseStage.Leave();
+
+        if (!isParsed)
+            CompleteMapTile(runtime, pipeline, *tile.mapContext, tile.chunkID, settings);
+
+        return true;
+    }
+
+    bool RunConvertStage(Runtime* runtime, CascLoader* cascLoader, TilePipeline& pipeline, const ExtractionSettings& settings, TileScratch& scratch)
+    {
+        if (!pipeline.convertStage.TryEnter())
+            return false;
+
+        ParsedTile tile;
+        if (!pipeline.parsedTiles.TryDequeue(tile))
+        {
+            pipeline.convertStage.Leave();
+            return false;
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        ConvertMapTile(runtime, cascLoader, *tile.mapContext, tile.chunkID, *tile.adt, settings, scratch);
+        tile.adt.reset();
+        pipeline.convertStage.Record(start);
+        pipeline.convertStage.Leave();
+
+        CompleteMapTile(runtime, pipeline, *tile.mapContext, tile.chunkID, settings);
+        return true;
+    }
+
+    bool RunNavMeshStage(TilePipeline& pipeline, const ExtractionSettings& settings, uint32_t threadNum)
+    {
+        if (!pipeline.navMeshStage.TryEnter())
+            return false;
+
+        NavMeshWorkItem workItem;
+        if (!pipeline.navMeshTiles.try_dequeue(workItem))
+        {
+            pipeline.navMeshStage.Leave();
+            return false;
+        }
+
+        MapContext& mapContext = *workItem.mapContext;
+        const std::string& internalName = mapContext.internalName;
+        std::call_once(mapContext.navMeshBuildStarted, [&mapContext, &settings]()
+        {
+            mapContext.navMeshBuildStart = std::chrono::steady_clock::now();
+            if (!settings.packNavMeshTiles)
+                return;
+
+            // Opened with the first tile rather than up front so only maps that are building hold files open
+            for (std::unique_ptr<NavAgentOutput>& agentOutput : mapContext.navAgents)
+            {
+                const std::filesystem::path containerPath = GetNavContainerPath(mapContext, *agentOutput);
+                if (settings.incrementalNavMesh)
+                {
+                    agentOutput->previousContainer = std::make_unique<NavMesh::Container::Reader>();
+                    if (!agentOutput->previousContainer->Open(containerPath))
+                        agentOutput->previousContainer.reset();
+                }
+
+                agentOutput->container = std::make_unique<NavMesh::Container::Writer>();
+                if (!agentOutput->container->Open(containerPath))
+                {
+                    NC_LOG_ERROR("[Map Extractor] Failed to create NavMesh container {}", containerPath.string());
+                }
+            }
+        });
+
+        const auto start = std::chrono::steady_clock::now();
+
+        // Workers are bound to this map's SourceStore, each thread lazily creates its own
+        std::unique_ptr<NavMesh::Worker>& worker = mapContext.navMeshWorkers[threadNum];
+        if (!worker)
+            worker = std::make_unique<NavMesh::Worker>(mapContext.navSources, settings.navMeshBuildSettings);
+
+        const u32 chunkGridPosX = workItem.tileID % Terrain::CHUNK_NUM_PER_MAP_STRIDE;
+        const u32 chunkGridPosY = workItem.tileID / Terrain::CHUNK_NUM_PER_MAP_STRIDE;
+        const u32 numAgents = static_cast<u32>(mapContext.navAgents.size());
+        std::vector<NavMesh::AgentTile> agentTiles(numAgents);
+
+        NavMesh::TileBuildResult result = NavMesh::TileBuildResult::Failed;
+        if (settings.packNavMeshTiles)
+        {
+            // Tiles whose 3x3 sources and settings are unchanged are copied from the previous container,
+            // an edited ADT therefore only rebuilds its own tile and the seam neighbours around it
+            std::vector<u64> sourceHashes(numAgents);
+            std::vector<u8> reusedHeightData;
+            std::vector<u8> heightData;
+            bool hasRequestedAgents = false;
+            for (u32 agentIndex = 0; agentIndex < numAgents; agentIndex++)
+            {
+                NavAgentOutput& agentOutput = *mapContext.navAgents[agentIndex];
+                NavMesh::AgentTile& agentTile = agentTiles[agentIndex];
+                sourceHashes[agentIndex] = worker->GetSourceHash(chunkGridPosX, chunkGridPosY, agentIndex);
+
+                // The TileCache layers are loose files next to the container, a tile is only reused while its layers are still there
+                const NavMesh::Container::TileEntry* previousTile = agentOutput.previousContainer ? agentOutput.previousContainer->FindTile(workItem.tileID) : nullptr;
+                NavMesh::TileCache::LayersHeader layersHeader;
+                if (previousTile && previousTile->sourceHash == sourceHashes[agentIndex] &&
+                    (!settings.navMeshBuildSettings.buildTileCacheLayers || NavMesh::TileCache::ReadLayersHeader(GetNavTileCacheLayersPath(mapContext, agentOutput, chunkGridPosX, chunkGridPosY), layersHeader)) &&
+                    agentOutput.previousContainer->ReadTile(*previousTile, agentTile.bytes, reusedHeightData))
+                {
+                    agentTile.isRequested = false;
+                    agentTile.result = NavMesh::TileBuildResult::Success;
+                    agentOutput.numReusedTiles.fetch_add(1, std::memory_order_relaxed);
+                    agentOutput.numTileCacheLayers.fetch_add(layersHeader.layerCount, std::memory_order_relaxed);
+                }
+
+                hasRequestedAgents |= agentTile.isRequested;
+            }
+
+            // The remaining agents share one rasterization of the tile
+            result = hasRequestedAgents ? worker->BuildTile(chunkGridPosX, chunkGridPosY, agentTiles, heightData) : NavMesh::TileBuildResult::Success;
+
+            for (u32 agentIndex = 0; agentIndex < numAgents; agentIndex++)
+            {
+                NavMesh::AgentTile& agentTile = agentTiles[agentIndex];
+                // BuildTile clears heightData first, reused agents keep the height tile they were read with
+                const std::vector<u8>& agentHeightData = agentTile.isRequested ? heightData : reusedHeightData;
+                if (agentTile.result == NavMesh::TileBuildResult::Success && !mapContext.navAgents[agentIndex]->container->AddTile(workItem.tileID, sourceHashes[agentIndex], agentTile.bytes, agentHeightData))
+                    agentTile.result = NavMesh::TileBuildResult::Failed;
+            }
+        }
+        else
+        {
+            result = worker->BuildTile(mapContext.navOutputDirectory, internalName, chunkGridPosX, chunkGridPosY, agentTiles);
+        }
+
+        if (result == NavMesh::TileBuildResult::SourceMissing)
+        {
+            NC_LOG_ERROR("[Map Extractor] Missing NavMesh source for Map Tile ({}_{}_{})", internalName, chunkGridPosX, chunkGridPosY);
+        }
+        else
+        {
+            for (u32 agentIndex = 0; agentIndex < numAgents; agentIndex++)
+            {
+                NavAgentOutput& agentOutput = *mapContext.navAgents[agentIndex];
+                NavMesh::AgentTile& agentTile = agentTiles[agentIndex];
+                if (agentTile.result == NavMesh::TileBuildResult::Failed)
+                {
+                    NC_LOG_ERROR("[Map Extractor] Failed to generate NavMesh for Map Tile ({}_{}_{}) of {}", internalName, chunkGridPosX, chunkGridPosY, agentOutput.label);
+                    continue;
+                }
+
+                if (agentTile.result != NavMesh::TileBuildResult::Success)
+                    continue;
+
+                if (settings.navMeshBuildSettings.buildTileCacheLayers && agentTile.isRequested)
+                {
+                    if (NavMesh::TileCache::WriteLayersFile(GetNavTileCacheLayersPath(mapContext, agentOutput, chunkGridPosX, chunkGridPosY), agentTile.layersData))
+                    {
+                        NavMesh::TileCache::LayersHeader layersHeader;
+                        std::memcpy(&layersHeader, agentTile.layersData.data(), sizeof(layersHeader));
+                        agentOutput.numTileCacheLayers.fetch_add(layersHeader.layerCount, std::memory_order_relaxed);
+                    }
+                    else
+                    {
+                        NC_LOG_ERROR("[Map Extractor] Failed to write TileCache layers for Map Tile ({}_{}_{}) of {}", internalName, chunkGridPosX, chunkGridPosY, agentOutput.label);
+                    }
+                }
+
+                // Validation and the path graph take the tile bytes from memory, they are only kept when either will run
+                NavMesh::TileData tileData;
+                tileData.tileID = workItem.tileID;
+                if (settings.loadNavMesh)
+                    tileData.bytes = std::move(agentTile.bytes);
+
+                agentOutput.builtTiles.enqueue(std::move(tileData));
+            }
+        }
+
+        pipeline.navMeshStage.Record(start);
+        pipeline.navMeshStage.Leave();
+
+        ResolveNavMeshTile(pipeline, mapContext, workItem.tileID, settings);
+        pipeline.numPendingNavTiles.fetch_sub(1, std::memory_order_acq_rel);
+        return true;
+    }
+
+    bool RunValidationStage(TilePipeline& pipeline, const ExtractionSettings& settings, uint32_t threadNum)
+    {
+        if (!pipeline.validationStage.TryEnter())
+            return false;
+
+        ValidationWorkItem workItem;
+        if (!pipeline.validationBatches.try_dequeue(workItem))
+        {
+            pipeline.validationStage.Leave();
+            return false;
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        MapContext& mapContext = *workItem.mapContext;
+        if (workItem.buildsPathGraph)
+        {
+            workItem.agentOutput->pathGraphBuilder->BuildTiles(workItem.first, workItem.end);
+        }
+        else
+        {
+            workItem.agentOutput->seamValidator->ValidatePairs(workItem.first, workItem.end, threadNum);
+        }
+        pipeline.validationStage.Record(start);
+        pipeline.validationStage.Leave();
+
+        if (mapContext.remainingValidationBatches.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            FinishMapValidation(mapContext, settings);
+
+        pipeline.numPendingValidationBatches.fetch_sub(1, std::memory_order_acq_rel);
+        return true;
     }
-}
 
-vec2 GetCellVertexPosition(u32 cellID, u32 vertexID)
-{
-    const i32 cellX = ((cellID % Terrain::CHUNK_NUM_CELLS_PER_STRIDE));
-    const i32 cellY = ((cellID / Terrain::CHUNK_NUM_CELLS_PER_STRIDE));
+    // An empty or missing Agents list builds the default agent only
+    void LoadNavMeshAgents(const nlohmann::ordered_json& navMeshConfig, std::vector<NavMesh::AgentSettings>& agents)
+    {
+        agents = { NavMesh::AgentSettings() };
+        if (!navMeshConfig.contains("Agents") || !navMeshConfig["Agents"].is_array() || navMeshConfig["Agents"].empty())
+            return;
 
-    const i32 vX = vertexID % 17;
-    const i32 vY = vertexID / 17;
+        agents.clear();
+        for (const auto& agentConfig : navMeshConfig["Agents"])
+        {
+            if (!agentConfig.is_object())
+                continue;
 
-    bool isOddRow = vX > 8;
+            NavMesh::AgentSettings agent;
+            agent.name = agentConfig.value("Name", agent.name);
+            agent.height = agentConfig.value("Height", agent.height);
+            agent.radius = agentConfig.value("Radius", agent.radius);
+            agent.maxClimb = agentConfig.value("MaxClimb", agent.maxClimb);
+            StringUtils::ToLower(agent.name);
+
+            // Names become directory names, the unnamed agent writes into the map directory itself
+            const bool isValidName = agent.name.find_first_of("/\\.:") == std::string::npos;
+            const bool isDuplicate = std::any_of(agents.begin(), agents.end(), [&agent](const NavMesh::AgentSettings& other) { return other.name == agent.name; });
+            if (!isValidName || isDuplicate || agent.height <= 0.0f || agent.radius < 0.0f || agent.maxClimb < 0.0f)
+            {
+                NC_LOG_WARNING("[Map Extractor] Skipped invalid NavMesh agent \"{}\"", agent.name);
+                continue;
+            }
 
-    vec2 vertexOffset;
-    vertexOffset.x = -(8.5f * isOddRow);
-    vertexOffset.y = (0.5f * isOddRow);
+            agents.push_back(agent);
+        }
 
-    ivec2 globalVertex = ivec2(vX + cellX * 8, vY + cellY * 8);
+        if (agents.empty())
+            agents = { NavMesh::AgentSettings() };
+    }
 
-    vec2 finalPos = (vec2(globalVertex) + vertexOffset) * Terrain::PATCH_SIZE;
+    u32 GetPipelineStageLimit(const nlohmann::ordered_json& pipelineConfig, const char* key, i32 defaultValue, u32 numWorkers)
+    {
+        const i32 value = pipelineConfig.is_object() ? pipelineConfig.value(key, defaultValue) : defaultValue;
+        if (value <= 0)
+            return numWorkers;
 
-    return vec2(finalPos.x, -finalPos.y);
+        return std::min(static_cast<u32>(value), numWorkers);
+    }
+
+    void LogPipelineStage(const PipelineStage& stage, f64 wallSeconds)
+    {
+        const u32 numProcessed = stage.numProcessed.load(std::memory_order_relaxed);
+        const f64 busySeconds = static_cast<f64>(stage.busyNanoseconds.load(std::memory_order_relaxed)) / 1e9;
+        const f64 tilesPerSecond = wallSeconds > 0.0 ? static_cast<f64>(numProcessed) / wallSeconds : 0.0;
+        NC_LOG_INFO("[Map Extractor] Pipeline {}: {} tiles, {} max workers, {}s busy, {} tiles/s", stage.name, numProcessed, stage.maxWorkers, busySeconds, tilesPerSecond);
+    }
 }
 
 void MapExtractor::Process(bool extractMapAssets, bool generateNavMesh)
@@ -190,16 +1867,54 @@ void MapExtractor::Process(bool extractMapAssets, bool generateNavMesh)
     CascLoader* cascLoader = ServiceLocator::GetCascLoader();
 
     const auto& navMeshConfig = runtime->json["Extraction"]["NavMesh"];
-    const bool validateNavMesh = generateNavMesh && navMeshConfig.value("Validate", true);
-    NavMesh::BuildSettings navMeshBuildSettings;
+    ExtractionSettings settings;
+    settings.extractMapAssets = extractMapAssets;
+    settings.generateNavMesh = generateNavMesh;
+    settings.includeNavMeshObjects = generateNavMesh && navMeshConfig.value("IncludeObjects", true);
+    settings.validateNavMesh = generateNavMesh && navMeshConfig.value("Validate", true);
+    settings.buildNavPathGraph = generateNavMesh && navMeshConfig.value("PathGraph", false);
+    settings.loadNavMesh = settings.validateNavMesh || settings.buildNavPathGraph;
+    settings.packNavMeshTiles = navMeshConfig.value("PackTiles", true);
+    settings.incrementalNavMesh = settings.packNavMeshTiles && navMeshConfig.value("Incremental", true);
+
+    // The benchmark loads the packed container, loose tiles are not supported
+    const auto& benchmarkConfig = navMeshConfig.contains("Benchmark") ? navMeshConfig["Benchmark"] : nlohmann::ordered_json::object();
+    NavMesh::Benchmark::Settings& navMeshBenchmarkSettings = settings.navMeshBenchmarkSettings;
+    settings.benchmarkNavMesh = generateNavMesh && benchmarkConfig.value("Enabled", false);
+    navMeshBenchmarkSettings.seed = benchmarkConfig.value("Seed", navMeshBenchmarkSettings.seed);
+    navMeshBenchmarkSettings.numQueries = benchmarkConfig.value("NumQueries", navMeshBenchmarkSettings.numQueries);
+    navMeshBenchmarkSettings.maxNodes = benchmarkConfig.value("MaxNodes", navMeshBenchmarkSettings.maxNodes);
+    navMeshBenchmarkSettings.maxPathPolys = benchmarkConfig.value("MaxPathPolys", navMeshBenchmarkSettings.maxPathPolys);
+    navMeshBenchmarkSettings.pathTileRadius = benchmarkConfig.value("PathTileRadius", navMeshBenchmarkSettings.pathTileRadius);
+    if (settings.benchmarkNavMesh && !settings.packNavMeshTiles)
+    {
+        NC_LOG_WARNING("[Map Extractor] NavMesh Benchmark requires PackTiles, skipping it");
+        settings.benchmarkNavMesh = false;
+    }
+
+    const auto& mapConfig = runtime->json["Extraction"]["Map"];
+    settings.useMeshTerrainPhysics = mapConfig.value("UseMeshTerrainPhysics", false);
+
+    NavMesh::BuildSettings& navMeshBuildSettings = settings.navMeshBuildSettings;
     navMeshBuildSettings.useMonotonePartitioning = generateNavMesh && navMeshConfig.value("UseMonotonePartitioning", navMeshBuildSettings.useMonotonePartitioning);
     navMeshBuildSettings.useMedianFilter = navMeshConfig.value("UseMedianFilter", navMeshBuildSettings.useMedianFilter);
+    navMeshBuildSettings.useTerrainGridRasterization = navMeshConfig.value("UseTerrainGridRasterization", navMeshBuildSettings.useTerrainGridRasterization);
     navMeshBuildSettings.detailSampleDistance = navMeshConfig.value("DetailSampleDistance", navMeshBuildSettings.detailSampleDistance);
     navMeshBuildSettings.maxEdgeLength = navMeshConfig.value("MaxEdgeLength", navMeshBuildSettings.maxEdgeLength);
     navMeshBuildSettings.maxSimplificationError = navMeshConfig.value("MaxSimplificationError", navMeshBuildSettings.maxSimplificationError);
     navMeshBuildSettings.minRegionRadius = navMeshConfig.value("MinRegionRadius", navMeshBuildSettings.minRegionRadius);
     navMeshBuildSettings.mergeRegionRadius = navMeshConfig.value("MergeRegionRadius", navMeshBuildSettings.mergeRegionRadius);
     navMeshBuildSettings.internalSubtileVoxelSize = navMeshConfig.value("InternalSubtileVoxelSize", navMeshBuildSettings.internalSubtileVoxelSize);
+    navMeshBuildSettings.compactTerrainHeights = navMeshConfig.value("CompactTerrainHeights", navMeshBuildSettings.compactTerrainHeights);
+    navMeshBuildSettings.buildTileCacheLayers = generateNavMesh && navMeshConfig.value("TileCacheLayers", navMeshBuildSettings.buildTileCacheLayers);
+    settings.tileCacheMaxObstacles = std::max(1, navMeshConfig.value("TileCacheMaxObstacles", settings.tileCacheMaxObstacles));
+    if (navMeshBuildSettings.buildTileCacheLayers && navMeshBuildSettings.internalSubtileVoxelSize > 0)
+    {
+        // The layers are cropped out of the whole tile's heightfield, which a subtiled build never holds
+        NC_LOG_WARNING("[Map Extractor] NavMesh TileCacheLayers are not supported with InternalSubtileVoxelSize, skipping them");
+        navMeshBuildSettings.buildTileCacheLayers = false;
+    }
+    LoadNavMeshAgents(navMeshConfig, navMeshBuildSettings.agents);
     const MapSelection mapSelection = LoadMapSelection();
 
     auto& mapStorage = ClientDBExtractor::mapStorage;
@@ -210,6 +1925,11 @@ void MapExtractor::Process(bool extractMapAssets, bool generateNavMesh)
         NC_LOG_INFO("[Map Extractor] Map selection enabled ({} ID(s), {} internal name(s))", mapSelection.ids.size(), mapSelection.internalNames.size());
     }
 
+    // Parse every selected WDT up front so the tiles of all maps can share a single TaskSet,
+    // small instance maps would otherwise leave most threads idle between blocking per-map tasks
+    std::vector<std::unique_ptr<MapContext>> mapContexts;
+    CollisionMeshCache collisionMeshes;
+
     mapStorage.Each([&](const u32 id, const MetaGen::Shared::ClientDB::MapRecord& map) -> bool
     {
         ZoneScopedN("MapExtractor::Process::Each");
@@ -236,14 +1956,19 @@ void MapExtractor::Process(bool extractMapAssets, bool generateNavMesh)
 
         Adt::WdtParser wdtParser = { };
 
-        Adt::Wdt wdt = { };
+        std::unique_ptr<MapContext> mapContext = std::make_unique<MapContext>();
+        mapContext->id = id;
+        mapContext->internalName = internalName;
+        mapContext->collisionMeshes = &collisionMeshes;
+
+        Adt::Wdt& wdt = mapContext->wdt;
         if (!wdtParser.TryParse(fileWDT, wdt))
         {
             NC_LOG_WARNING("[Map Extractor] Failed to extract {0} (Corrupt WDT)", internalName);
             return true;
         }
 
-        Map::MapHeader mapHeader = { };
+        Map::MapHeader& mapHeader = mapContext->mapHeader;
         mapHeader.flags.UseMapObjectAsBase = wdt.mphd.flags.UseGlobalMapObj;
 
         if (mapHeader.flags.UseMapObjectAsBase)
@@ -289,559 +2014,198 @@ void MapExtractor::Process(bool extractMapAssets, bool generateNavMesh)
 
             u64 nameHash = XXHash64::hash(wmoPathStr.c_str(), wmoPathStr.size(), 0);
             placement.nameHash = nameHash;
+
+            // Global map object maps have no tiles, their header is complete already
+            SaveMapHeader(runtime, internalName, mapHeader);
+            return true;
         }
-        else
-        {
-            std::filesystem::path navOutputDirectory;
-            if (generateNavMesh)
-            {
-                navOutputDirectory = runtime->paths.navMesh / internalName;
-                if (!PrepareNavMeshOutputDirectory(navOutputDirectory, internalName))
-                    return true;
-            }
 
-            const auto terrainExtractionStart = std::chrono::steady_clock::now();
-            moodycamel::ConcurrentQueue<u64> mapChunkHashes;
-            NavMesh::SourceStore navSources;
+        if (generateNavMesh)
+        {
+            mapContext->navOutputDirectory = runtime->paths.navMesh / internalName;
 
-            enki::TaskSet convertMapTask(Terrain::CHUNK_NUM_PER_MAP, [&runtime, &cascLoader, &map, &wdt, &internalName, &mapChunkHashes, &navSources, extractMapAssets, generateNavMesh, id](enki::TaskSetPartition range, uint32_t threadNum)
+            bool isPrepared = true;
+            for (const NavMesh::AgentSettings& agent : settings.navMeshBuildSettings.agents)
             {
-                ZoneScopedN("MapExtractor::Process::Each::ConvertMapTask");
-                Adt::Parser adtParser = { };
-
-                std::vector<u8> outBytes;
-                std::shared_ptr<Bytebuffer> buffer;
-                if (extractMapAssets)
-                {
-                    outBytes.reserve(Terrain::CHUNK_ALPHAMAP_TOTAL_BYTE_SIZE);
-                    buffer = Bytebuffer::Borrow<8388608>();
-                }
-
-                for (u32 chunkID = range.start; chunkID < range.end; chunkID++)
-                {
-                    u32 originalChunkGridPosX = chunkID % 64;
-                    u32 originalChunkGridPosY = chunkID / 64;
-
-                    const Adt::MAIN::AreaInfo& areaInfo = wdt.main.areaInfos[originalChunkGridPosX][originalChunkGridPosY];
-                    if (!areaInfo.flags.IsUsed)
-                        continue;
-
-                    const Adt::MAID::FileIDs& fileIDs = wdt.maid.fileIDs[originalChunkGridPosX][originalChunkGridPosY];
-                    if (fileIDs.adtRootFileID == 0 ||
-                        (extractMapAssets && (fileIDs.adtTextureFileID == 0 || fileIDs.adtObject1FileID == 0)))
-                    {
-                        continue;
-                    }
-
-                    std::shared_ptr<Bytebuffer> rootBuffer = cascLoader->GetFileByID(fileIDs.adtRootFileID);
-                    std::shared_ptr<Bytebuffer> textBuffer;
-                    std::shared_ptr<Bytebuffer> objBuffer;
-                    if (extractMapAssets)
-                    {
-                        textBuffer = cascLoader->GetFileByID(fileIDs.adtTextureFileID);
-                        objBuffer = cascLoader->GetFileByID(fileIDs.adtObject1FileID);
-                    }
-
-                    if (!rootBuffer)
-                        continue;
-
-                    u32 chunkGridPosX = chunkID / 64;
-                    u32 chunkGridPosY = chunkID % 64;
-                    u32 newChunkID = chunkGridPosX + (chunkGridPosY * Terrain::CHUNK_NUM_PER_MAP_STRIDE);
-
-                    ZoneScopedN("MapExtractor::Process::Each::ConvertMapTask::Convert");
-                    Adt::Layout adt = { };
-                    {
-                        adt.mapID = id;
-                        adt.chunkID = newChunkID;
-                    }
-
-                    Adt::Parser::Context context = { };
-                    if (!adtParser.TryParse(context, rootBuffer, textBuffer, objBuffer, wdt, adt))
-                        continue;
-
-                    // Post Processing
-                    if (extractMapAssets)
-                    {
-                        auto& liquidObjects = ClientDBExtractor::liquidObjectStorage;
-                        auto& liquidTypes = ClientDBExtractor::liquidTypeStorage;
-                        auto& liquidMaterials = ClientDBExtractor::liquidMaterialStorage;
-
-                        u32 numInstances = static_cast<u32>(adt.mh2o.instances.size());
-                        for (u32 i = 0; i < numInstances; i++)
-                        {
-                            auto& liquidInstance = adt.mh2o.instances[i];
-                            u16 liquidVertexFormat = liquidInstance.liquidVertexFormat;
-
-                            if (liquidVertexFormat >= 42)
-                            {
-                                if (liquidInstance.liquidType == 2)
-                                {
-                                    liquidVertexFormat = 2;
-                                }
-                                else
-                                {
-                                    i16 liquidTypeID = -1;
-
-                                    if (liquidObjects.Has(liquidVertexFormat))
-                                    {
-                                        auto& liquidObject = liquidObjects.Get<MetaGen::Shared::ClientDB::LiquidObjectRecord>(liquidVertexFormat);
-                                        liquidTypeID = liquidObject.liquidTypeID;
-                                    }
-                                    else
-                                    {
-                                        liquidTypeID = liquidInstance.liquidType;
-                                    }
-
-                                    if (liquidTypes.Has(liquidTypeID))
-                                    {
-                                        auto& liquidType = liquidTypes.Get<MetaGen::Shared::ClientDB::LiquidTypeRecord>(liquidTypeID);
-
-                                        if (liquidMaterials.Has(liquidType.materialID))
-                                        {
-                                            auto& liquidMaterial = liquidMaterials.Get<MetaGen::Shared::ClientDB::LiquidMaterialRecord>(liquidType.materialID);
-                                            liquidVertexFormat = liquidMaterial.liquidVertexFormat;
-                                        }
-                                    }
-                                }
-
-                            }
-
-                            if (liquidInstance.vertexDataOffset == 0 && liquidInstance.liquidType != 2)
-                            {
-                                liquidVertexFormat = 2;
-                            }
-
-                            if (liquidVertexFormat == 2)
-                            {
-                                liquidInstance.width = 8;
-                                liquidInstance.height = 8;
-                                liquidInstance.offsetX = 0;
-                                liquidInstance.offsetY = 0;
-                            }
-
-                            liquidInstance.liquidVertexFormat = liquidVertexFormat;
-
-                            if (liquidInstance.liquidVertexFormat == 2)
-                                liquidInstance.vertexDataOffset = std::numeric_limits<u32>().max();
-                        }
-                    }
-
-                    if (generateNavMesh && !extractMapAssets)
-                    {
-                        if (!navSources.Add(chunkGridPosX, chunkGridPosY, adt))
-                        {
-                            NC_LOG_ERROR("[Map Extractor] Failed to retain NavMesh source for Map Tile ({}_{}_{})", internalName, chunkGridPosX, chunkGridPosY);
-                        }
-                        continue;
-                    }
-
-                    Map::Chunk chunk = { };
-                    std::vector<Terrain::Placement> modelPlacements;
-                    Map::LiquidInfo liquidInfo;
-                    std::vector<u8> physicsData;
-                    if (!Map::Chunk::FromADT(adt, chunk, modelPlacements, liquidInfo))
-                        continue;
-
-                    if (generateNavMesh && !navSources.Add(chunkGridPosX, chunkGridPosY, chunk))
-                    {
-                        NC_LOG_ERROR("[Map Extractor] Failed to retain NavMesh source for Map Tile ({}_{}_{})", internalName, chunkGridPosX, chunkGridPosY);
-                    }
-
-                    // Post Processing
-                    {
-                        for (u32 i = 0; i < modelPlacements.size(); i++)
-                        {
-                            Terrain::Placement& placementInfo = modelPlacements[i];
-
-                            if (placementInfo.nameHash == 0 ||
-                                placementInfo.nameHash == std::numeric_limits<u64>().max())
-                                continue;
-
-                            u32 placementFileID = static_cast<u32>(placementInfo.nameHash);
-                            if (!cascLoader->InCascAndListFile(placementFileID))
-                            {
-                                NC_LOG_ERROR("Skipped model placement because file doesn't exist");
-                                continue;
-                            }
-
-                            const std::string& modelPathStr = cascLoader->GetFilePathFromListFileID(placementFileID);
-                            std::filesystem::path modelPath = std::filesystem::path("model") / std::filesystem::path(modelPathStr).replace_extension(Model::FILE_EXTENSION);
-                            modelPath.make_preferred();
-                            std::string modelPathHashStr = modelPath.string();
-                            std::transform(modelPathHashStr.begin(), modelPathHashStr.end(), modelPathHashStr.begin(), ::tolower);
-                            std::replace(modelPathHashStr.begin(), modelPathHashStr.end(), '\\', '/');
-
-                            u64 nameHash = XXHash64::hash(modelPathHashStr.c_str(), modelPathHashStr.size(), 0);
-                            placementInfo.nameHash = nameHash;
-                        }
-
-                        // 0 = r, 1 = g, 2 = b, 3 = a
-                        u32 swizzleMap[Terrain::CHUNK_ALPHAMAP_CELL_NUM_CHANNELS] =
-                        {
-                            2,1,0,3
-                        };
-
-                        std::shared_ptr<Bytebuffer> alphaMapBuffer = Bytebuffer::Borrow<Terrain::CHUNK_ALPHAMAP_TOTAL_BYTE_SIZE>();
-                        memset(alphaMapBuffer->GetDataPointer(), 0, Terrain::CHUNK_ALPHAMAP_TOTAL_BYTE_SIZE);
-
-                        bool isAlphaMapSet = false;
-
-                        for (u16 i = 0; i < Terrain::CHUNK_NUM_CELLS; i++)
-                        {
-                            u16 cellIndex = i;
-
-                            const u32 numLayers = static_cast<u32>(adt.cellInfos[i].mcly.data.size());
-                            const u32 basePixelDestination = (i * Terrain::CHUNK_ALPHAMAP_CELL_RESOLUTION * Terrain::CHUNK_ALPHAMAP_CELL_NUM_CHANNELS);
-
-                            for (u32 j = 0; j < 4; j++)
-                            {
-                                u32 fileID = static_cast<u32>(chunk.cellsData.layerTextureIDs[cellIndex][j]);
-                                if (fileID == 0 || fileID == std::numeric_limits<u32>().max())
-                                    continue;
-
-                                std::filesystem::path texturePath = cascLoader->GetFilePathFromListFileID(fileID);
-                                if (texturePath.empty())
-                                {
-                                    chunk.cellsData.layerTextureIDs[cellIndex][j] = std::numeric_limits<u64>().max();
-                                    continue;
-                                }
-
-                                texturePath = std::filesystem::path("texture") / texturePath;
-                                texturePath.replace_extension("dds").make_preferred();
-
-                                std::string texturePathStr = texturePath.string();
-                                std::transform(texturePathStr.begin(), texturePathStr.end(), texturePathStr.begin(), ::tolower);
-                                std::replace(texturePathStr.begin(), texturePathStr.end(), '\\', '/');
-
-                                u64 textureNameHash = XXHash64::hash(texturePathStr.c_str(), texturePathStr.length(), 0);
-                                chunk.cellsData.layerTextureIDs[cellIndex][j] = textureNameHash;
-
-                                // If the layer has alpha data, add it to our per-chunk alphamap
-                                if (j > 0)
-                                {
-                                    u32 channel = swizzleMap[j - 1];
-
-                                    for (u32 pixel = 0; pixel < Terrain::CHUNK_ALPHAMAP_CELL_RESOLUTION; pixel++)
-                                    {
-                                        u32 dst = basePixelDestination + (pixel * Terrain::CHUNK_ALPHAMAP_CELL_NUM_CHANNELS) + channel;
-
-                                        u8 pixelValue = adt.cellInfos[i].mcal.data[j - 1].alphaMap[pixel];
-                                        isAlphaMapSet |= pixelValue != 0;
-
-                                        alphaMapBuffer->GetDataPointer()[dst] = pixelValue;
-                                    }
-                                }
-                            }
-
-                            // Convert Old Alpha to New Alpha
-                            if (!wdt.mphd.flags.UseBigAlpha && numLayers > 1)
-                            {
-                                const u32 basePixelDestination = (i * Terrain::CHUNK_ALPHAMAP_CELL_RESOLUTION * Terrain::CHUNK_ALPHAMAP_CELL_NUM_CHANNELS);
-
-                                const vec4 alphaR = vec4(1, 0, 0, 0);
-                                const vec4 alphaG = vec4(0, 1, 0, 0);
-                                const vec4 alphaB = vec4(0, 0, 1, 0);
-                                const vec4 alphaA = vec4(0, 0, 0, 1);
-
-                                for (u32 pixel = 0; pixel < Terrain::CHUNK_ALPHAMAP_CELL_RESOLUTION; pixel++)
-                                {
-                                    u32 redDst = basePixelDestination + (pixel * Terrain::CHUNK_ALPHAMAP_CELL_NUM_CHANNELS) + swizzleMap[0];
-                                    u32 greenDst = basePixelDestination + (pixel * Terrain::CHUNK_ALPHAMAP_CELL_NUM_CHANNELS) + swizzleMap[1];
-                                    u32 blueDst = basePixelDestination + (pixel * Terrain::CHUNK_ALPHAMAP_CELL_NUM_CHANNELS) + swizzleMap[2];
-                                    u32 alphaDst = basePixelDestination + (pixel * Terrain::CHUNK_ALPHAMAP_CELL_NUM_CHANNELS) + swizzleMap[3];
-
-                                    f32 redPixelFloat = alphaMapBuffer->GetDataPointer()[redDst] / 255.f;
-                                    f32 greenPixelFloat = alphaMapBuffer->GetDataPointer()[greenDst] / 255.f;
-                                    f32 bluePixelFloat = alphaMapBuffer->GetDataPointer()[blueDst] / 255.f;
-
-                                    vec4 accumulated = alphaR;
-                                    accumulated = glm::mix(accumulated, alphaG, redPixelFloat);
-                                    accumulated = glm::mix(accumulated, alphaB, greenPixelFloat);
-                                    accumulated = glm::mix(accumulated, alphaA, bluePixelFloat);
-                                    accumulated = glm::clamp(accumulated, 0.f, 1.f);
-
-                                    u8 redPixelByte = static_cast<u8>(glm::round(accumulated.g * 255));
-                                    u8 greenPixelByte = static_cast<u8>(glm::round(accumulated.b * 255));
-                                    u8 bluePixelByte = static_cast<u8>(glm::round(accumulated.a * 255));
-
-                                    alphaMapBuffer->GetDataPointer()[redDst] = redPixelByte;
-                                    alphaMapBuffer->GetDataPointer()[greenDst] = greenPixelByte;
-                                    alphaMapBuffer->GetDataPointer()[blueDst] = bluePixelByte;
-                                    alphaMapBuffer->GetDataPointer()[alphaDst] = 1;
-                                }
-                            }
-                        }
-
-                        std::string localChunkBlendMapPath = "texture/blendmaps/" + internalName + "/" + internalName + "_" + std::to_string(chunkGridPosX) + "_" + std::to_string(chunkGridPosY) + ".dds";
-                        chunk.chunkAlphaMapTextureHash = (XXHash64::hash(localChunkBlendMapPath.c_str(), localChunkBlendMapPath.length(), 0) * isAlphaMapSet) + (std::numeric_limits<u64>().max() * !isAlphaMapSet);
-
-                        if (isAlphaMapSet)
-                        {
-                            BLP::BlpConvert blpConvert;
-                            outBytes.clear();
-
-                            if (!blpConvert.ConvertRawToBuffer(64, 64, Terrain::CHUNK_NUM_CELLS, alphaMapBuffer->GetDataPointer(), Terrain::CHUNK_ALPHAMAP_TOTAL_BYTE_SIZE, BLP::InputFormat::BGRA_8UB, BLP::Format::BC1, outBytes, false))
-                            {
-                                runtime->pactInfo.MarkFailed();
-                                NC_LOG_ERROR("[Map Extractor] Failed to convert blend map {0}", localChunkBlendMapPath);
-                                continue;
-                            }
-
-                            auto& manifest = runtime->pactInfo.GetManifestForFile(runtime, outBytes.size());
-                            if (!manifest.AddFile(runtime, localChunkBlendMapPath, outBytes))
-                            {
-                                NC_LOG_ERROR("[Map Extractor] Failed to add blend map {0} to PACT storage", localChunkBlendMapPath);
-                                continue;
-                            }
-                        }
-
-                        // if build physics shapes
-                        {
-                            constexpr u32 numVerticesPerChunk = Terrain::CHUNK_NUM_CELLS * Terrain::CELL_TOTAL_GRID_SIZE;
-                            constexpr u32 numTrianglePerChunk = Terrain::CHUNK_NUM_CELLS * Terrain::CELL_NUM_TRIANGLES;
-
-                            JPH::VertexList vertexList;
-                            JPH::IndexedTriangleList triangleList;
-                            vertexList.reserve(numVerticesPerChunk);
-                            triangleList.reserve(numTrianglePerChunk);
-
-                            u32 patchVertexIDs[5] = { 0 };
-                            uvec2 triangleComponentOffsets = uvec2(0, 0);
-
-                            for (u32 cellID = 0; cellID < Terrain::CHUNK_NUM_CELLS; cellID++)
-                            {
-                                for (u32 i = 0; i < Terrain::CELL_TOTAL_GRID_SIZE; i++)
-                                {
-                                    f32 height = chunk.cellsData.heightField[cellID][i];
-
-                                    vec2 pos = GetCellVertexPosition(cellID, i);
-                                    assert(pos.x <= Terrain::CHUNK_SIZE);
-                                    assert(pos.y <= Terrain::CHUNK_SIZE);
-
-                                    vertexList.push_back({ pos.x, height, pos.y });
-                                }
-
-                                const u32 cellVertexOffset = cellID * Terrain::CELL_TOTAL_GRID_SIZE;
-                                const u64 holeData = chunk.cellsData.holes[cellID];
-                                for (u32 i = 0; i < Terrain::CELL_NUM_TRIANGLES; i++)
-                                {
-                                    u32 triangleID = i;
-                                    u32 patchID = triangleID / 4;
-                                    u32 patchRow = patchID / 8;
-                                    u32 patchColumn = patchID % 8;
-
-                                    // Top Left is calculated like this
-                                    patchVertexIDs[0] = patchColumn + (patchRow * Terrain::CELL_GRID_ROW_SIZE);
-
-                                    // Top Right is always +1 from Top Left
-                                    patchVertexIDs[1] = patchVertexIDs[0] + 1;
-
-                                    // Bottom Left is always NUM_VERTICES_PER_PATCH_ROW from the Top Left vertex
-                                    patchVertexIDs[2] = patchVertexIDs[0] + Terrain::CELL_GRID_ROW_SIZE;
-
-                                    // Bottom Right is always +1 from Bottom Left
-                                    patchVertexIDs[3] = patchVertexIDs[2] + 1;
-
-                                    // Center is always NUM_VERTICES_PER_OUTER_PATCH_ROW from Top Left
-                                    patchVertexIDs[4] = patchVertexIDs[0] + Terrain::CELL_OUTER_GRID_STRIDE;
+                std::unique_ptr<NavAgentOutput>& agentOutput = mapContext->navAgents.emplace_back(std::make_unique<NavAgentOutput>());
+                agentOutput->label = agent.name.empty() ? internalName : internalName + "/" + agent.name;
+                agentOutput->outputDirectory = agent.name.empty() ? mapContext->navOutputDirectory : mapContext->navOutputDirectory / agent.name;
+                isPrepared &= PrepareNavMeshOutputDirectory(agentOutput->outputDirectory, internalName, settings.incrementalNavMesh, settings.incrementalNavMesh && settings.navMeshBuildSettings.buildTileCacheLayers);
+            }
 
-                                    u32 triangleWithinPatch = triangleID % 4; // 0 - top, 1 - left, 2 - bottom, 3 - right
-                                    triangleComponentOffsets = uvec2(triangleWithinPatch > 1, // Identify if we are within bottom or right triangle
-                                        triangleWithinPatch == 0 || triangleWithinPatch == 3); // Identify if we are within the top or right triangle
+            if (!isPrepared)
+                return true;
+        }
 
-                                    u32 vertexID1 = cellVertexOffset + patchVertexIDs[4];
-                                    u32 vertexID2 = cellVertexOffset + patchVertexIDs[triangleComponentOffsets.x * 2 + triangleComponentOffsets.y];
-                                    u32 vertexID3 = cellVertexOffset + patchVertexIDs[(!triangleComponentOffsets.y) * 2 + triangleComponentOffsets.x];
+        mapContexts.push_back(std::move(mapContext));
+        return true;
+    });
 
-                                    if ((holeData & (1ull << patchID)) != 0)
-                                        continue;
+    std::vector<u32> numTilesPerMap(mapContexts.size(), 0);
+    u32 numTiles = 0;
+    for (u32 mapIndex = 0; mapIndex < mapContexts.size(); mapIndex++)
+    {
+        const Adt::Wdt& wdt = mapContexts[mapIndex]->wdt;
+        for (u32 chunkID = 0; chunkID < Terrain::CHUNK_NUM_PER_MAP; chunkID++)
+        {
+            numTilesPerMap[mapIndex] += HasTileSources(wdt, chunkID, extractMapAssets);
+        }
 
-                                    triangleList.push_back({ vertexID3, vertexID2, vertexID1 });
-                                }
-                            }
+        mapContexts[mapIndex]->remainingTiles = numTilesPerMap[mapIndex];
+        numTiles += numTilesPerMap[mapIndex];
+    }
 
-                            JPH::MeshShapeSettings shapeSetting(vertexList, triangleList);
-                            JPH::ShapeSettings::ShapeResult shapeResult = shapeSetting.Create();
-                            JPH::ShapeRefC shape = shapeResult.Get();
+    // Queue the largest maps first so their long NavMesh tails overlap with the conversion of the smaller ones
+    std::vector<u32> mapOrder(mapContexts.size());
+    for (u32 mapIndex = 0; mapIndex < mapOrder.size(); mapIndex++)
+    {
+        mapOrder[mapIndex] = mapIndex;
+    }
+    std::stable_sort(mapOrder.begin(), mapOrder.end(), [&numTilesPerMap](u32 a, u32 b)
+    {
+        return numTilesPerMap[a] > numTilesPerMap[b];
+    });
 
-                            JPH::Shape::ShapeToIDMap shapeMap;
-                            JPH::Shape::MaterialToIDMap materialMap;
+    TilePipeline pipeline;
+    std::vector<TileWorkItem> tileWorkItems;
+    tileWorkItems.reserve(numTiles);
 
-                            std::shared_ptr<Bytebuffer> joltChunkBuffer = Bytebuffer::Borrow<16777216>();
-                            JoltStream joltStream(joltChunkBuffer);
-                            shape->SaveWithChildren(joltStream, shapeMap, materialMap);
+    for (u32 mapIndex : mapOrder)
+    {
+        MapContext& mapContext = *mapContexts[mapIndex];
+        if (numTilesPerMap[mapIndex] == 0)
+        {
+            mapContext.terrainExtractionStart = std::chrono::steady_clock::now();
+            FinishMapTerrain(runtime, mapContext, settings);
 
-                            if (!joltStream.IsFailed() && joltChunkBuffer->writtenData > 0)
-                            {
-                                physicsData.resize(joltChunkBuffer->writtenData);
-                                memcpy(&physicsData[0], joltChunkBuffer->GetDataPointer(), joltChunkBuffer->writtenData);
-                            }
-                        }
+            if (generateNavMesh)
+                FinishMapNavMesh(pipeline, mapContext, settings);
 
-                        buffer->Reset();
-                        if (chunk.Save(buffer, modelPlacements, liquidInfo, physicsData))
-                        {
-                            std::string localChunkPath = "map/" + internalName + "/" + internalName + "_" + std::to_string(chunkGridPosX) + "_" + std::to_string(chunkGridPosY) + Map::CHUNK_FILE_EXTENSION;
+            continue;
+        }
 
-                            auto& manifest = runtime->pactInfo.GetManifestForFile(runtime, buffer->writtenData);
-                            if (manifest.AddFile(runtime, localChunkPath, buffer))
-                            {
-                                u64 hash = XXHash64::hash(localChunkPath.c_str(), localChunkPath.length(), 0);
-                                mapChunkHashes.enqueue(hash);
-                            }
-                            else
-                            {
-                                NC_LOG_ERROR("[Map Extractor] Failed to add Map Tile to PACT storage ({}_{}_{})", internalName, chunkGridPosX, chunkGridPosY);
-                            }
-                        }
-                        else
-                        {
-                            NC_LOG_ERROR("[Map Extractor] Failed to save Map Tile ({}_{}_{})", internalName, chunkGridPosX, chunkGridPosY);
-                        }
-                    }
-                }
-            });
+        // Walk the tiles in NavMesh row major order, sources are then freed in a sliding window
+        // about two rows high rather than staying resident until the whole map is done
+        for (u32 tileID = 0; tileID < Terrain::CHUNK_NUM_PER_MAP; tileID++)
+        {
+            const u32 chunkID = GetNavTileID(tileID); // The index transpose is its own inverse
+            if (!HasTileSources(mapContext.wdt, chunkID, extractMapAssets))
+                continue;
 
-            convertMapTask.m_Priority = enki::TaskPriority::TASK_PRIORITY_HIGH;
-            runtime->scheduler.AddTaskSetToPipe(&convertMapTask);
-            runtime->scheduler.WaitforTask(&convertMapTask);
-            const f64 terrainExtractionSeconds = std::chrono::duration<f64>(std::chrono::steady_clock::now() - terrainExtractionStart).count();
+            tileWorkItems.push_back({ &mapContext, chunkID });
 
             if (generateNavMesh)
             {
-                std::vector<u32> navChunkIDs;
-                navSources.GetSourceIDs(navChunkIDs);
+                mapContext.hasTileWork[tileID] = true;
 
-                if (!navChunkIDs.empty())
+                ForEachNavTileNeighbour(tileID, [&mapContext](u32 neighbourTileID)
                 {
-                    const auto navMeshBuildStart = std::chrono::steady_clock::now();
-                    const u32 numWorkers = std::max(1u, runtime->scheduler.GetNumTaskThreads());
-                    moodycamel::ConcurrentQueue<u32> builtNavTileIDs;
-                    std::vector<std::unique_ptr<NavMesh::Worker>> navMeshWorkers;
-                    navMeshWorkers.reserve(numWorkers);
+                    mapContext.pendingNeighbourTiles[neighbourTileID].fetch_add(1, std::memory_order_relaxed);
+                    mapContext.remainingSourceDependents[neighbourTileID].fetch_add(1, std::memory_order_relaxed);
+                });
+            }
+        }
 
-                    for (u32 workerIndex = 0; workerIndex < numWorkers; workerIndex++)
-                    {
-                        navMeshWorkers.push_back(std::make_unique<NavMesh::Worker>(navSources, navMeshBuildSettings));
-                    }
+        if (generateNavMesh)
+        {
+            mapContext.remainingNavTiles = numTilesPerMap[mapIndex];
+            mapContext.navMeshWorkers.resize(std::max(1u, runtime->scheduler.GetNumTaskThreads()));
+        }
+    }
 
-                    enki::TaskSet buildNavMeshTask(static_cast<u32>(navChunkIDs.size()), [&internalName, &navChunkIDs, &builtNavTileIDs, &navMeshWorkers, &navOutputDirectory](enki::TaskSetPartition range, uint32_t threadNum)
-                    {
-                        ZoneScopedN("MapExtractor::Process::Each::BuildNavMeshTask");
-                        NavMesh::Worker& worker = *navMeshWorkers[threadNum];
+    NC_LOG_INFO("[Map Extractor] Queued {0} tiles across {1} maps", numTiles, mapContexts.size());
+
+    const u32 numThreads = std::max(1u, runtime->scheduler.GetNumTaskThreads());
+    const auto& pipelineConfig = mapConfig.contains("Pipeline") ? mapConfig["Pipeline"] : nlohmann::ordered_json::object();
+
+    pipeline.numWorkItems = static_cast<u32>(tileWorkItems.size());
+    pipeline.prefetchStage.name = "prefetch";
+    pipeline.prefetchStage.maxWorkers = GetPipelineStageLimit(pipelineConfig, "PrefetchWorkers", 2, numThreads);
+    pipeline.parseStage.name = "parse";
+    pipeline.parseStage.maxWorkers = GetPipelineStageLimit(pipelineConfig, "ParseWorkers", -1, numThreads);
+    pipeline.convertStage.name = "convert";
+    pipeline.convertStage.maxWorkers = GetPipelineStageLimit(pipelineConfig, "ConvertWorkers", -1, numThreads);
+    pipeline.navMeshStage.name = "navmesh";
+    pipeline.navMeshStage.maxWorkers = generateNavMesh ? GetPipelineStageLimit(pipelineConfig, "NavMeshWorkers", -1, numThreads) : 0;
+    pipeline.validationStage.name = "validation";
+    pipeline.validationStage.maxWorkers = settings.loadNavMesh ? GetPipelineStageLimit(pipelineConfig, "ValidationWorkers", -1, numThreads) : 0;
+    pipeline.prefetchedTiles.depth = std::max(1, pipelineConfig.value("PrefetchQueueDepth", 32));
+    pipeline.parsedTiles.depth = std::max(1, pipelineConfig.value("ParseQueueDepth", 16));
+
+    const u32 maxSourceMemoryMB = generateNavMesh ? navMeshConfig.value("MaxSourceMemoryMB", 0u) : 0u;
+    if (maxSourceMemoryMB > 0)
+    {
+        const u64 maxSourceMemory = static_cast<u64>(maxSourceMemoryMB) * 1024 * 1024;
+        pipeline.maxResidentSources = static_cast<u32>(std::max<u64>(1, maxSourceMemory / NavMesh::SourceStore::GetSourceSize()));
+    }
 
-                        for (u32 navIndex = range.start; navIndex < range.end; navIndex++)
-                        {
-                            const u32 tileID = navChunkIDs[navIndex];
-                            const u32 chunkGridPosX = tileID % Terrain::CHUNK_NUM_PER_MAP_STRIDE;
-                            const u32 chunkGridPosY = tileID / Terrain::CHUNK_NUM_PER_MAP_STRIDE;
-                            const NavMesh::TileBuildResult result = worker.BuildTile(navOutputDirectory, internalName, chunkGridPosX, chunkGridPosY);
+    const u32 numStageWorkers = pipeline.prefetchStage.maxWorkers + pipeline.parseStage.maxWorkers + pipeline.convertStage.maxWorkers + pipeline.navMeshStage.maxWorkers + pipeline.validationStage.maxWorkers;
+    const u32 numPipelineWorkers = std::min(numThreads, numStageWorkers);
+    const auto pipelineStart = std::chrono::steady_clock::now();
 
-                            if (result == NavMesh::TileBuildResult::Success)
-                            {
-                                builtNavTileIDs.enqueue(tileID);
-                            }
-                            else if (result == NavMesh::TileBuildResult::SourceMissing)
-                            {
-                                NC_LOG_ERROR("[Map Extractor] Missing NavMesh source for Map Tile ({}_{}_{})", internalName, chunkGridPosX, chunkGridPosY);
-                            }
-                            else if (result == NavMesh::TileBuildResult::Failed)
-                            {
-                                NC_LOG_ERROR("[Map Extractor] Failed to generate NavMesh for Map Tile ({}_{}_{})", internalName, chunkGridPosX, chunkGridPosY);
-                            }
-                        }
-                    });
+    enki::TaskSet convertTilesTask(numPipelineWorkers, [runtime, cascLoader, &tileWorkItems, &pipeline, &settings](enki::TaskSetPartition range, uint32_t threadNum)
+    {
+        ZoneScopedN("MapExtractor::Process::ConvertTilesTask");
 
-                    buildNavMeshTask.m_Priority = enki::TaskPriority::TASK_PRIORITY_HIGH;
-                    runtime->scheduler.AddTaskSetToPipe(&buildNavMeshTask);
-                    runtime->scheduler.WaitforTask(&buildNavMeshTask);
-                    NavMesh::BuildTimings buildTimings;
-                    for (const std::unique_ptr<NavMesh::Worker>& worker : navMeshWorkers)
-                    {
-                        buildTimings.Accumulate(worker->GetBuildTimings());
-                    }
-                    navMeshWorkers.clear();
-                    navSources.Clear();
-                    const f64 navMeshBuildSeconds = std::chrono::duration<f64>(std::chrono::steady_clock::now() - navMeshBuildStart).count();
+        TileScratch scratch;
+        if (settings.extractMapAssets)
+        {
+            scratch.outBytes.reserve(Terrain::CHUNK_ALPHAMAP_TOTAL_BYTE_SIZE);
+            scratch.buffer = Bytebuffer::Borrow<8388608>();
+        }
 
-                    std::vector<u32> builtNavTiles;
-                    builtNavTiles.reserve(navChunkIDs.size());
+        // Drain downstream first, this keeps the number of parsed layouts and NavMesh sources held in memory bounded
+        while (!pipeline.IsFinished())
+        {
+            if (RunValidationStage(pipeline, settings, threadNum))
+                continue;
 
-                    u32 builtNavTileID = 0;
-                    while (builtNavTileIDs.try_dequeue(builtNavTileID))
-                    {
-                        builtNavTiles.push_back(builtNavTileID);
-                    }
+            if (RunNavMeshStage(pipeline, settings, threadNum))
+                continue;
 
-                    std::sort(builtNavTiles.begin(), builtNavTiles.end());
-                    const auto validationStart = std::chrono::steady_clock::now();
-                    if (builtNavTiles.empty())
-                    {
-                        NC_LOG_WARNING("[NavMesh Validator] {} produced no NavMesh tiles to validate", internalName);
-                    }
-                    else if (validateNavMesh)
-                    {
-                        const NavMesh::SeamValidationResult validation = NavMesh::ValidateSeams(navOutputDirectory, internalName, builtNavTiles);
-                        if (validation.failedPairs == 0)
-                        {
-                            NC_LOG_INFO("[NavMesh Validator] {} validated {} traversable seams across {} adjacent tile pairs ({} non-traversable)", internalName, validation.validatedPairs, validation.adjacentPairs, validation.skippedPairs);
-                        }
-                        else
-                        {
-                            NC_LOG_ERROR("[NavMesh Validator] {} failed {} of {} adjacent seam checks", internalName, validation.failedPairs, validation.adjacentPairs);
-                        }
-                    }
-                    else
-                    {
-                        NC_LOG_INFO("[NavMesh Validator] Skipped validation for {}", internalName);
-                    }
-                    const f64 validationSeconds = std::chrono::duration<f64>(std::chrono::steady_clock::now() - validationStart).count();
-                    NC_LOG_INFO("[NavMesh Performance] {}: source {}s, build {}s, validation {}s, {} tiles", internalName, terrainExtractionSeconds, navMeshBuildSeconds, validationSeconds, builtNavTiles.size());
-                    NC_LOG_INFO("[NavMesh Build Phases] {} worker-seconds: total {}, raster {}, compact {}, regions {}, contours {}, polymesh {}, detail {}, Detour/output {}", internalName, buildTimings.totalSeconds, buildTimings.rasterizationSeconds, buildTimings.compactHeightfieldSeconds, buildTimings.regionSeconds, buildTimings.contourSeconds, buildTimings.polyMeshSeconds, buildTimings.detailMeshSeconds, buildTimings.detourAndOutputSeconds);
-                }
-                else
-                {
-                    navSources.Clear();
-                    NC_LOG_INFO("[NavMesh Performance] {}: source {}s, no terrain tiles", internalName, terrainExtractionSeconds);
-                }
-            }
+            if (RunConvertStage(runtime, cascLoader, pipeline, settings, scratch))
+                continue;
 
-            if (extractMapAssets)
-            {
-                u64 chunkHash = 0;
-                u32 numHashes = static_cast<u32>(mapChunkHashes.size_approx());
-                mapHeader.chunkHashes.reserve(numHashes);
+            if (RunParseStage(runtime, pipeline, settings, scratch))
+                continue;
 
-                while (mapChunkHashes.try_dequeue(chunkHash))
-                {
-                    mapHeader.chunkHashes.push_back(chunkHash);
-                }
-            }
+            if (RunPrefetchStage(runtime, cascLoader, pipeline, tileWorkItems, settings))
+                continue;
+
+            std::this_thread::yield();
         }
+    });
 
-        if (!extractMapAssets)
-            return true;
+    if (!tileWorkItems.empty())
+    {
+        convertTilesTask.m_Priority = enki::TaskPriority::TASK_PRIORITY_HIGH;
+        runtime->scheduler.AddTaskSetToPipe(&convertTilesTask);
+        runtime->scheduler.WaitforTask(&convertTilesTask);
 
-        std::shared_ptr<Bytebuffer> buffer = Bytebuffer::Borrow<1048576>();
-        if (mapHeader.Save(buffer))
+        const f64 pipelineSeconds = std::chrono::duration<f64>(std::chrono::steady_clock::now() - pipelineStart).count();
+        LogPipelineStage(pipeline.prefetchStage, pipelineSeconds);
+        LogPipelineStage(pipeline.parseStage, pipelineSeconds);
+        LogPipelineStage(pipeline.convertStage, pipelineSeconds);
+
+        if (generateNavMesh)
         {
-            std::string mapHeaderPath = "map/" + internalName + "/" + internalName + Map::HEADER_FILE_EXTENSION;
-            auto& manifest = runtime->pactInfo.GetManifestForFile(runtime, buffer->writtenData);
-            if (manifest.AddFile(runtime, mapHeaderPath, buffer))
+            LogPipelineStage(pipeline.navMeshStage, pipelineSeconds);
+            if (settings.loadNavMesh)
+                LogPipelineStage(pipeline.validationStage, pipelineSeconds);
+
+            const u32 peakResidentSources = pipeline.peakResidentSources.load(std::memory_order_relaxed);
+            const f64 peakSourceMemoryMB = static_cast<f64>(peakResidentSources) * static_cast<f64>(NavMesh::SourceStore::GetSourceSize()) / (1024.0 * 1024.0);
+            if (maxSourceMemoryMB > 0)
             {
-                NC_LOG_INFO("[Map Extractor] Extracted {0}", internalName);
+                NC_LOG_INFO("[NavMesh Performance] Peak resident sources: {} ({} MB, soft limit {} MB)", peakResidentSources, peakSourceMemoryMB, maxSourceMemoryMB);
             }
             else
             {
-                NC_LOG_WARNING("[Map Extractor] Failed to add {0} to PACT storage", internalName);
+                NC_LOG_INFO("[NavMesh Performance] Peak resident sources: {} ({} MB)", peakResidentSources, peakSourceMemoryMB);
             }
-        }
-        else
-        {
-            NC_LOG_WARNING("[Map Extractor] Failed to extract {0}", internalName);
-        }
 
-        return true;
-    });
+            if (settings.benchmarkNavMesh)
+                RunNavMeshBenchmarks(mapContexts, settings);
+        }
+    }
 }
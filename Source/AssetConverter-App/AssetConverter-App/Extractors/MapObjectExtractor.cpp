@@ -1,8 +1,11 @@
 #include "MapObjectExtractor.h"
+#include "DependencyResolver.h"
 #include "AssetConverter-App/Runtime.h"
 #include "AssetConverter-App/Casc/CascLoader.h"
 #include "AssetConverter-App/Util/JoltStream.h"
+#include "AssetConverter-App/Util/MeshOptimizer.h"
 #include "AssetConverter-App/Util/ServiceLocator.h"
+#include "AssetConverter-App/Util/VertexQuantizer.h"
 
 #include <Base/Container/ConcurrentQueue.h>
 #include <Base/Util/DebugHandler.h>
@@ -48,6 +51,8 @@ void MapObjectExtractor::Process()
         for (u32 index = range.start; index < range.end; index++)
         {
             u32 wmoFileID = wmoFileIDs[index];
+            if (!DependencyResolver::IsModelReachable(wmoFileID))
+                continue;
 
             // Determine if the wmo is a root file
             {
@@ -93,7 +98,15 @@ void MapObjectExtractor::Process()
     u32 numRootFiles = static_cast<u32>(fileListQueue.size_approx());
     NC_LOG_INFO("[MapObject Extractor] Processing {0} files", numRootFiles);
 
-    enki::TaskSet convertWMOTask(numRootFiles, [&runtime, &cascLoader, &fileListQueue, &numProcessedFiles, &progressFlags, &printMutex, numRootFiles](enki::TaskSetPartition range, uint32_t threadNum)
+    const auto& mapObjectConfig = runtime->json["Extraction"]["MapObject"];
+    const bool optimizeGeometry = mapObjectConfig.value("OptimizeGeometry", false);
+    MeshOptimizer::Statistics geometryStatistics;
+
+    VertexQuantizer::Tolerances vertexTolerances;
+    const bool compactVertices = VertexQuantizer::LoadTolerances("MapObject", vertexTolerances);
+    VertexQuantizer::Statistics vertexStatistics;
+
+    enki::TaskSet convertWMOTask(numRootFiles, [&runtime, &cascLoader, &fileListQueue, &numProcessedFiles, &progressFlags, &printMutex, &geometryStatistics, &vertexTolerances, &vertexStatistics, numRootFiles, optimizeGeometry, compactVertices](enki::TaskSetPartition range, uint32_t threadNum)
     {
         Wmo::Parser wmoParser = { };
         std::shared_ptr<Bytebuffer> buffer;
@@ -193,6 +206,9 @@ void MapObjectExtractor::Process()
             if (!Model::ComplexModel::FromMapObject(mapObject, cmodel))
                 continue;
 
+            if (optimizeGeometry)
+                MeshOptimizer::Optimize(cmodel, fileListEntry.fileName, "MapObject Extractor", geometryStatistics);
+
             // if build physics shapes
             {
                 u32 numCollisionVertices = static_cast<u32>(cmodel.collisionVertexPositions.size());
@@ -277,6 +293,9 @@ void MapObjectExtractor::Process()
                     {
                         NC_LOG_INFO("[MapObject Extractor] Extracted {0}", fileListEntry.fileName);
                     }
+
+                    if (compactVertices)
+                        VertexQuantizer::SaveCompactVertices(cmodel, vertexTolerances, fileListEntry.path, "MapObject Extractor", vertexStatistics);
                 }
                 else
                 {
@@ -309,4 +328,10 @@ void MapObjectExtractor::Process()
     convertWMOTask.m_Priority = enki::TaskPriority::TASK_PRIORITY_HIGH;
     runtime->scheduler.AddTaskSetToPipe(&convertWMOTask);
     runtime->scheduler.WaitforTask(&convertWMOTask);
+
+    if (optimizeGeometry)
+        MeshOptimizer::LogStatistics("MapObject Extractor", geometryStatistics);
+
+    if (compactVertices)
+        VertexQuantizer::LogStatistics("MapObject Extractor", vertexStatistics);
 }
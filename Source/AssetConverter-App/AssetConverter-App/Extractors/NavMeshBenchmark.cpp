@@ -0,0 +1,290 @@
+#include "NavMeshBenchmark.h"
+#include "NavMeshCommon.h"
+#include "NavMeshContainer.h"
+
+#include <Base/Util/DebugHandler.h>
+
+#include <FileFormat/Shared.h>
+
+#include <Detour/DetourCommon.h>
+#include <Detour/DetourNavMesh.h>
+#include <Detour/DetourNavMeshQuery.h>
+#include <Detour/DetourNode.h>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace
+{
+    constexpr f32 NEAREST_POLY_HALF_EXTENTS[3] = { 2.0f, 4.0f, 2.0f };
+
+    struct PolySample
+    {
+        const dtMeshTile* tile = nullptr;
+        u32 polyIndex = 0;
+    };
+
+    struct BenchmarkQuery
+    {
+        f32 start[3] = { 0.0f, 0.0f, 0.0f };
+        f32 end[3] = { 0.0f, 0.0f, 0.0f };
+    };
+
+    class LatencyRecorder
+    {
+    public:
+        void Record(std::chrono::steady_clock::time_point start, bool succeeded)
+        {
+            _latencies.push_back(std::chrono::duration<f64, std::micro>(std::chrono::steady_clock::now() - start).count());
+            _numSucceeded += succeeded ? 1 : 0;
+        }
+
+        void Finish(NavMesh::Benchmark::QueryStats& stats)
+        {
+            stats = NavMesh::Benchmark::QueryStats();
+            stats.numQueries = static_cast<u32>(_latencies.size());
+            stats.numSucceeded = _numSucceeded;
+            if (_latencies.empty())
+                return;
+
+            for (f64 latency : _latencies)
+            {
+                stats.totalSeconds += latency / 1e6;
+            }
+            stats.queriesPerSecond = stats.totalSeconds > 0.0 ? static_cast<f64>(stats.numQueries) / stats.totalSeconds : 0.0;
+
+            std::sort(_latencies.begin(), _latencies.end());
+            auto getPercentile = [this](f64 percentile)
+            {
+                const size_t index = static_cast<size_t>(percentile * static_cast<f64>(_latencies.size()));
+                return _latencies[std::min(index, _latencies.size() - 1)];
+            };
+
+            stats.p50 = getPercentile(0.5);
+            stats.p90 = getPercentile(0.9);
+            stats.p99 = getPercentile(0.99);
+            stats.max = _latencies.back();
+        }
+
+    private:
+        std::vector<f64> _latencies;
+        u32 _numSucceeded = 0;
+    };
+
+    // std::uniform_*_distribution differ between standard libraries, mt19937 itself does not
+    u32 GetRandomIndex(std::mt19937& random, u32 count)
+    {
+        return static_cast<u32>(random() % count);
+    }
+
+    f32 GetRandomFloat(std::mt19937& random)
+    {
+        return static_cast<f32>(random() >> 8) * (1.0f / 16777216.0f);
+    }
+
+    void GetRandomPoint(std::mt19937& random, const PolySample& sample, f32* point)
+    {
+        const dtPoly& poly = sample.tile->polys[sample.polyIndex];
+
+        f32 vertices[DT_VERTS_PER_POLYGON * 3];
+        f32 areas[DT_VERTS_PER_POLYGON];
+        for (u32 vertexIndex = 0; vertexIndex < poly.vertCount; vertexIndex++)
+        {
+            dtVcopy(&vertices[vertexIndex * 3], &sample.tile->verts[poly.verts[vertexIndex] * 3]);
+        }
+
+        const f32 s = GetRandomFloat(random);
+        const f32 t = GetRandomFloat(random);
+        dtRandomPointInConvexPoly(vertices, poly.vertCount, areas, s, t, point);
+    }
+}
+
+bool NavMesh::Benchmark::Run(const std::filesystem::path& containerPath, const Settings& settings, Result& result)
+{
+    result = Result();
+
+    NavMesh::Container::Reader reader;
+    if (!reader.Open(containerPath))
+    {
+        NC_LOG_ERROR("[NavMesh Benchmark] Failed to open NavMesh container {}", containerPath.string());
+        return false;
+    }
+
+    const std::vector<NavMesh::Container::TileEntry>& tileEntries = reader.GetTileEntries();
+    if (tileEntries.empty())
+        return false;
+
+    const NavMesh::Container::NavMeshParams& containerParams = reader.GetParams();
+    dtNavMeshParams params{};
+    dtVcopy(params.orig, containerParams.origin);
+    params.tileWidth = containerParams.tileWidth;
+    params.tileHeight = containerParams.tileHeight;
+    params.maxTiles = containerParams.maxTiles;
+    params.maxPolys = containerParams.maxPolys;
+
+    // Declared before the dtNavMesh that links into them so they outlive it
+    std::vector<std::vector<u8>> tileBytes(tileEntries.size());
+    std::unique_ptr<dtNavMesh, decltype(&dtFreeNavMesh)> navMesh(dtAllocNavMesh(), &dtFreeNavMesh);
+    if (!navMesh || dtStatusFailed(navMesh->init(&params)))
+    {
+        NC_LOG_ERROR("[NavMesh Benchmark] Failed to initialize the dtNavMesh for {}", containerPath.string());
+        return false;
+    }
+
+    std::vector<PolySample> samples;
+    std::vector<u32> tileFirstSamples(Terrain::CHUNK_NUM_PER_MAP, 0);
+    std::vector<u32> tileEndSamples(Terrain::CHUNK_NUM_PER_MAP, 0);
+    std::vector<u32> sampleTileIDs;
+    std::vector<u8> heightData;
+    for (u32 tileIndex = 0; tileIndex < tileEntries.size(); tileIndex++)
+    {
+        const NavMesh::Container::TileEntry& tileEntry = tileEntries[tileIndex];
+        std::vector<u8>& bytes = tileBytes[tileIndex];
+        if (tileEntry.tileID >= Terrain::CHUNK_NUM_PER_MAP || !reader.ReadTile(tileEntry, bytes, heightData) || bytes.size() < sizeof(dtMeshHeader))
+            continue;
+
+        // Detour links the tiles in place, the bytes stay owned by tileBytes
+        const dtMeshHeader* header = reinterpret_cast<const dtMeshHeader*>(bytes.data());
+        dtTileRef tileRef = 0;
+        if (dtStatusFailed(navMesh->addTile(bytes.data(), static_cast<i32>(bytes.size()), 0, 0, &tileRef)))
+        {
+            const u32 chunkX = tileEntry.tileID % Terrain::CHUNK_NUM_PER_MAP_STRIDE;
+            const u32 chunkY = tileEntry.tileID / Terrain::CHUNK_NUM_PER_MAP_STRIDE;
+            NC_LOG_ERROR("[NavMesh Benchmark] Failed to add NavMesh tile ({}_{}) of {}", chunkX, chunkY, containerPath.string());
+            continue;
+        }
+
+        result.numTiles++;
+        result.numPolys += static_cast<u32>(header->polyCount);
+        result.numVerts += static_cast<u32>(header->vertCount);
+        result.numDetailTris += static_cast<u32>(header->detailTriCount);
+        result.maxTileVerts = std::max(result.maxTileVerts, static_cast<u32>(header->vertCount));
+        if (static_cast<u32>(header->polyCount) > result.maxTilePolys)
+        {
+            result.maxTilePolys = static_cast<u32>(header->polyCount);
+            result.maxPolysTileID = tileEntry.tileID;
+        }
+
+        const dtMeshTile* tile = navMesh->getTileByRef(tileRef);
+        tileFirstSamples[tileEntry.tileID] = static_cast<u32>(samples.size());
+        for (i32 polyIndex = 0; polyIndex < tile->header->polyCount; polyIndex++)
+        {
+            const dtPoly& poly = tile->polys[polyIndex];
+            if ((poly.flags & NavMesh::WALKABLE_POLY_FLAG) != 0 && poly.getType() == DT_POLYTYPE_GROUND && poly.vertCount >= 3)
+                samples.push_back({ tile, static_cast<u32>(polyIndex) });
+        }
+        tileEndSamples[tileEntry.tileID] = static_cast<u32>(samples.size());
+        sampleTileIDs.resize(samples.size(), tileEntry.tileID);
+    }
+
+    if (samples.empty() || settings.numQueries == 0)
+        return result.numTiles > 0;
+
+    // Drawn up front so the timings only cover Detour
+    std::mt19937 random(settings.seed);
+    std::vector<BenchmarkQuery> queries(settings.numQueries);
+    const i32 pathTileRadius = static_cast<i32>(settings.pathTileRadius);
+    for (BenchmarkQuery& query : queries)
+    {
+        const u32 startSample = GetRandomIndex(random, static_cast<u32>(samples.size()));
+        const u32 startTileID = sampleTileIDs[startSample];
+        GetRandomPoint(random, samples[startSample], query.start);
+
+        const i32 endX = static_cast<i32>(startTileID % Terrain::CHUNK_NUM_PER_MAP_STRIDE) + static_cast<i32>(GetRandomIndex(random, pathTileRadius * 2 + 1)) - pathTileRadius;
+        const i32 endY = static_cast<i32>(startTileID / Terrain::CHUNK_NUM_PER_MAP_STRIDE) + static_cast<i32>(GetRandomIndex(random, pathTileRadius * 2 + 1)) - pathTileRadius;
+        u32 endTileID = startTileID;
+        if (endX >= 0 && endY >= 0 && endX < static_cast<i32>(Terrain::CHUNK_NUM_PER_MAP_STRIDE) && endY < static_cast<i32>(Terrain::CHUNK_NUM_PER_MAP_STRIDE))
+        {
+            const u32 tileID = static_cast<u32>(endX + endY * static_cast<i32>(Terrain::CHUNK_NUM_PER_MAP_STRIDE));
+            if (tileEndSamples[tileID] > tileFirstSamples[tileID])
+                endTileID = tileID;
+        }
+
+        const u32 endSample = tileFirstSamples[endTileID] + GetRandomIndex(random, tileEndSamples[endTileID] - tileFirstSamples[endTileID]);
+        GetRandomPoint(random, samples[endSample], query.end);
+    }
+
+    std::unique_ptr<dtNavMeshQuery, decltype(&dtFreeNavMeshQuery)> navMeshQuery(dtAllocNavMeshQuery(), &dtFreeNavMeshQuery);
+    if (!navMeshQuery || dtStatusFailed(navMeshQuery->init(navMesh.get(), static_cast<i32>(std::max(1u, settings.maxNodes)))))
+    {
+        NC_LOG_ERROR("[NavMesh Benchmark] Failed to initialize the dtNavMeshQuery for {}", containerPath.string());
+        return false;
+    }
+
+    dtQueryFilter filter;
+    filter.setIncludeFlags(NavMesh::WALKABLE_POLY_FLAG);
+    filter.setExcludeFlags(0);
+
+    const u32 maxPathPolys = std::max(1u, settings.maxPathPolys);
+    std::vector<dtPolyRef> path(maxPathPolys);
+    std::vector<f32> straightPath(static_cast<size_t>(maxPathPolys) * 3);
+    std::vector<u8> straightPathFlags(maxPathPolys);
+    std::vector<dtPolyRef> straightPathRefs(maxPathPolys);
+
+    LatencyRecorder nearestPoly;
+    LatencyRecorder pathLatencies;
+    LatencyRecorder straightPathLatencies;
+    LatencyRecorder raycast;
+    u64 totalPathNodes = 0;
+    for (const BenchmarkQuery& query : queries)
+    {
+        dtPolyRef startRef = 0;
+        dtPolyRef endRef = 0;
+        f32 start[3];
+        f32 end[3];
+
+        auto queryStart = std::chrono::steady_clock::now();
+        dtStatus status = navMeshQuery->findNearestPoly(query.start, NEAREST_POLY_HALF_EXTENTS, &filter, &startRef, start);
+        nearestPoly.Record(queryStart, dtStatusSucceed(status) && startRef != 0);
+
+        queryStart = std::chrono::steady_clock::now();
+        status = navMeshQuery->findNearestPoly(query.end, NEAREST_POLY_HALF_EXTENTS, &filter, &endRef, end);
+        nearestPoly.Record(queryStart, dtStatusSucceed(status) && endRef != 0);
+
+        if (!startRef || !endRef)
+            continue;
+
+        i32 pathCount = 0;
+        queryStart = std::chrono::steady_clock::now();
+        status = navMeshQuery->findPath(startRef, endRef, start, end, &filter, path.data(), &pathCount, static_cast<i32>(maxPathPolys));
+        const bool isPartial = dtStatusDetail(status, DT_PARTIAL_RESULT);
+        pathLatencies.Record(queryStart, dtStatusSucceed(status) && !isPartial && pathCount > 0);
+
+        const u32 numPathNodes = static_cast<u32>(navMeshQuery->getNodePool()->getNodeCount());
+        totalPathNodes += numPathNodes;
+        result.maxPathNodes = std::max(result.maxPathNodes, numPathNodes);
+        result.numOutOfNodes += dtStatusDetail(status, DT_OUT_OF_NODES) ? 1 : 0;
+        result.numPartialPaths += isPartial ? 1 : 0;
+
+        if (dtStatusSucceed(status) && pathCount > 0)
+        {
+            // A partial path ends short of the target, the corridor has to end on its last polygon
+            f32 pathEnd[3];
+            dtVcopy(pathEnd, end);
+            if (path[pathCount - 1] != endRef)
+                navMeshQuery->closestPointOnPoly(path[pathCount - 1], end, pathEnd, nullptr);
+
+            i32 straightPathCount = 0;
+            queryStart = std::chrono::steady_clock::now();
+            status = navMeshQuery->findStraightPath(start, pathEnd, path.data(), pathCount, straightPath.data(), straightPathFlags.data(), straightPathRefs.data(), &straightPathCount, static_cast<i32>(maxPathPolys), 0);
+            straightPathLatencies.Record(queryStart, dtStatusSucceed(status) && straightPathCount > 0);
+        }
+
+        f32 hitTime = 0.0f;
+        f32 hitNormal[3];
+        i32 raycastCount = 0;
+        queryStart = std::chrono::steady_clock::now();
+        status = navMeshQuery->raycast(startRef, start, end, &filter, &hitTime, hitNormal, path.data(), &raycastCount, static_cast<i32>(maxPathPolys));
+        raycast.Record(queryStart, dtStatusSucceed(status));
+    }
+
+    nearestPoly.Finish(result.nearestPoly);
+    pathLatencies.Finish(result.path);
+    straightPathLatencies.Finish(result.straightPath);
+    raycast.Finish(result.raycast);
+    result.averagePathNodes = result.path.numQueries > 0 ? static_cast<f64>(totalPathNodes) / static_cast<f64>(result.path.numQueries) : 0.0;
+    return true;
+}
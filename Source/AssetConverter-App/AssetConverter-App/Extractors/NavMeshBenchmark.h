@@ -0,0 +1,57 @@
+#pragma once
+
+#include <Base/Types.h>
+
+#include <filesystem>
+
+namespace NavMesh::Benchmark
+{
+    // Start points are drawn from every walkable polygon of the map, end points from the tiles within
+    // pathTileRadius of the start tile. The same seed always yields the same queries for the same tiles.
+    struct Settings
+    {
+        u32 seed = 1;
+        u32 numQueries = 1000;
+        u32 maxNodes = 2048;
+        u32 maxPathPolys = 256;
+        u32 pathTileRadius = 1;
+    };
+
+    // Latencies in microseconds, succeeded counts the queries that returned a complete result
+    struct QueryStats
+    {
+        u32 numQueries = 0;
+        u32 numSucceeded = 0;
+        f64 totalSeconds = 0.0;
+        f64 queriesPerSecond = 0.0;
+        f64 p50 = 0.0;
+        f64 p90 = 0.0;
+        f64 p99 = 0.0;
+        f64 max = 0.0;
+    };
+
+    struct Result
+    {
+        u32 numTiles = 0;
+        u32 numPolys = 0;
+        u32 numVerts = 0;
+        u32 numDetailTris = 0;
+        u32 maxTilePolys = 0;
+        u32 maxTileVerts = 0;
+        u32 maxPolysTileID = 0;
+
+        QueryStats nearestPoly;
+        QueryStats path;
+        QueryStats straightPath;
+        QueryStats raycast;
+
+        // Nodes findPath took from the query's node pool, outOfNodes counts the searches that exhausted it
+        f64 averagePathNodes = 0.0;
+        u32 maxPathNodes = 0;
+        u32 numOutOfNodes = 0;
+        u32 numPartialPaths = 0;
+    };
+
+    // Loads every tile of a NavMesh container into one dtNavMesh and runs the queries on the calling thread
+    bool Run(const std::filesystem::path& containerPath, const Settings& settings, Result& result);
+}
@@ -1,18 +1,28 @@
 #include "NavMeshBuilder.h"
+#include "NavMeshCommon.h"
+#include "NavMeshCompactHeight.h"
+#include "NavMeshTileCache.h"
 
 #include <FileFormat/Novus/Map/MapChunk.h>
 #include <FileFormat/Warcraft/ADT/Adt.h>
 
 #include <Recast/Recast.h>
+#include <Recast/RecastAlloc.h>
 #include <Detour/DetourNavMeshBuilder.h>
 
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <xxhash/xxhash64.h>
+
 #include <algorithm>
 #include <array>
 #include <chrono>
 #include <cmath>
+#include <cstdlib>
 #include <cstring>
 #include <fstream>
 #include <limits>
+#include <mutex>
 #include <system_error>
 #include <utility>
 #include <vector>
@@ -24,33 +34,58 @@ namespace
         // Keep tile boundaries exact while aligning each terrain patch to ten
         // horizontal voxels. This cuts horizontal voxel work by 36% without
         // discarding any source terrain samples.
-        constexpr i32 TILE_VOXEL_SIZE = Terrain::CHUNK_NUM_CELLS_PER_STRIDE * Terrain::CELL_NUM_PATCHES_PER_STRIDE * 10;
+        constexpr i32 PATCH_VOXEL_SIZE = 10;
+        constexpr i32 TILE_VOXEL_SIZE = Terrain::CHUNK_NUM_CELLS_PER_STRIDE * Terrain::CELL_NUM_PATCHES_PER_STRIDE * PATCH_VOXEL_SIZE;
+        constexpr i32 MAP_VOXEL_SIZE = Terrain::CHUNK_NUM_PER_MAP_STRIDE * TILE_VOXEL_SIZE;
         constexpr f32 CELL_SIZE = Terrain::CHUNK_SIZE / static_cast<f32>(TILE_VOXEL_SIZE);
         constexpr f32 CELL_HEIGHT = 0.20f;
+        constexpr i32 TILE_CACHE_TILE_VOXEL_SIZE = TILE_VOXEL_SIZE / NavMesh::TileCache::TILES_PER_CHUNK_STRIDE;
+        static_assert(TILE_VOXEL_SIZE % NavMesh::TileCache::TILES_PER_CHUNK_STRIDE == 0);
+        static_assert(TILE_CACHE_TILE_VOXEL_SIZE <= 255);
 
-        i32 GetWalkableHeight()
+        i32 GetWalkableHeight(const NavMesh::AgentSettings& agent)
         {
-            return static_cast<i32>(std::ceil(NavMesh::Agent::HEIGHT / CELL_HEIGHT));
+            return static_cast<i32>(std::ceil(agent.height / CELL_HEIGHT));
         }
 
-        i32 GetWalkableClimb()
+        i32 GetWalkableClimb(const NavMesh::AgentSettings& agent)
         {
-            return static_cast<i32>(std::floor(NavMesh::Agent::MAX_CLIMB / CELL_HEIGHT));
+            return static_cast<i32>(std::floor(agent.maxClimb / CELL_HEIGHT));
         }
 
-        i32 GetWalkableRadius()
+        i32 GetWalkableRadius(const NavMesh::AgentSettings& agent)
         {
-            return static_cast<i32>(std::ceil(NavMesh::Agent::RADIUS / CELL_SIZE));
+            return static_cast<i32>(std::ceil(agent.radius / CELL_SIZE));
         }
 
-        i32 GetBorderSize()
+        // The heightfield is shared by all agents, so its border has to fit the widest one
+        i32 GetBorderSize(const NavMesh::BuildSettings& buildSettings)
         {
-            return GetWalkableRadius() + 3;
+            i32 walkableRadius = 0;
+            for (const NavMesh::AgentSettings& agent : buildSettings.agents)
+            {
+                walkableRadius = std::max(walkableRadius, GetWalkableRadius(agent));
+            }
+
+            return walkableRadius + 3;
         }
 
-        f32 GetBorderWorldSize()
+        f32 GetBorderWorldSize(const NavMesh::BuildSettings& buildSettings)
         {
-            return static_cast<f32>(GetBorderSize()) * CELL_SIZE;
+            return static_cast<f32>(GetBorderSize(buildSettings)) * CELL_SIZE;
+        }
+
+        // Rasterization merges the area flags of spans whose tops are within this many voxels, the lowest
+        // climb of all agents keeps the shared heightfield conservative for each of them
+        i32 GetRasterizationClimb(const NavMesh::BuildSettings& buildSettings)
+        {
+            i32 walkableClimb = std::numeric_limits<i32>::max();
+            for (const NavMesh::AgentSettings& agent : buildSettings.agents)
+            {
+                walkableClimb = std::min(walkableClimb, GetWalkableClimb(agent));
+            }
+
+            return buildSettings.agents.empty() ? 0 : walkableClimb;
         }
 
         i32 GetHorizontalVoxelDistance(f32 worldDistance)
@@ -74,6 +109,10 @@ namespace
         }
     }
 
+    // Part of every tile's source hash, bump it whenever the output changes for the same sources and
+    // settings so incremental builds do not keep stale tiles
+    constexpr u32 BUILDER_VERSION = 3;
+
     struct NavSourceData
     {
         std::array<f32, NavMesh::TerrainHeight::HEIGHT_COUNT> heights;
@@ -83,12 +122,40 @@ namespace
         NavMesh::TerrainHeight::HEIGHT_DATA_SIZE +
         NavMesh::TerrainHeight::HOLE_DATA_SIZE);
 
+    // The sources of the 3x3 chunks around a tile, read directly by the terrain grid rasterizer
+    struct TerrainNeighbourhood
+    {
+        i32 chunkX = 0;
+        i32 chunkY = 0;
+        std::array<const NavSourceData*, 9> sources = { };
+
+        const NavSourceData* GetSource(i32 sourceChunkX, i32 sourceChunkY) const
+        {
+            const i32 offsetX = sourceChunkX - chunkX + 1;
+            const i32 offsetY = sourceChunkY - chunkY + 1;
+            if (offsetX < 0 || offsetX > 2 || offsetY < 0 || offsetY > 2)
+                return nullptr;
+
+            return sources[offsetX + offsetY * 3];
+        }
+    };
+
     struct CellTriangle
     {
         u16 vertexIDs[3];
         u8 patchID;
     };
 
+    // An object placement resolved into NavMesh space, the bounds let tiles it cannot reach skip it
+    struct NavObjectPlacement
+    {
+        std::shared_ptr<const NavMesh::CollisionMesh> mesh;
+        u32 uniqueID = 0;
+        glm::mat4 transform = glm::mat4(1.0f);
+        vec3 boundsMin = vec3(0.0f);
+        vec3 boundsMax = vec3(0.0f);
+    };
+
     struct RecastBuildState
     {
         rcHeightfield* solid = nullptr;
@@ -96,6 +163,7 @@ namespace
         rcContourSet* contourSet = nullptr;
         rcPolyMesh* polyMesh = nullptr;
         rcPolyMeshDetail* detailMesh = nullptr;
+        rcHeightfieldLayerSet* layerSet = nullptr;
 
         ~RecastBuildState()
         {
@@ -113,6 +181,9 @@ namespace
 
             if (detailMesh)
                 rcFreePolyMeshDetail(detailMesh);
+
+            if (layerSet)
+                rcFreeHeightfieldLayerSet(layerSet);
         }
     };
 
@@ -135,6 +206,183 @@ namespace
         std::chrono::steady_clock::time_point _start;
     };
 
+    // Bump allocator for everything Recast allocates while building one tile. Frees are no-ops and the
+    // whole arena is rewound once the tile is done, so the blocks are reused for the next tile. Blocks
+    // beyond MAX_RETAINED_SIZE are released on reset, a tile that needed more doesn't pin it forever.
+    class RecastArena
+    {
+    public:
+        static constexpr size_t BLOCK_SIZE = 8 * 1024 * 1024;
+        static constexpr size_t MAX_RETAINED_SIZE = 64 * 1024 * 1024;
+        static constexpr size_t ALIGNMENT = 16;
+
+        struct Marker
+        {
+            size_t block = 0;
+            size_t used = 0;
+        };
+
+        void* Allocate(size_t size)
+        {
+            size = (size + (ALIGNMENT - 1)) & ~(ALIGNMENT - 1);
+
+            for (; _currentBlock < _blocks.size(); _currentBlock++)
+            {
+                Block& block = _blocks[_currentBlock];
+                if (block.size - block.used < size)
+                    continue;
+
+                void* allocation = block.data.get() + block.used;
+                block.used += size;
+                return allocation;
+            }
+
+            Block& block = _blocks.emplace_back();
+            block.size = std::max(BLOCK_SIZE, size);
+            block.data.reset(new u8[block.size]);
+            block.used = size;
+            return block.data.get();
+        }
+
+        bool Owns(const void* pointer) const
+        {
+            const u8* bytes = static_cast<const u8*>(pointer);
+            for (const Block& block : _blocks)
+            {
+                if (bytes >= block.data.get() && bytes < block.data.get() + block.size)
+                    return true;
+            }
+
+            return false;
+        }
+
+        void Reset()
+        {
+            size_t retainedSize = 0;
+            size_t numRetainedBlocks = 0;
+            for (; numRetainedBlocks < _blocks.size(); numRetainedBlocks++)
+            {
+                Block& block = _blocks[numRetainedBlocks];
+                if (retainedSize + block.size > MAX_RETAINED_SIZE)
+                    break;
+
+                retainedSize += block.size;
+                block.used = 0;
+            }
+
+            _blocks.erase(_blocks.begin() + numRetainedBlocks, _blocks.end());
+            _currentBlock = 0;
+        }
+
+        Marker GetMarker() const
+        {
+            Marker marker;
+            marker.block = _currentBlock;
+            marker.used = _currentBlock < _blocks.size() ? _blocks[_currentBlock].used : 0;
+            return marker;
+        }
+
+        // Frees everything allocated since the marker was taken
+        void Rewind(const Marker& marker)
+        {
+            for (size_t blockIndex = marker.block; blockIndex < _blocks.size(); blockIndex++)
+            {
+                _blocks[blockIndex].used = blockIndex == marker.block ? marker.used : 0;
+            }
+
+            _currentBlock = marker.block;
+        }
+
+    private:
+        struct Block
+        {
+            std::unique_ptr<u8[]> data;
+            size_t size = 0;
+            size_t used = 0;
+        };
+
+        std::vector<Block> _blocks;
+        size_t _currentBlock = 0;
+    };
+
+    // Every scheduler thread keeps one arena for all the Workers and maps it builds tiles for.
+    // rcAllocSetCustom is process wide, the hooks route to that arena while a tile is being built
+    // on the calling thread and fall back to the heap everywhere else.
+    thread_local RecastArena threadRecastArena;
+    thread_local RecastArena* currentRecastArena = nullptr;
+
+    void* AllocateRecastMemory(size_t size, rcAllocHint /*hint*/)
+    {
+        if (currentRecastArena)
+            return currentRecastArena->Allocate(size);
+
+        return std::malloc(size);
+    }
+
+    void FreeRecastMemory(void* pointer)
+    {
+        if (!pointer)
+            return;
+
+        if (currentRecastArena && currentRecastArena->Owns(pointer))
+            return;
+
+        std::free(pointer);
+    }
+
+    void InstallRecastAllocator()
+    {
+        static std::once_flag installFlag;
+        std::call_once(installFlag, []()
+        {
+            rcAllocSetCustom(&AllocateRecastMemory, &FreeRecastMemory);
+        });
+    }
+
+    class ScopedRecastArena
+    {
+    public:
+        ScopedRecastArena()
+            : _previousArena(currentRecastArena)
+        {
+            currentRecastArena = &threadRecastArena;
+        }
+
+        ~ScopedRecastArena()
+        {
+            currentRecastArena = _previousArena;
+
+            // A nested scope leaves the allocations of the outer one alone
+            if (!_previousArena)
+                threadRecastArena.Reset();
+        }
+
+    private:
+        RecastArena* _previousArena;
+    };
+
+    // Rewinds the current arena on scope exit, for scratch work that is discarded before the tile is done
+    class ScopedRecastArenaMarker
+    {
+    public:
+        ScopedRecastArenaMarker()
+            : _arena(currentRecastArena)
+        {
+            if (_arena)
+                _marker = _arena->GetMarker();
+        }
+
+        ~ScopedRecastArenaMarker()
+        {
+            if (_arena)
+                _arena->Rewind(_marker);
+        }
+
+    private:
+        RecastArena* _arena;
+        RecastArena::Marker _marker;
+    };
+
     vec2 GetCellVertexPosition(u32 cellID, u32 vertexID)
     {
         const i32 cellX = cellID % Terrain::CHUNK_NUM_CELLS_PER_STRIDE;
@@ -262,7 +510,350 @@ namespace
         }
     }
 
-    bool WriteTerrainHeightTile(const std::filesystem::path& path, u32 chunkX, u32 chunkY, const NavSourceData& source)
+    // Terrain chunks extend towards -Z in Novus space and towards +Z in the NavMesh grid, both spaces
+    // only differ by the sign of Z
+    glm::mat4 GetObjectTransform(const NavMesh::ObjectPlacement& placement)
+    {
+        const glm::mat4 novusToNavMesh = glm::scale(glm::mat4(1.0f), vec3(1.0f, 1.0f, -1.0f));
+        const glm::mat4 placementMatrix = glm::translate(glm::mat4(1.0f), placement.position) * glm::mat4_cast(placement.rotation) * glm::scale(glm::mat4(1.0f), vec3(placement.scale));
+        return novusToNavMesh * placementMatrix;
+    }
+
+    void GetObjectBounds(const NavMesh::CollisionMesh& mesh, const glm::mat4& transform, vec3& boundsMin, vec3& boundsMax)
+    {
+        boundsMin = vec3(std::numeric_limits<f32>::max());
+        boundsMax = vec3(std::numeric_limits<f32>::lowest());
+
+        for (u32 corner = 0; corner < 8; corner++)
+        {
+            const vec3 localCorner((corner & 1) ? mesh.boundsMax.x : mesh.boundsMin.x,
+                (corner & 2) ? mesh.boundsMax.y : mesh.boundsMin.y,
+                (corner & 4) ? mesh.boundsMax.z : mesh.boundsMin.z);
+            const vec3 worldCorner = vec3(transform * glm::vec4(localCorner, 1.0f));
+            boundsMin = glm::min(boundsMin, worldCorner);
+            boundsMax = glm::max(boundsMax, worldCorner);
+        }
+    }
+
+    // Appends the triangles of one placed object that overlap the padded tile, only their vertices are copied
+    void AppendObjectGeometry(const NavObjectPlacement& placement, const vec2& paddedMin, const vec2& paddedMax, std::vector<vec3>& objectVertices, std::vector<i32>& vertexRemap, std::vector<f32>& vertices, std::vector<i32>& triangles)
+    {
+        if (placement.boundsMax.x < paddedMin.x ||
+            placement.boundsMax.z < paddedMin.y ||
+            placement.boundsMin.x > paddedMax.x ||
+            placement.boundsMin.z > paddedMax.y)
+        {
+            return;
+        }
+
+        const NavMesh::CollisionMesh& mesh = *placement.mesh;
+        objectVertices.resize(mesh.vertices.size());
+        for (size_t vertexIndex = 0; vertexIndex < mesh.vertices.size(); vertexIndex++)
+        {
+            objectVertices[vertexIndex] = vec3(placement.transform * glm::vec4(mesh.vertices[vertexIndex], 1.0f));
+        }
+
+        vertexRemap.assign(mesh.vertices.size(), -1);
+        for (size_t index = 0; index + 2 < mesh.indices.size(); index += 3)
+        {
+            const vec3& a = objectVertices[mesh.indices[index + 0]];
+            const vec3& b = objectVertices[mesh.indices[index + 1]];
+            const vec3& c = objectVertices[mesh.indices[index + 2]];
+
+            if (std::max({ a.x, b.x, c.x }) < paddedMin.x ||
+                std::max({ a.z, b.z, c.z }) < paddedMin.y ||
+                std::min({ a.x, b.x, c.x }) > paddedMax.x ||
+                std::min({ a.z, b.z, c.z }) > paddedMax.y)
+            {
+                continue;
+            }
+
+            // The mirrored Z axis flips the winding, collision meshes wind clockwise in Novus space
+            // (the physics shapes reverse them) and so arrive counter-clockwise as Recast expects.
+            for (u32 corner = 0; corner < 3; corner++)
+            {
+                const u32 vertexIndex = mesh.indices[index + corner];
+                if (vertexRemap[vertexIndex] < 0)
+                {
+                    vertexRemap[vertexIndex] = static_cast<i32>(vertices.size() / 3);
+                    vertices.push_back(objectVertices[vertexIndex].x);
+                    vertices.push_back(objectVertices[vertexIndex].y);
+                    vertices.push_back(objectVertices[vertexIndex].z);
+                }
+
+                triangles.push_back(vertexRemap[vertexIndex]);
+            }
+        }
+    }
+
+    // Calls callback(patchHeights, patchX, patchZ) for every solid terrain patch overlapping the voxel window
+    // [minVoxel, maxVoxel), patch and voxel coordinates are global to the map
+    template <typename Callback>
+    void ForEachTerrainPatch(const TerrainNeighbourhood& terrain, i32 minVoxelX, i32 minVoxelZ, i32 maxVoxelX, i32 maxVoxelZ, Callback&& callback)
+    {
+        constexpr i32 patchesPerChunk = Terrain::CHUNK_NUM_CELLS_PER_STRIDE * Terrain::CELL_NUM_PATCHES_PER_STRIDE;
+
+        minVoxelX = std::max(minVoxelX, 0);
+        minVoxelZ = std::max(minVoxelZ, 0);
+        maxVoxelX = std::min(maxVoxelX, Settings::MAP_VOXEL_SIZE);
+        maxVoxelZ = std::min(maxVoxelZ, Settings::MAP_VOXEL_SIZE);
+        if (minVoxelX >= maxVoxelX || minVoxelZ >= maxVoxelZ)
+            return;
+
+        const i32 minPatchX = minVoxelX / Settings::PATCH_VOXEL_SIZE;
+        const i32 minPatchZ = minVoxelZ / Settings::PATCH_VOXEL_SIZE;
+        const i32 maxPatchX = (maxVoxelX - 1) / Settings::PATCH_VOXEL_SIZE;
+        const i32 maxPatchZ = (maxVoxelZ - 1) / Settings::PATCH_VOXEL_SIZE;
+
+        for (i32 patchZ = minPatchZ; patchZ <= maxPatchZ; patchZ++)
+        {
+            const i32 sourceChunkY = patchZ / patchesPerChunk;
+            const i32 chunkPatchZ = patchZ % patchesPerChunk;
+            const u32 cellY = chunkPatchZ / Terrain::CELL_NUM_PATCHES_PER_STRIDE;
+            const u32 patchRow = chunkPatchZ % Terrain::CELL_NUM_PATCHES_PER_STRIDE;
+
+            for (i32 patchX = minPatchX; patchX <= maxPatchX; patchX++)
+            {
+                const NavSourceData* source = terrain.GetSource(patchX / patchesPerChunk, sourceChunkY);
+                if (!source)
+                    continue;
+
+                const i32 chunkPatchX = patchX % patchesPerChunk;
+                const u32 cellX = chunkPatchX / Terrain::CELL_NUM_PATCHES_PER_STRIDE;
+                const u32 patchColumn = chunkPatchX % Terrain::CELL_NUM_PATCHES_PER_STRIDE;
+                const u32 cellID = cellX + cellY * Terrain::CHUNK_NUM_CELLS_PER_STRIDE;
+                const u32 patchID = patchColumn + patchRow * Terrain::CELL_NUM_PATCHES_PER_STRIDE;
+                if ((source->holes[cellID] & (1ull << patchID)) != 0)
+                    continue;
+
+                const size_t heightOffset = static_cast<size_t>(cellID) * Terrain::CELL_TOTAL_GRID_SIZE + patchColumn + patchRow * Terrain::CELL_GRID_ROW_SIZE;
+                callback(&source->heights[heightOffset], patchX, patchZ);
+            }
+        }
+    }
+
+    bool GetTerrainHeightBounds(const TerrainNeighbourhood& terrain, i32 borderSize, f32& minY, f32& maxY)
+    {
+        const i32 minVoxelX = terrain.chunkX * Settings::TILE_VOXEL_SIZE - borderSize;
+        const i32 minVoxelZ = terrain.chunkY * Settings::TILE_VOXEL_SIZE - borderSize;
+        const i32 maxVoxelX = (terrain.chunkX + 1) * Settings::TILE_VOXEL_SIZE + borderSize;
+        const i32 maxVoxelZ = (terrain.chunkY + 1) * Settings::TILE_VOXEL_SIZE + borderSize;
+
+        bool hasTerrain = false;
+        ForEachTerrainPatch(terrain, minVoxelX, minVoxelZ, maxVoxelX, maxVoxelZ, [&](const f32* patchHeights, i32 /*patchX*/, i32 /*patchZ*/)
+        {
+            const f32 heights[5] =
+            {
+                patchHeights[0],
+                patchHeights[1],
+                patchHeights[Terrain::CELL_GRID_ROW_SIZE],
+                patchHeights[Terrain::CELL_GRID_ROW_SIZE + 1],
+                patchHeights[Terrain::CELL_OUTER_GRID_STRIDE]
+            };
+
+            for (f32 height : heights)
+            {
+                minY = std::min(minY, height);
+                maxY = std::max(maxY, height);
+            }
+            hasTerrain = true;
+        });
+
+        return hasTerrain;
+    }
+
+    // Writes heightfield spans straight from the terrain grid instead of rasterizing its triangle soup.
+    // Patches are exactly PATCH_VOXEL_SIZE voxels wide and the patch diagonals only ever pass through
+    // voxel corners, so every column is covered by at most two of the patch triangles and each span is the
+    // plane range over the column corners. Spans are quantized and merged exactly like rcRasterizeTriangles.
+    bool RasterizeTerrainGrid(rcContext& context, const TerrainNeighbourhood& terrain, const rcConfig& config, rcHeightfield& heightfield, u32& numSpans)
+    {
+        constexpr f32 voxelPatchSize = 1.0f / static_cast<f32>(Settings::PATCH_VOXEL_SIZE);
+
+        const i32 originVoxelX = static_cast<i32>(std::lround((config.bmin[0] + Terrain::MAP_HALF_SIZE) / config.cs));
+        const i32 originVoxelZ = static_cast<i32>(std::lround((config.bmin[2] + Terrain::MAP_HALF_SIZE) / config.cs));
+        const f32 walkableThreshold = std::cos(config.walkableSlopeAngle / 180.0f * RC_PI);
+        const f32 inverseCellHeight = 1.0f / config.ch;
+        const f32 heightRange = config.bmax[1] - config.bmin[1];
+
+        // Per column of a patch row. Columns on a patch diagonal are split into the triangle below and the one
+        // above it, every other column lies in a single triangle and only uses the lower span.
+        std::array<f32, Settings::PATCH_VOXEL_SIZE> lowerSpanMin;
+        std::array<f32, Settings::PATCH_VOXEL_SIZE> lowerSpanMax;
+        std::array<f32, Settings::PATCH_VOXEL_SIZE> upperSpanMin;
+        std::array<f32, Settings::PATCH_VOXEL_SIZE> upperSpanMax;
+        std::array<i32, Settings::PATCH_VOXEL_SIZE> lowerSpanMinIndex;
+        std::array<i32, Settings::PATCH_VOXEL_SIZE> lowerSpanMaxIndex;
+        std::array<i32, Settings::PATCH_VOXEL_SIZE> upperSpanMinIndex;
+        std::array<i32, Settings::PATCH_VOXEL_SIZE> upperSpanMaxIndex;
+
+        // Picks one of the four plane coefficients with selects, an indexed load would keep the column loop
+        // from vectorizing
+        auto SelectPlane = [](const f32* coefficients, bool aboveMainDiagonal, bool aboveAntiDiagonal)
+        {
+            const f32 belowAntiDiagonal = aboveMainDiagonal ? coefficients[1] : coefficients[0];
+            const f32 onAntiDiagonalSide = aboveMainDiagonal ? coefficients[3] : coefficients[2];
+            return aboveAntiDiagonal ? onAntiDiagonalSide : belowAntiDiagonal;
+        };
+
+        // Signs of v - u and u + v - 1 at the column center select the triangle, a column on a diagonal also
+        // takes the triangle above it when includeDiagonals is set
+        auto GetPlaneIndex = [](i32 columnX, i32 columnZ, bool includeDiagonals)
+        {
+            const i32 antiDiagonal = columnX + columnZ - (Settings::PATCH_VOXEL_SIZE - 1);
+            const bool aboveMainDiagonal = includeDiagonals ? columnZ >= columnX : columnZ > columnX;
+            const bool aboveAntiDiagonal = includeDiagonals ? antiDiagonal >= 0 : antiDiagonal > 0;
+            return static_cast<u32>(aboveMainDiagonal) | (static_cast<u32>(aboveAntiDiagonal) << 1);
+        };
+
+        // Heights are clamped to the tile's range first, which keeps them positive. Truncation then rounds down
+        // and truncation plus one below the value rounds up, matching floor and ceil for every span that is kept.
+        auto GetSpanIndices = [&](f32 spanMin, f32 spanMax, i32& spanMinIndex, i32& spanMaxIndex)
+        {
+            const f32 clampedMin = std::min(std::max(spanMin - config.bmin[1], 0.0f), heightRange) * inverseCellHeight;
+            const f32 clampedMax = std::min(std::max(spanMax - config.bmin[1], 0.0f), heightRange) * inverseCellHeight;
+            const i32 truncatedMax = static_cast<i32>(clampedMax);
+
+            spanMinIndex = rcClamp(static_cast<i32>(clampedMin), 0, RC_SPAN_MAX_HEIGHT);
+            spanMaxIndex = rcClamp(truncatedMax + static_cast<i32>(static_cast<f32>(truncatedMax) < clampedMax), spanMinIndex + 1, RC_SPAN_MAX_HEIGHT);
+        };
+
+        auto IsInHeightRange = [&](f32 spanMin, f32 spanMax)
+        {
+            return spanMax - config.bmin[1] >= 0.0f && spanMin - config.bmin[1] <= heightRange;
+        };
+
+        bool succeeded = true;
+        ForEachTerrainPatch(terrain, originVoxelX, originVoxelZ, originVoxelX + config.width, originVoxelZ + config.height, [&](const f32* patchHeights, i32 patchX, i32 patchZ)
+        {
+            if (!succeeded)
+                return;
+
+            const f32 h00 = patchHeights[0];
+            const f32 h10 = patchHeights[1];
+            const f32 h01 = patchHeights[Terrain::CELL_GRID_ROW_SIZE];
+            const f32 h11 = patchHeights[Terrain::CELL_GRID_ROW_SIZE + 1];
+            const f32 hc = patchHeights[Terrain::CELL_OUTER_GRID_STRIDE];
+
+            // The four triangles fanned around the patch center on the v = 0, u = 0, u = 1 and v = 1 patch edges,
+            // indexed like GetPlaneIndex. Each height is a + b * u + c * v over the patch local u, v in [0, 1].
+            const f32 planeA[4] = { h00, h00, 2.0f * hc - h11, 2.0f * hc - h11 };
+            const f32 planeB[4] = { h10 - h00, 2.0f * hc - h00 - h01, h10 + h11 - 2.0f * hc, h11 - h01 };
+            const f32 planeC[4] = { 2.0f * hc - h00 - h10, h01 - h00, h11 - h10, h01 + h11 - 2.0f * hc };
+            u8 planeArea[4];
+
+            for (u32 planeIndex = 0; planeIndex < 4; planeIndex++)
+            {
+                const f32 slopeX = planeB[planeIndex] / Terrain::PATCH_SIZE;
+                const f32 slopeZ = planeC[planeIndex] / Terrain::PATCH_SIZE;
+                const f32 normalY = 1.0f / std::sqrt(1.0f + slopeX * slopeX + slopeZ * slopeZ);
+                planeArea[planeIndex] = normalY > walkableThreshold ? RC_WALKABLE_AREA : RC_NULL_AREA;
+            }
+
+            const i32 patchVoxelX = patchX * Settings::PATCH_VOXEL_SIZE;
+            const i32 patchVoxelZ = patchZ * Settings::PATCH_VOXEL_SIZE;
+            const i32 minColumnX = std::max(patchVoxelX, originVoxelX) - patchVoxelX;
+            const i32 minColumnZ = std::max(patchVoxelZ, originVoxelZ) - patchVoxelZ;
+            const i32 maxColumnX = std::min(patchVoxelX + Settings::PATCH_VOXEL_SIZE, originVoxelX + config.width) - patchVoxelX;
+            const i32 maxColumnZ = std::min(patchVoxelZ + Settings::PATCH_VOXEL_SIZE, originVoxelZ + config.height) - patchVoxelZ;
+            const i32 numColumns = maxColumnX - minColumnX;
+
+            for (i32 columnZ = minColumnZ; columnZ < maxColumnZ; columnZ++)
+            {
+                const f32 v0 = static_cast<f32>(columnZ) * voxelPatchSize;
+                const f32 v1 = v0 + voxelPatchSize;
+                const i32 z = patchVoxelZ + columnZ - originVoxelZ;
+
+                // Both triangles of a column share the diagonal it is split along, columns off the patch diagonals
+                // use the v = u one and evaluate their single plane as both triangles, which are merged. The loop
+                // only selects and does arithmetic, so it vectorizes across columns (GCC -O3, checked with
+                // -fopt-info-vec).
+                for (i32 column = 0; column < numColumns; column++)
+                {
+                    const i32 columnX = minColumnX + column;
+                    const f32 u0 = static_cast<f32>(columnX) * voxelPatchSize;
+                    const f32 u1 = u0 + voxelPatchSize;
+
+                    const bool aboveMainDiagonal = columnZ > columnX;
+                    const bool aboveAntiDiagonal = columnX + columnZ > Settings::PATCH_VOXEL_SIZE - 1;
+                    const bool onMainDiagonal = columnX == columnZ;
+                    const bool onAntiDiagonal = columnX + columnZ == Settings::PATCH_VOXEL_SIZE - 1;
+                    const bool isSplit = onMainDiagonal || onAntiDiagonal;
+
+                    const f32 lowerA = SelectPlane(planeA, aboveMainDiagonal, aboveAntiDiagonal);
+                    const f32 lowerB = SelectPlane(planeB, aboveMainDiagonal, aboveAntiDiagonal);
+                    const f32 lowerC = SelectPlane(planeC, aboveMainDiagonal, aboveAntiDiagonal);
+                    const f32 upperA = SelectPlane(planeA, aboveMainDiagonal || onMainDiagonal, aboveAntiDiagonal || onAntiDiagonal);
+                    const f32 upperB = SelectPlane(planeB, aboveMainDiagonal || onMainDiagonal, aboveAntiDiagonal || onAntiDiagonal);
+                    const f32 upperC = SelectPlane(planeC, aboveMainDiagonal || onMainDiagonal, aboveAntiDiagonal || onAntiDiagonal);
+
+                    const f32 diagonalV0 = onAntiDiagonal ? v1 : v0;
+                    const f32 diagonalV1 = onAntiDiagonal ? v0 : v1;
+                    const f32 lowerCornerU = onAntiDiagonal ? u0 : u1;
+                    const f32 upperCornerU = onAntiDiagonal ? u1 : u0;
+
+                    const f32 lowerHeight0 = lowerA + lowerB * u0 + lowerC * diagonalV0;
+                    const f32 lowerHeight1 = lowerA + lowerB * u1 + lowerC * diagonalV1;
+                    const f32 lowerHeight2 = lowerA + lowerB * lowerCornerU + lowerC * v0;
+                    const f32 upperHeight0 = upperA + upperB * u0 + upperC * diagonalV0;
+                    const f32 upperHeight1 = upperA + upperB * u1 + upperC * diagonalV1;
+                    const f32 upperHeight2 = upperA + upperB * upperCornerU + upperC * v1;
+
+                    const f32 lowerMin = std::min(std::min(lowerHeight0, lowerHeight1), lowerHeight2);
+                    const f32 lowerMax = std::max(std::max(lowerHeight0, lowerHeight1), lowerHeight2);
+                    const f32 upperMin = std::min(std::min(upperHeight0, upperHeight1), upperHeight2);
+                    const f32 upperMax = std::max(std::max(upperHeight0, upperHeight1), upperHeight2);
+
+                    lowerSpanMin[column] = isSplit ? lowerMin : std::min(lowerMin, upperMin);
+                    lowerSpanMax[column] = isSplit ? lowerMax : std::max(lowerMax, upperMax);
+                    upperSpanMin[column] = upperMin;
+                    upperSpanMax[column] = upperMax;
+                }
+
+                for (i32 column = 0; column < numColumns; column++)
+                {
+                    GetSpanIndices(lowerSpanMin[column], lowerSpanMax[column], lowerSpanMinIndex[column], lowerSpanMaxIndex[column]);
+                    GetSpanIndices(upperSpanMin[column], upperSpanMax[column], upperSpanMinIndex[column], upperSpanMaxIndex[column]);
+                }
+
+                // rcAddSpan inserts into the column's sorted span list and merges, so it stays a separate scalar pass
+                for (i32 column = 0; column < numColumns; column++)
+                {
+                    const i32 columnX = minColumnX + column;
+                    const i32 x = patchVoxelX + columnX - originVoxelX;
+                    const bool isSplit = columnX == columnZ || columnX + columnZ == Settings::PATCH_VOXEL_SIZE - 1;
+
+                    if (IsInHeightRange(lowerSpanMin[column], lowerSpanMax[column]))
+                    {
+                        const u8 area = planeArea[GetPlaneIndex(columnX, columnZ, false)];
+                        if (!rcAddSpan(&context, heightfield, x, z, static_cast<u16>(lowerSpanMinIndex[column]), static_cast<u16>(lowerSpanMaxIndex[column]), area, config.walkableClimb))
+                        {
+                            succeeded = false;
+                            return;
+                        }
+
+                        numSpans++;
+                    }
+
+                    if (isSplit && IsInHeightRange(upperSpanMin[column], upperSpanMax[column]))
+                    {
+                        const u8 area = planeArea[GetPlaneIndex(columnX, columnZ, true)];
+                        if (!rcAddSpan(&context, heightfield, x, z, static_cast<u16>(upperSpanMinIndex[column]), static_cast<u16>(upperSpanMaxIndex[column]), area, config.walkableClimb))
+                        {
+                            succeeded = false;
+                            return;
+                        }
+
+                        numSpans++;
+                    }
+                }
+            }
+        });
+
+        return succeeded;
+    }
+
+    bool CreateTerrainHeightTile(u32 chunkX, u32 chunkY, const NavSourceData& source, bool compact, std::vector<u8>& heightData)
     {
         const vec2 chunkOrigin = GetChunkWorldOrigin(chunkX, chunkY);
 
@@ -282,15 +873,38 @@ namespace
         if (!NavMesh::TerrainHeight::IsValidHeader(header))
             return false;
 
+        if (compact)
+        {
+            NavMesh::CompactTerrainHeight::Header compactHeader;
+            compactHeader.chunkX = header.chunkX;
+            compactHeader.chunkY = header.chunkY;
+            compactHeader.originX = header.originX;
+            compactHeader.originZ = header.originZ;
+            compactHeader.chunkSize = header.chunkSize;
+            compactHeader.cellsPerChunkStride = header.cellsPerChunkStride;
+            compactHeader.verticesPerCell = header.verticesPerCell;
+            compactHeader.heightCount = header.heightCount;
+            compactHeader.holeCount = header.holeCount;
+            return NavMesh::CompactTerrainHeight::CreateTileData(compactHeader, source.heights.data(), source.holes.data(), heightData);
+        }
+
+        // Heights retain the native 145-value ADT cell order used by
+        // GetCellVertexPosition. Hole bit N masks terrain patch N in the cell.
+        heightData.resize(sizeof(header) + sizeof(source.heights) + sizeof(source.holes));
+        u8* output = heightData.data();
+        std::memcpy(output, &header, sizeof(header));
+        std::memcpy(output + sizeof(header), source.heights.data(), sizeof(source.heights));
+        std::memcpy(output + sizeof(header) + sizeof(source.heights), source.holes.data(), sizeof(source.holes));
+        return true;
+    }
+
+    bool WriteTileFile(const std::filesystem::path& path, const std::vector<u8>& bytes)
+    {
         std::ofstream output(path, std::ios::out | std::ios::binary | std::ios::trunc);
         if (!output)
             return false;
 
-        // Heights retain the native 145-value ADT cell order used by
-        // GetCellVertexPosition. Hole bit N masks terrain patch N in the cell.
-        output.write(reinterpret_cast<const char*>(&header), sizeof(header));
-        output.write(reinterpret_cast<const char*>(source.heights.data()), sizeof(source.heights));
-        output.write(reinterpret_cast<const char*>(source.holes.data()), sizeof(source.holes));
+        output.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
         output.flush();
         return output.good();
     }
@@ -301,10 +915,8 @@ namespace
         config.cs = Settings::CELL_SIZE;
         config.ch = Settings::CELL_HEIGHT;
         config.walkableSlopeAngle = NavMesh::Agent::MAX_SLOPE;
-        config.walkableHeight = Settings::GetWalkableHeight();
-        config.walkableClimb = Settings::GetWalkableClimb();
-        config.walkableRadius = Settings::GetWalkableRadius();
-        config.borderSize = Settings::GetBorderSize();
+        config.walkableClimb = Settings::GetRasterizationClimb(buildSettings);
+        config.borderSize = Settings::GetBorderSize(buildSettings);
         config.tileSize = Settings::TILE_VOXEL_SIZE;
         config.width = config.tileSize + (config.borderSize * 2);
         config.height = config.tileSize + (config.borderSize * 2);
@@ -318,10 +930,17 @@ namespace
         return config;
     }
 
+    void SetAgentConfig(rcConfig& config, const NavMesh::AgentSettings& agent)
+    {
+        config.walkableHeight = Settings::GetWalkableHeight(agent);
+        config.walkableClimb = Settings::GetWalkableClimb(agent);
+        config.walkableRadius = Settings::GetWalkableRadius(agent);
+    }
+
     void SetTileBounds(rcConfig& config, u32 chunkX, u32 chunkY, f32 minY, f32 maxY)
     {
         const vec2 tileOrigin = GetChunkWorldOrigin(chunkX, chunkY);
-        const f32 borderWorldSize = Settings::GetBorderWorldSize();
+        const f32 borderWorldSize = static_cast<f32>(config.borderSize) * config.cs;
         config.bmin[0] = tileOrigin.x - borderWorldSize;
         config.bmin[1] = minY;
         config.bmin[2] = tileOrigin.y - borderWorldSize;
@@ -386,24 +1005,76 @@ namespace
         }
     }
 
-    NavMesh::TileBuildResult BuildRecastMesh(rcContext& context, NavMesh::BuildTimings& timings, const NavMesh::BuildSettings& buildSettings, const rcConfig& config, const std::vector<f32>& vertices, const std::vector<i32>& triangles, RecastBuildState& state)
+    NavMesh::TileBuildResult RasterizeRecastHeightfield(rcContext& context, NavMesh::BuildTimings& timings, const rcConfig& config, const TerrainNeighbourhood* terrain, const std::vector<f32>& vertices, const std::vector<i32>& triangles, RecastBuildState& state)
     {
-        if (vertices.empty() || triangles.empty())
+        if (!terrain && (vertices.empty() || triangles.empty()))
             return NavMesh::TileBuildResult::Empty;
 
-        {
-            PhaseTimer phaseTimer(timings.rasterizationSeconds);
-            state.solid = rcAllocHeightfield();
-            if (!state.solid || !rcCreateHeightfield(&context, *state.solid, config.width, config.height, config.bmin, config.bmax, config.cs, config.ch))
-                return NavMesh::TileBuildResult::Failed;
+        PhaseTimer phaseTimer(timings.rasterizationSeconds);
+        state.solid = rcAllocHeightfield();
+        if (!state.solid || !rcCreateHeightfield(&context, *state.solid, config.width, config.height, config.bmin, config.bmax, config.cs, config.ch))
+            return NavMesh::TileBuildResult::Failed;
+
+        u32 numTerrainSpans = 0;
+        if (terrain && !RasterizeTerrainGrid(context, *terrain, config, *state.solid, numTerrainSpans))
+            return NavMesh::TileBuildResult::Failed;
 
+        // Anything that is not a regular terrain grid goes through the generic triangle rasterizer
+        if (!triangles.empty())
+        {
             const i32 triangleCount = static_cast<i32>(triangles.size() / 3);
             std::vector<u8> areas(triangleCount, RC_NULL_AREA);
             rcMarkWalkableTriangles(&context, config.walkableSlopeAngle, vertices.data(), static_cast<i32>(vertices.size() / 3), triangles.data(), triangleCount, areas.data());
             if (!rcRasterizeTriangles(&context, vertices.data(), static_cast<i32>(vertices.size() / 3), triangles.data(), areas.data(), triangleCount, *state.solid, config.walkableClimb))
                 return NavMesh::TileBuildResult::Failed;
         }
+        else if (numTerrainSpans == 0)
+        {
+            return NavMesh::TileBuildResult::Empty;
+        }
+
+        return NavMesh::TileBuildResult::Success;
+    }
+
+    // The agent stages filter the heightfield in place, every agent but the last works on a copy of the window
+    // [minX, minX + width) x [minZ, minZ + height). Spans in a built heightfield never touch, so adding them
+    // again reproduces it without merging anything.
+    bool CopyHeightfield(rcContext& context, const rcHeightfield& source, i32 minX, i32 minZ, i32 width, i32 height, RecastBuildState& state)
+    {
+        if (minX < 0 || minZ < 0 || minX + width > source.width || minZ + height > source.height)
+            return false;
+
+        f32 bmin[3];
+        f32 bmax[3];
+        rcVcopy(bmin, source.bmin);
+        rcVcopy(bmax, source.bmax);
+        bmin[0] += static_cast<f32>(minX) * source.cs;
+        bmin[2] += static_cast<f32>(minZ) * source.cs;
+        bmax[0] = bmin[0] + static_cast<f32>(width) * source.cs;
+        bmax[2] = bmin[2] + static_cast<f32>(height) * source.cs;
+
+        state.solid = rcAllocHeightfield();
+        if (!state.solid || !rcCreateHeightfield(&context, *state.solid, width, height, bmin, bmax, source.cs, source.ch))
+            return false;
+
+        for (i32 z = 0; z < height; z++)
+        {
+            for (i32 x = 0; x < width; x++)
+            {
+                for (const rcSpan* span = source.spans[(minX + x) + (minZ + z) * source.width]; span; span = span->next)
+                {
+                    if (!rcAddSpan(&context, *state.solid, x, z, static_cast<u16>(span->smin), static_cast<u16>(span->smax), static_cast<u8>(span->area), 0))
+                        return false;
+                }
+            }
+        }
+
+        return true;
+    }
 
+    // Runs everything after rasterization for one agent, consumes state.solid
+    NavMesh::TileBuildResult BuildRecastAgentMesh(rcContext& context, NavMesh::BuildTimings& timings, const NavMesh::BuildSettings& buildSettings, const rcConfig& config, RecastBuildState& state)
+    {
         {
             PhaseTimer phaseTimer(timings.compactHeightfieldSeconds);
             rcFilterLowHangingWalkableObstacles(&context, config.walkableClimb, *state.solid);
@@ -456,7 +1127,7 @@ namespace
             for (i32 i = 0; i < state.polyMesh->npolys; i++)
             {
                 if (state.polyMesh->areas[i] == RC_WALKABLE_AREA)
-                    state.polyMesh->flags[i] |= 0x1;
+                    state.polyMesh->flags[i] |= NavMesh::WALKABLE_POLY_FLAG;
             }
         }
 
@@ -476,7 +1147,129 @@ namespace
         return NavMesh::TileBuildResult::Success;
     }
 
-    NavMesh::TileBuildResult WriteDetourTile(NavMesh::BuildTimings& timings, const std::filesystem::path& path, u32 chunkX, u32 chunkY, const rcConfig& config, const rcPolyMesh& polyMesh, const rcPolyMeshDetail& detailMesh)
+    // Branches every requested agent off the rasterized heightfield in rasterState, agentStates receives one
+    // state per agent and agentResults their results
+    void BuildRecastAgentMeshes(rcContext& context, NavMesh::BuildTimings& timings, const NavMesh::BuildSettings& buildSettings, const rcConfig& config, const std::vector<NavMesh::AgentTile>& agentTiles, RecastBuildState& rasterState, std::vector<std::unique_ptr<RecastBuildState>>& agentStates, std::vector<NavMesh::TileBuildResult>& agentResults)
+    {
+        const size_t numAgents = buildSettings.agents.size();
+        agentStates.clear();
+        agentStates.resize(numAgents);
+        agentResults.assign(numAgents, NavMesh::TileBuildResult::Empty);
+
+        size_t lastRequestedAgent = numAgents;
+        for (size_t agentIndex = 0; agentIndex < numAgents; agentIndex++)
+        {
+            if (agentTiles[agentIndex].isRequested)
+                lastRequestedAgent = agentIndex;
+        }
+
+        for (size_t agentIndex = 0; agentIndex < numAgents; agentIndex++)
+        {
+            if (!agentTiles[agentIndex].isRequested)
+                continue;
+
+            std::unique_ptr<RecastBuildState> state = std::make_unique<RecastBuildState>();
+            if (agentIndex == lastRequestedAgent)
+            {
+                state->solid = std::exchange(rasterState.solid, nullptr);
+            }
+            else
+            {
+                PhaseTimer phaseTimer(timings.rasterizationSeconds);
+                const rcHeightfield& solid = *rasterState.solid;
+                if (!CopyHeightfield(context, solid, 0, 0, solid.width, solid.height, *state))
+                {
+                    agentResults[agentIndex] = NavMesh::TileBuildResult::Failed;
+                    continue;
+                }
+            }
+
+            rcConfig agentConfig = config;
+            SetAgentConfig(agentConfig, buildSettings.agents[agentIndex]);
+            agentResults[agentIndex] = BuildRecastAgentMesh(context, timings, buildSettings, agentConfig, *state);
+            agentStates[agentIndex] = std::move(state);
+        }
+    }
+
+    // Builds the agent's compressed dtTileCache layers for every TileCache tile within the NavMesh tile. Each of
+    // them is cropped out of the shared heightfield with the same border, so it sees what the Detour tile saw.
+    bool BuildTileCacheLayers(rcContext& context, NavMesh::BuildTimings& timings, const NavMesh::BuildSettings& buildSettings, const rcConfig& config, const rcHeightfield& solid, u32 chunkX, u32 chunkY, std::vector<u8>& layersData)
+    {
+        PhaseTimer phaseTimer(timings.tileCacheSeconds);
+        NavMesh::TileCache::RunLengthCompressor compressor;
+        std::vector<std::vector<u8>> layers;
+
+        constexpr i32 tilesPerChunk = static_cast<i32>(NavMesh::TileCache::TILES_PER_CHUNK_STRIDE);
+        const i32 windowSize = Settings::TILE_CACHE_TILE_VOXEL_SIZE + config.borderSize * 2;
+        for (i32 cacheTileY = 0; cacheTileY < tilesPerChunk; cacheTileY++)
+        {
+            for (i32 cacheTileX = 0; cacheTileX < tilesPerChunk; cacheTileX++)
+            {
+                // Everything but the compressed layers is scratch, the arena is rewound after each TileCache tile
+                ScopedRecastArenaMarker arenaMarker;
+                RecastBuildState state;
+                if (!CopyHeightfield(context, solid, cacheTileX * Settings::TILE_CACHE_TILE_VOXEL_SIZE, cacheTileY * Settings::TILE_CACHE_TILE_VOXEL_SIZE, windowSize, windowSize, state))
+                    return false;
+
+                rcFilterLowHangingWalkableObstacles(&context, config.walkableClimb, *state.solid);
+                rcFilterLedgeSpans(&context, config.walkableHeight, config.walkableClimb, *state.solid);
+                rcFilterWalkableLowHeightSpans(&context, config.walkableHeight, *state.solid);
+
+                state.compactHeightfield = rcAllocCompactHeightfield();
+                if (!state.compactHeightfield || !rcBuildCompactHeightfield(&context, config.walkableHeight, config.walkableClimb, *state.solid, *state.compactHeightfield))
+                    return false;
+
+                if (!rcErodeWalkableArea(&context, config.walkableRadius, *state.compactHeightfield))
+                    return false;
+
+                if (buildSettings.useMedianFilter && !rcMedianFilterWalkableArea(&context, *state.compactHeightfield))
+                    return false;
+
+                state.layerSet = rcAllocHeightfieldLayerSet();
+                if (!state.layerSet || !rcBuildHeightfieldLayers(&context, *state.compactHeightfield, config.borderSize, config.walkableHeight, *state.layerSet))
+                    return false;
+
+                for (i32 layerIndex = 0; layerIndex < state.layerSet->nlayers; layerIndex++)
+                {
+                    const rcHeightfieldLayer& layer = state.layerSet->layers[layerIndex];
+
+                    dtTileCacheLayerHeader header{};
+                    header.magic = DT_TILECACHE_MAGIC;
+                    header.version = DT_TILECACHE_VERSION;
+                    header.tx = static_cast<i32>(chunkX) * tilesPerChunk + cacheTileX;
+                    header.ty = static_cast<i32>(chunkY) * tilesPerChunk + cacheTileY;
+                    header.tlayer = layerIndex;
+                    rcVcopy(header.bmin, layer.bmin);
+                    rcVcopy(header.bmax, layer.bmax);
+                    header.width = static_cast<u8>(layer.width);
+                    header.height = static_cast<u8>(layer.height);
+                    header.minx = static_cast<u8>(layer.minx);
+                    header.maxx = static_cast<u8>(layer.maxx);
+                    header.miny = static_cast<u8>(layer.miny);
+                    header.maxy = static_cast<u8>(layer.maxy);
+                    header.hmin = static_cast<u16>(layer.hmin);
+                    header.hmax = static_cast<u16>(layer.hmax);
+
+                    u8* rawLayerData = nullptr;
+                    i32 layerDataSize = 0;
+                    if (dtStatusFailed(dtBuildTileCacheLayer(&compressor, &header, layer.heights, layer.areas, layer.cons, &rawLayerData, &layerDataSize)) || !rawLayerData)
+                    {
+                        if (rawLayerData)
+                            dtFree(rawLayerData);
+
+                        return false;
+                    }
+
+                    std::unique_ptr<u8, decltype(&dtFree)> layerData(rawLayerData, &dtFree);
+                    layers.emplace_back(layerData.get(), layerData.get() + layerDataSize);
+                }
+            }
+        }
+
+        return NavMesh::TileCache::CreateLayersData(chunkX, chunkY, layers, layersData);
+    }
+
+    NavMesh::TileBuildResult CreateDetourTile(NavMesh::BuildTimings& timings, u32 chunkX, u32 chunkY, const rcConfig& config, const NavMesh::AgentSettings& agent, const rcPolyMesh& polyMesh, const rcPolyMeshDetail& detailMesh, std::vector<u8>& tileData)
     {
         PhaseTimer outputTimer(timings.detourAndOutputSeconds);
         dtNavMeshCreateParams params{};
@@ -492,9 +1285,9 @@ namespace
         params.detailVertsCount = detailMesh.nverts;
         params.detailTris = detailMesh.tris;
         params.detailTriCount = detailMesh.ntris;
-        params.walkableHeight = NavMesh::Agent::HEIGHT;
-        params.walkableRadius = NavMesh::Agent::RADIUS;
-        params.walkableClimb = NavMesh::Agent::MAX_CLIMB;
+        params.walkableHeight = agent.height;
+        params.walkableRadius = agent.radius;
+        params.walkableClimb = agent.maxClimb;
         params.cs = config.cs;
         params.ch = config.ch;
         params.buildBvTree = true;
@@ -515,111 +1308,210 @@ namespace
         }
 
         std::unique_ptr<u8, decltype(&dtFree)> navData(rawNavData, &dtFree);
-        std::ofstream output(path, std::ios::out | std::ios::binary | std::ios::trunc);
-        if (!output)
-            return NavMesh::TileBuildResult::Failed;
-
-        output.write(reinterpret_cast<const char*>(navData.get()), navDataSize);
-        output.flush();
-        return output.good() ? NavMesh::TileBuildResult::Success : NavMesh::TileBuildResult::Failed;
+        tileData.assign(navData.get(), navData.get() + navDataSize);
+        return NavMesh::TileBuildResult::Success;
     }
 
-    NavMesh::TileBuildResult BuildSingleNavMeshTile(rcContext& context, NavMesh::BuildTimings& timings, const NavMesh::BuildSettings& buildSettings, const std::filesystem::path& path, u32 chunkX, u32 chunkY, const rcConfig& config, const std::vector<f32>& vertices, const std::vector<i32>& triangles)
+    void BuildSingleNavMeshTile(rcContext& context, NavMesh::BuildTimings& timings, const NavMesh::BuildSettings& buildSettings, u32 chunkX, u32 chunkY, const rcConfig& config, const TerrainNeighbourhood* terrain, const std::vector<f32>& vertices, const std::vector<i32>& triangles, std::vector<NavMesh::AgentTile>& agentTiles)
     {
-        RecastBuildState state;
-        const NavMesh::TileBuildResult buildResult = BuildRecastMesh(context, timings, buildSettings, config, vertices, triangles, state);
-        if (buildResult != NavMesh::TileBuildResult::Success)
-            return buildResult;
+        RecastBuildState rasterState;
+        const NavMesh::TileBuildResult rasterResult = RasterizeRecastHeightfield(context, timings, config, terrain, vertices, triangles, rasterState);
+        if (rasterResult != NavMesh::TileBuildResult::Success)
+        {
+            for (NavMesh::AgentTile& agentTile : agentTiles)
+            {
+                if (agentTile.isRequested)
+                    agentTile.result = rasterResult;
+            }
+            return;
+        }
+
+        // The layers branch off before the agent stages consume the shared heightfield
+        std::vector<bool> hasLayersFailed(agentTiles.size(), false);
+        if (buildSettings.buildTileCacheLayers)
+        {
+            for (size_t agentIndex = 0; agentIndex < agentTiles.size(); agentIndex++)
+            {
+                NavMesh::AgentTile& agentTile = agentTiles[agentIndex];
+                if (!agentTile.isRequested)
+                    continue;
+
+                rcConfig agentConfig = config;
+                SetAgentConfig(agentConfig, buildSettings.agents[agentIndex]);
+                hasLayersFailed[agentIndex] = !BuildTileCacheLayers(context, timings, buildSettings, agentConfig, *rasterState.solid, chunkX, chunkY, agentTile.layersData);
+            }
+        }
 
-        return WriteDetourTile(timings, path, chunkX, chunkY, config, *state.polyMesh, *state.detailMesh);
+        std::vector<std::unique_ptr<RecastBuildState>> agentStates;
+        std::vector<NavMesh::TileBuildResult> agentResults;
+        BuildRecastAgentMeshes(context, timings, buildSettings, config, agentTiles, rasterState, agentStates, agentResults);
+
+        for (size_t agentIndex = 0; agentIndex < agentTiles.size(); agentIndex++)
+        {
+            NavMesh::AgentTile& agentTile = agentTiles[agentIndex];
+            if (!agentTile.isRequested)
+                continue;
+
+            agentTile.result = hasLayersFailed[agentIndex] ? NavMesh::TileBuildResult::Failed : agentResults[agentIndex];
+            if (agentTile.result == NavMesh::TileBuildResult::Success)
+            {
+                const RecastBuildState& state = *agentStates[agentIndex];
+                agentTile.result = CreateDetourTile(timings, chunkX, chunkY, config, buildSettings.agents[agentIndex], *state.polyMesh, *state.detailMesh, agentTile.bytes);
+            }
+        }
     }
 
-    NavMesh::TileBuildResult BuildSubtiledNavMeshTile(rcContext& context, NavMesh::BuildTimings& timings, const NavMesh::BuildSettings& buildSettings, const std::filesystem::path& path, u32 chunkX, u32 chunkY, const rcConfig& outerConfig, const std::vector<f32>& vertices, const std::vector<i32>& triangles, f32 minY, f32 maxY)
+    void BuildSubtiledNavMeshTile(rcContext& context, NavMesh::BuildTimings& timings, const NavMesh::BuildSettings& buildSettings, u32 chunkX, u32 chunkY, const rcConfig& outerConfig, const TerrainNeighbourhood* terrain, const std::vector<f32>& vertices, const std::vector<i32>& triangles, f32 minY, f32 maxY, std::vector<NavMesh::AgentTile>& agentTiles)
     {
+        struct AgentSubtiles
+        {
+            std::vector<std::unique_ptr<RecastBuildState>> substates;
+            std::vector<rcPolyMesh*> polyMeshes;
+            std::vector<rcPolyMeshDetail*> detailMeshes;
+            bool hasFailed = false;
+        };
+
         const i32 subtilesPerAxis = Settings::TILE_VOXEL_SIZE / buildSettings.internalSubtileVoxelSize;
-        std::vector<std::unique_ptr<RecastBuildState>> substates;
-        std::vector<rcPolyMesh*> polyMeshes;
-        std::vector<rcPolyMeshDetail*> detailMeshes;
+        const size_t numAgents = buildSettings.agents.size();
+        std::vector<AgentSubtiles> agentSubtiles(numAgents);
+        std::vector<std::unique_ptr<RecastBuildState>> agentStates;
+        std::vector<NavMesh::TileBuildResult> agentResults;
         std::vector<i32> filteredTriangles;
 
-        substates.reserve(static_cast<size_t>(subtilesPerAxis) * subtilesPerAxis);
-        polyMeshes.reserve(substates.capacity());
-        detailMeshes.reserve(substates.capacity());
-
-        for (i32 subtileY = 0; subtileY < subtilesPerAxis; subtileY++)
+        bool hasRasterFailed = false;
+        for (i32 subtileY = 0; subtileY < subtilesPerAxis && !hasRasterFailed; subtileY++)
         {
             for (i32 subtileX = 0; subtileX < subtilesPerAxis; subtileX++)
             {
                 rcConfig subtileConfig = outerConfig;
                 SetSubtileBounds(subtileConfig, buildSettings, chunkX, chunkY, subtileX, subtileY, buildSettings.internalSubtileVoxelSize, minY, maxY);
                 AppendTrianglesForBounds(vertices, triangles, subtileConfig, filteredTriangles);
-                if (filteredTriangles.empty())
+                if (!terrain && filteredTriangles.empty())
                     continue;
 
-                std::unique_ptr<RecastBuildState> state = std::make_unique<RecastBuildState>();
-                const NavMesh::TileBuildResult buildResult = BuildRecastMesh(context, timings, buildSettings, subtileConfig, vertices, filteredTriangles, *state);
-                if (buildResult == NavMesh::TileBuildResult::Failed)
-                    return buildResult;
+                RecastBuildState rasterState;
+                const NavMesh::TileBuildResult rasterResult = RasterizeRecastHeightfield(context, timings, subtileConfig, terrain, vertices, filteredTriangles, rasterState);
+                if (rasterResult == NavMesh::TileBuildResult::Failed)
+                {
+                    hasRasterFailed = true;
+                    break;
+                }
 
-                if (buildResult == NavMesh::TileBuildResult::Empty)
+                if (rasterResult == NavMesh::TileBuildResult::Empty)
                     continue;
 
-                polyMeshes.push_back(state->polyMesh);
-                detailMeshes.push_back(state->detailMesh);
-                substates.push_back(std::move(state));
+                BuildRecastAgentMeshes(context, timings, buildSettings, subtileConfig, agentTiles, rasterState, agentStates, agentResults);
+                for (size_t agentIndex = 0; agentIndex < numAgents; agentIndex++)
+                {
+                    AgentSubtiles& subtiles = agentSubtiles[agentIndex];
+                    if (agentResults[agentIndex] == NavMesh::TileBuildResult::Failed)
+                        subtiles.hasFailed = true;
+
+                    if (agentResults[agentIndex] != NavMesh::TileBuildResult::Success)
+                        continue;
+
+                    subtiles.polyMeshes.push_back(agentStates[agentIndex]->polyMesh);
+                    subtiles.detailMeshes.push_back(agentStates[agentIndex]->detailMesh);
+                    subtiles.substates.push_back(std::move(agentStates[agentIndex]));
+                }
             }
         }
 
-        if (substates.empty())
-            return NavMesh::TileBuildResult::Empty;
-
-        RecastBuildState mergedState;
+        for (size_t agentIndex = 0; agentIndex < numAgents; agentIndex++)
         {
-            PhaseTimer phaseTimer(timings.polyMeshSeconds);
-            mergedState.polyMesh = rcAllocPolyMesh();
-            if (!mergedState.polyMesh || !rcMergePolyMeshes(&context, polyMeshes.data(), static_cast<i32>(polyMeshes.size()), *mergedState.polyMesh))
-                return NavMesh::TileBuildResult::Failed;
+            NavMesh::AgentTile& agentTile = agentTiles[agentIndex];
+            if (!agentTile.isRequested)
+                continue;
 
-            if (mergedState.polyMesh->npolys == 0)
-                return NavMesh::TileBuildResult::Empty;
-        }
+            AgentSubtiles& subtiles = agentSubtiles[agentIndex];
+            if (hasRasterFailed || subtiles.hasFailed)
+            {
+                agentTile.result = NavMesh::TileBuildResult::Failed;
+                continue;
+            }
 
-        {
-            PhaseTimer phaseTimer(timings.detailMeshSeconds);
-            mergedState.detailMesh = rcAllocPolyMeshDetail();
-            if (!mergedState.detailMesh || !rcMergePolyMeshDetails(&context, detailMeshes.data(), static_cast<i32>(detailMeshes.size()), *mergedState.detailMesh))
-                return NavMesh::TileBuildResult::Failed;
+            agentTile.result = NavMesh::TileBuildResult::Empty;
+            if (subtiles.substates.empty())
+                continue;
 
-            if (mergedState.detailMesh->nmeshes == 0)
-                return NavMesh::TileBuildResult::Empty;
-        }
+            RecastBuildState mergedState;
+            {
+                PhaseTimer phaseTimer(timings.polyMeshSeconds);
+                mergedState.polyMesh = rcAllocPolyMesh();
+                if (!mergedState.polyMesh || !rcMergePolyMeshes(&context, subtiles.polyMeshes.data(), static_cast<i32>(subtiles.polyMeshes.size()), *mergedState.polyMesh))
+                {
+                    agentTile.result = NavMesh::TileBuildResult::Failed;
+                    continue;
+                }
+
+                if (mergedState.polyMesh->npolys == 0)
+                    continue;
+            }
+
+            {
+                PhaseTimer phaseTimer(timings.detailMeshSeconds);
+                mergedState.detailMesh = rcAllocPolyMeshDetail();
+                if (!mergedState.detailMesh || !rcMergePolyMeshDetails(&context, subtiles.detailMeshes.data(), static_cast<i32>(subtiles.detailMeshes.size()), *mergedState.detailMesh))
+                {
+                    agentTile.result = NavMesh::TileBuildResult::Failed;
+                    continue;
+                }
+
+                if (mergedState.detailMesh->nmeshes == 0)
+                    continue;
+            }
 
-        return WriteDetourTile(timings, path, chunkX, chunkY, outerConfig, *mergedState.polyMesh, *mergedState.detailMesh);
+            agentTile.result = CreateDetourTile(timings, chunkX, chunkY, outerConfig, buildSettings.agents[agentIndex], *mergedState.polyMesh, *mergedState.detailMesh, agentTile.bytes);
+        }
     }
 
-    NavMesh::TileBuildResult BuildNavMeshTile(rcContext& context, NavMesh::BuildTimings& timings, const NavMesh::BuildSettings& buildSettings, const std::filesystem::path& path, u32 chunkX, u32 chunkY, const std::vector<f32>& vertices, const std::vector<i32>& triangles)
+    void BuildNavMeshTile(rcContext& context, NavMesh::BuildTimings& timings, const NavMesh::BuildSettings& buildSettings, u32 chunkX, u32 chunkY, const TerrainNeighbourhood* terrain, const std::vector<f32>& vertices, const std::vector<i32>& triangles, std::vector<NavMesh::AgentTile>& agentTiles)
     {
         PhaseTimer totalTimer(timings.totalSeconds);
-        if (vertices.empty() || triangles.empty())
-            return NavMesh::TileBuildResult::Empty;
 
-        vec3 geometryMin;
-        vec3 geometryMax;
-        rcCalcBounds(vertices.data(), static_cast<i32>(vertices.size() / 3), &geometryMin.x, &geometryMax.x);
+        f32 minY = std::numeric_limits<f32>::max();
+        f32 maxY = std::numeric_limits<f32>::lowest();
+        bool hasGeometry = false;
+        if (terrain)
+            hasGeometry = GetTerrainHeightBounds(*terrain, Settings::GetBorderSize(buildSettings), minY, maxY);
+
+        if (!vertices.empty() && !triangles.empty())
+        {
+            vec3 geometryMin;
+            vec3 geometryMax;
+            rcCalcBounds(vertices.data(), static_cast<i32>(vertices.size() / 3), &geometryMin.x, &geometryMax.x);
+            minY = std::min(minY, geometryMin.y);
+            maxY = std::max(maxY, geometryMax.y);
+            hasGeometry = true;
+        }
+
+        if (!hasGeometry)
+        {
+            for (NavMesh::AgentTile& agentTile : agentTiles)
+            {
+                if (agentTile.isRequested)
+                    agentTile.result = NavMesh::TileBuildResult::Empty;
+            }
+            return;
+        }
 
         rcConfig config = CreateBaseConfig(buildSettings);
-        SetTileBounds(config, chunkX, chunkY, geometryMin.y, geometryMax.y);
+        SetTileBounds(config, chunkX, chunkY, minY, maxY);
 
         if (Settings::IsValidInternalSubtileVoxelSize(buildSettings.internalSubtileVoxelSize))
-            return BuildSubtiledNavMeshTile(context, timings, buildSettings, path, chunkX, chunkY, config, vertices, triangles, geometryMin.y, geometryMax.y);
+        {
+            BuildSubtiledNavMeshTile(context, timings, buildSettings, chunkX, chunkY, config, terrain, vertices, triangles, minY, maxY, agentTiles);
+            return;
+        }
 
-        return BuildSingleNavMeshTile(context, timings, buildSettings, path, chunkX, chunkY, config, vertices, triangles);
+        BuildSingleNavMeshTile(context, timings, buildSettings, chunkX, chunkY, config, terrain, vertices, triangles, agentTiles);
     }
 }
 
 struct NavMesh::SourceStore::Impl
 {
     std::array<std::unique_ptr<NavSourceData>, Terrain::CHUNK_NUM_PER_MAP> sources;
+    std::array<std::vector<NavObjectPlacement>, Terrain::CHUNK_NUM_PER_MAP> objects;
 };
 
 struct NavMesh::Worker::Impl
@@ -631,6 +1523,8 @@ struct NavMesh::Worker::Impl
         constexpr u32 maxCellsPerTile = (Terrain::CHUNK_NUM_CELLS_PER_STRIDE + 2) * (Terrain::CHUNK_NUM_CELLS_PER_STRIDE + 2);
         vertices.reserve(maxCellsPerTile * Terrain::CELL_TOTAL_GRID_SIZE * 3);
         triangles.reserve(maxCellsPerTile * Terrain::CELL_NUM_INDICES);
+
+        InstallRecastAllocator();
     }
 
     const SourceStore& sourceStore;
@@ -639,6 +1533,10 @@ struct NavMesh::Worker::Impl
     BuildTimings timings;
     std::vector<f32> vertices;
     std::vector<i32> triangles;
+    std::vector<const NavObjectPlacement*> tileObjects;
+    std::vector<vec3> objectVertices;
+    std::vector<i32> objectVertexRemap;
+    std::vector<u8> heightData;
 };
 
 NavMesh::SourceStore::SourceStore()
@@ -664,7 +1562,7 @@ bool NavMesh::SourceStore::Add(u32 chunkX, u32 chunkY, const Map::Chunk& chunk)
         return false;
 
     // The extraction task owns each chunk ID exactly once, so parallel workers
-    // write distinct array elements before the navmesh pass begins.
+    // write distinct array elements before any tile that reads them is scheduled.
     source = std::make_unique<NavSourceData>();
     std::memcpy(source->heights.data(), chunk.cellsData.heightField, sizeof(chunk.cellsData.heightField));
     std::memcpy(source->holes.data(), chunk.cellsData.holes, sizeof(chunk.cellsData.holes));
@@ -724,6 +1622,67 @@ bool NavMesh::SourceStore::Add(u32 chunkX, u32 chunkY, const Adt::Layout& layout
     return true;
 }
 
+bool NavMesh::SourceStore::AddObjects(u32 chunkX, u32 chunkY, const std::vector<ObjectPlacement>& placements)
+{
+    if (!_impl ||
+        chunkX >= Terrain::CHUNK_NUM_PER_MAP_STRIDE ||
+        chunkY >= Terrain::CHUNK_NUM_PER_MAP_STRIDE)
+    {
+        return false;
+    }
+
+    std::vector<NavObjectPlacement>& objects = _impl->objects[GetChunkID(chunkX, chunkY)];
+    if (!objects.empty())
+        return false;
+
+    objects.reserve(placements.size());
+    for (const ObjectPlacement& placement : placements)
+    {
+        if (!placement.mesh || placement.mesh->indices.empty())
+            continue;
+
+        NavObjectPlacement& object = objects.emplace_back();
+        object.mesh = placement.mesh;
+        object.uniqueID = placement.uniqueID;
+        object.transform = GetObjectTransform(placement);
+        GetObjectBounds(*placement.mesh, object.transform, object.boundsMin, object.boundsMax);
+    }
+
+    return true;
+}
+
+bool NavMesh::SourceStore::Contains(u32 chunkX, u32 chunkY) const
+{
+    if (!_impl ||
+        chunkX >= Terrain::CHUNK_NUM_PER_MAP_STRIDE ||
+        chunkY >= Terrain::CHUNK_NUM_PER_MAP_STRIDE)
+    {
+        return false;
+    }
+
+    return _impl->sources[GetChunkID(chunkX, chunkY)] != nullptr;
+}
+
+bool NavMesh::SourceStore::Release(u32 chunkX, u32 chunkY)
+{
+    if (!_impl ||
+        chunkX >= Terrain::CHUNK_NUM_PER_MAP_STRIDE ||
+        chunkY >= Terrain::CHUNK_NUM_PER_MAP_STRIDE)
+    {
+        return false;
+    }
+
+    // Only valid once every tile whose 3x3 neighbourhood includes this source has been built
+    std::vector<NavObjectPlacement>().swap(_impl->objects[GetChunkID(chunkX, chunkY)]);
+
+    std::unique_ptr<NavSourceData>& source = _impl->sources[GetChunkID(chunkX, chunkY)];
+    if (!source)
+        return false;
+
+    source.reset();
+    return true;
+}
+
 void NavMesh::SourceStore::GetSourceIDs(std::vector<u32>& sourceIDs) const
 {
     sourceIDs.clear();
@@ -746,9 +1705,19 @@ void NavMesh::SourceStore::Clear()
         {
             source.reset();
         }
+
+        for (std::vector<NavObjectPlacement>& objects : _impl->objects)
+        {
+            std::vector<NavObjectPlacement>().swap(objects);
+        }
     }
 }
 
+size_t NavMesh::SourceStore::GetSourceSize()
+{
+    return sizeof(NavSourceData);
+}
+
 NavMesh::Worker::Worker(const SourceStore& sourceStore, const BuildSettings& buildSettings)
     : _impl(std::make_unique<Impl>(sourceStore, buildSettings))
 {
@@ -761,18 +1730,104 @@ const NavMesh::BuildTimings& NavMesh::Worker::GetBuildTimings() const
     return _impl->timings;
 }
 
-NavMesh::TileBuildResult NavMesh::Worker::BuildTile(const std::filesystem::path& outputDirectory, const std::string& mapName, u32 chunkX, u32 chunkY)
+u64 NavMesh::Worker::GetSourceHash(u32 chunkX, u32 chunkY, u32 agentIndex) const
+{
+    const BuildSettings& buildSettings = _impl->buildSettings;
+    const AgentSettings& agent = buildSettings.agents[agentIndex];
+    XXHash64 hasher(0);
+    hasher.add(&BUILDER_VERSION, sizeof(BUILDER_VERSION));
+
+    // Hashed field by field, the structs have padding
+    const u8 flags[] =
+    {
+        buildSettings.useMonotonePartitioning,
+        buildSettings.useMedianFilter,
+        buildSettings.useTerrainGridRasterization,
+        buildSettings.compactTerrainHeights
+    };
+    const f32 values[] =
+    {
+        buildSettings.detailSampleDistance,
+        buildSettings.maxEdgeLength,
+        buildSettings.maxSimplificationError,
+        buildSettings.minRegionRadius,
+        buildSettings.mergeRegionRadius,
+        agent.height,
+        agent.radius,
+        agent.maxClimb,
+        NavMesh::Agent::MAX_SLOPE
+    };
+
+    // The shared heightfield depends on the other agents through its border and merge threshold
+    const i32 voxelValues[] =
+    {
+        buildSettings.internalSubtileVoxelSize,
+        Settings::GetBorderSize(buildSettings),
+        Settings::GetRasterizationClimb(buildSettings)
+    };
+    hasher.add(flags, sizeof(flags));
+    hasher.add(values, sizeof(values));
+    hasher.add(voxelValues, sizeof(voxelValues));
+
+    for (i32 offsetY = -1; offsetY <= 1; offsetY++)
+    {
+        for (i32 offsetX = -1; offsetX <= 1; offsetX++)
+        {
+            const i32 sourceChunkX = static_cast<i32>(chunkX) + offsetX;
+            const i32 sourceChunkY = static_cast<i32>(chunkY) + offsetY;
+            const bool inMap = sourceChunkX >= 0 && sourceChunkY >= 0 &&
+                sourceChunkX < static_cast<i32>(Terrain::CHUNK_NUM_PER_MAP_STRIDE) &&
+                sourceChunkY < static_cast<i32>(Terrain::CHUNK_NUM_PER_MAP_STRIDE);
+
+            const NavSourceData* source = inMap ? _impl->sourceStore._impl->sources[GetChunkID(sourceChunkX, sourceChunkY)].get() : nullptr;
+            const u8 hasSource = source != nullptr;
+            hasher.add(&hasSource, sizeof(hasSource));
+            if (source)
+                hasher.add(source, sizeof(NavSourceData));
+
+            if (!inMap)
+                continue;
+
+            const std::vector<NavObjectPlacement>& objects = _impl->sourceStore._impl->objects[GetChunkID(sourceChunkX, sourceChunkY)];
+            const u32 numObjects = static_cast<u32>(objects.size());
+            hasher.add(&numObjects, sizeof(numObjects));
+            for (const NavObjectPlacement& object : objects)
+            {
+                hasher.add(&object.uniqueID, sizeof(object.uniqueID));
+                hasher.add(&object.mesh->hash, sizeof(object.mesh->hash));
+                hasher.add(&object.transform[0][0], sizeof(object.transform));
+            }
+        }
+    }
+
+    return hasher.hash();
+}
+
+NavMesh::TileBuildResult NavMesh::Worker::BuildTile(u32 chunkX, u32 chunkY, std::vector<AgentTile>& agentTiles, std::vector<u8>& heightData)
 {
+    // The buffer may still hold the previous tile's heights, it is only filled again once the agents succeeded
+    heightData.clear();
+
     const NavSourceData* targetSource = _impl->sourceStore._impl->sources[GetChunkID(chunkX, chunkY)].get();
     if (!targetSource)
         return TileBuildResult::SourceMissing;
 
+    if (agentTiles.size() != _impl->buildSettings.agents.size())
+        return TileBuildResult::Failed;
+
+    // Every Recast allocation below lands in the calling thread's arena, which is rewound on return
+    ScopedRecastArena scopedRecastArena;
+
     _impl->vertices.clear();
     _impl->triangles.clear();
 
+    TerrainNeighbourhood terrain;
+    terrain.chunkX = static_cast<i32>(chunkX);
+    terrain.chunkY = static_cast<i32>(chunkY);
+
     const vec2 tileMin = GetChunkWorldOrigin(chunkX, chunkY);
     const vec2 tileMax = tileMin + Terrain::CHUNK_SIZE;
-    const f32 borderWorldSize = Settings::GetBorderWorldSize();
+    const f32 borderWorldSize = Settings::GetBorderWorldSize(_impl->buildSettings);
     const vec2 paddedMin = tileMin - borderWorldSize;
     const vec2 paddedMax = tileMax + borderWorldSize;
 
@@ -789,24 +1844,124 @@ NavMesh::TileBuildResult NavMesh::Worker::BuildTile(const std::filesystem::path&
             if (!source)
                 continue;
 
+            if (_impl->buildSettings.useTerrainGridRasterization)
+            {
+                terrain.sources[(sourceChunkX - terrain.chunkX + 1) + (sourceChunkY - terrain.chunkY + 1) * 3] = source;
+                continue;
+            }
+
             AppendSourceGeometry(*source, sourceChunkX, sourceChunkY, paddedMin, paddedMax, _impl->vertices, _impl->triangles);
         }
     }
 
-    const std::string tileName = mapName + "_" + std::to_string(chunkX) + "_" + std::to_string(chunkY);
-    const std::filesystem::path navMeshOutputPath = outputDirectory / (tileName + NavMesh::TILE_FILE_EXTENSION);
-    const TileBuildResult buildResult = BuildNavMeshTile(_impl->context, _impl->timings, _impl->buildSettings, navMeshOutputPath, chunkX, chunkY, _impl->vertices, _impl->triangles);
+    // Objects crossing ADT borders are listed by every ADT they overlap, each is added once by unique ID
+    _impl->tileObjects.clear();
+    for (i32 sourceChunkY = minChunkY; sourceChunkY <= maxChunkY; sourceChunkY++)
+    {
+        for (i32 sourceChunkX = minChunkX; sourceChunkX <= maxChunkX; sourceChunkX++)
+        {
+            for (const NavObjectPlacement& object : _impl->sourceStore._impl->objects[GetChunkID(sourceChunkX, sourceChunkY)])
+            {
+                _impl->tileObjects.push_back(&object);
+            }
+        }
+    }
+
+    std::stable_sort(_impl->tileObjects.begin(), _impl->tileObjects.end(), [](const NavObjectPlacement* a, const NavObjectPlacement* b)
+    {
+        return a->uniqueID < b->uniqueID;
+    });
+
+    for (size_t objectIndex = 0; objectIndex < _impl->tileObjects.size(); objectIndex++)
+    {
+        const NavObjectPlacement* object = _impl->tileObjects[objectIndex];
+        if (objectIndex > 0 && _impl->tileObjects[objectIndex - 1]->uniqueID == object->uniqueID)
+            continue;
+
+        AppendObjectGeometry(*object, paddedMin, paddedMax, _impl->objectVertices, _impl->objectVertexRemap, _impl->vertices, _impl->triangles);
+    }
+
+    BuildNavMeshTile(_impl->context, _impl->timings, _impl->buildSettings, chunkX, chunkY, _impl->buildSettings.useTerrainGridRasterization ? &terrain : nullptr, _impl->vertices, _impl->triangles, agentTiles);
+
+    TileBuildResult buildResult = TileBuildResult::Empty;
+    for (const AgentTile& agentTile : agentTiles)
+    {
+        if (!agentTile.isRequested || agentTile.result == TileBuildResult::Empty)
+            continue;
+
+        if (agentTile.result == TileBuildResult::Success || buildResult != TileBuildResult::Success)
+            buildResult = agentTile.result;
+    }
+
+    if (buildResult != TileBuildResult::Success)
+        return buildResult;
+
+    if (!CreateTerrainHeightTile(chunkX, chunkY, *targetSource, _impl->buildSettings.compactTerrainHeights, heightData))
+    {
+        // The agent tiles can't be stored without their height tile
+        for (AgentTile& agentTile : agentTiles)
+        {
+            if (agentTile.isRequested && agentTile.result == TileBuildResult::Success)
+                agentTile.result = TileBuildResult::Failed;
+        }
+
+        heightData.clear();
+        return TileBuildResult::Failed;
+    }
+
+    return TileBuildResult::Success;
+}
+
+NavMesh::TileBuildResult NavMesh::Worker::BuildTile(const std::filesystem::path& outputDirectory, const std::string& mapName, u32 chunkX, u32 chunkY, std::vector<AgentTile>& agentTiles)
+{
+    const TileBuildResult buildResult = BuildTile(chunkX, chunkY, agentTiles, _impl->heightData);
     if (buildResult != TileBuildResult::Success)
         return buildResult;
 
-    const std::filesystem::path heightOutputPath = outputDirectory / (tileName + NavMesh::TerrainHeight::FILE_EXTENSION);
-    if (!WriteTerrainHeightTile(heightOutputPath, chunkX, chunkY, *targetSource))
+    PhaseTimer outputTimer(_impl->timings.detourAndOutputSeconds);
+    const std::string tileName = mapName + "_" + std::to_string(chunkX) + "_" + std::to_string(chunkY);
+    const char* heightExtension = _impl->buildSettings.compactTerrainHeights ? NavMesh::CompactTerrainHeight::FILE_EXTENSION : NavMesh::TerrainHeight::FILE_EXTENSION;
+    const std::filesystem::path heightOutputPath = outputDirectory / (tileName + heightExtension);
+    if (!WriteTileFile(heightOutputPath, _impl->heightData))
     {
         std::error_code error;
-        std::filesystem::remove(navMeshOutputPath, error);
         std::filesystem::remove(heightOutputPath, error);
         return TileBuildResult::Failed;
     }
 
+    for (size_t agentIndex = 0; agentIndex < agentTiles.size(); agentIndex++)
+    {
+        AgentTile& agentTile = agentTiles[agentIndex];
+        if (!agentTile.isRequested || agentTile.result != TileBuildResult::Success)
+            continue;
+
+        const AgentSettings& agent = _impl->buildSettings.agents[agentIndex];
+        const std::filesystem::path agentDirectory = agent.name.empty() ? outputDirectory : outputDirectory / agent.name;
+        const std::filesystem::path navMeshOutputPath = agentDirectory / (tileName + NavMesh::TILE_FILE_EXTENSION);
+        if (!WriteTileFile(navMeshOutputPath, agentTile.bytes))
+        {
+            std::error_code error;
+            std::filesystem::remove(navMeshOutputPath, error);
+            agentTile.result = TileBuildResult::Failed;
+        }
+    }
+
     return TileBuildResult::Success;
 }
+
+void NavMesh::GetTileCacheParams(const BuildSettings& buildSettings, u32 agentIndex, TileCache::Params& params)
+{
+    const AgentSettings& agent = buildSettings.agents[agentIndex];
+
+    params = TileCache::Params();
+    params.origin[0] = -Terrain::MAP_HALF_SIZE;
+    params.origin[2] = -Terrain::MAP_HALF_SIZE;
+    params.cellSize = Settings::CELL_SIZE;
+    params.cellHeight = Settings::CELL_HEIGHT;
+    params.width = Settings::TILE_CACHE_TILE_VOXEL_SIZE;
+    params.height = Settings::TILE_CACHE_TILE_VOXEL_SIZE;
+    params.walkableHeight = agent.height;
+    params.walkableRadius = agent.radius;
+    params.walkableClimb = agent.maxClimb;
+    params.maxSimplificationError = std::max(0.0f, buildSettings.maxSimplificationError);
+}
@@ -4,6 +4,8 @@
 
 #include <Base/Types.h>
 
+#include <glm/gtc/quaternion.hpp>
+
 #include <filesystem>
 #include <memory>
 #include <string>
@@ -19,18 +21,44 @@ namespace Adt
     struct Layout;
 }
 
+namespace NavMesh::TileCache
+{
+    struct Params;
+}
+
 namespace NavMesh
 {
+    // One agent profile, every profile gets its own tile set. An unnamed profile writes into the map's
+    // NavMesh directory, named ones into a subdirectory of it.
+    struct AgentSettings
+    {
+        std::string name;
+        f32 height = Agent::HEIGHT;
+        f32 radius = Agent::RADIUS;
+        f32 maxClimb = Agent::MAX_CLIMB;
+    };
+
     struct BuildSettings
     {
         bool useMonotonePartitioning = false;
         bool useMedianFilter = true;
+        bool useTerrainGridRasterization = true;
         f32 detailSampleDistance = Terrain::PATCH_SIZE;
         f32 maxEdgeLength = 0.0f;
         f32 maxSimplificationError = 1.8f;
         f32 minRegionRadius = 16.0f;
         f32 mergeRegionRadius = 13.333333f;
         i32 internalSubtileVoxelSize = 0;
+
+        // Also keeps compressed dtTileCache layers of every agent, so a server can carve temporary obstacles
+        // without a full rebuild. Only supported without internal subtiles, see NavMeshTileCache.h.
+        bool buildTileCacheLayers = false;
+
+        // Writes the terrain height tiles as 16 bit heights with a min/max pyramid, see NavMeshCompactHeight.h
+        bool compactTerrainHeights = false;
+
+        // Each tile is rasterized once, the agents branch off the shared heightfield
+        std::vector<AgentSettings> agents = { AgentSettings() };
     };
 
     struct BuildTimings
@@ -43,6 +71,7 @@ namespace NavMesh
         f64 polyMeshSeconds = 0.0;
         f64 detailMeshSeconds = 0.0;
         f64 detourAndOutputSeconds = 0.0;
+        f64 tileCacheSeconds = 0.0;
 
         void Accumulate(const BuildTimings& other)
         {
@@ -54,9 +83,30 @@ namespace NavMesh
             polyMeshSeconds += other.polyMeshSeconds;
             detailMeshSeconds += other.detailMeshSeconds;
             detourAndOutputSeconds += other.detourAndOutputSeconds;
+            tileCacheSeconds += other.tileCacheSeconds;
         }
     };
 
+    // Collision geometry of one model in its own space, shared by every placement of it
+    struct CollisionMesh
+    {
+        std::vector<vec3> vertices;
+        std::vector<u32> indices;
+        vec3 boundsMin = vec3(0.0f);
+        vec3 boundsMax = vec3(0.0f);
+        u64 hash = 0;
+    };
+
+    // A model placed by an ADT, position, rotation and scale are in Novus space
+    struct ObjectPlacement
+    {
+        std::shared_ptr<const CollisionMesh> mesh;
+        u32 uniqueID = 0;
+        vec3 position = vec3(0.0f);
+        glm::quat rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+        f32 scale = 1.0f;
+    };
+
     enum class TileBuildResult
     {
         Success,
@@ -65,6 +115,17 @@ namespace NavMesh
         Failed
     };
 
+    // One agent's Detour tile, agents that are not requested keep their previous result and bytes
+    struct AgentTile
+    {
+        bool isRequested = true;
+        TileBuildResult result = TileBuildResult::Empty;
+        std::vector<u8> bytes;
+
+        // The agent's TileCache layers of the tile when they are built, see NavMesh::TileCache::CreateLayersData
+        std::vector<u8> layersData;
+    };
+
     class SourceStore
     {
     public:
@@ -79,9 +140,16 @@ namespace NavMesh
 
         bool Add(u32 chunkX, u32 chunkY, const Map::Chunk& chunk);
         bool Add(u32 chunkX, u32 chunkY, const Adt::Layout& layout);
+
+        // Placements listed by the chunk's ADT, objects spanning several ADTs are listed by each of them
+        bool AddObjects(u32 chunkX, u32 chunkY, const std::vector<ObjectPlacement>& placements);
+        bool Contains(u32 chunkX, u32 chunkY) const;
+        bool Release(u32 chunkX, u32 chunkY);
         void GetSourceIDs(std::vector<u32>& sourceIDs) const;
         void Clear();
 
+        static size_t GetSourceSize();
+
     private:
         friend class Worker;
 
@@ -95,11 +163,23 @@ namespace NavMesh
         Worker(const SourceStore& sourceStore, const BuildSettings& buildSettings);
         ~Worker();
 
-        TileBuildResult BuildTile(const std::filesystem::path& outputDirectory, const std::string& mapName, u32 chunkX, u32 chunkY);
+        // Hash of everything the agent's tile is built from, the sources of its 3x3 neighbourhood and the build
+        // settings. Equal hashes produce identical tiles, so a previous output can be reused as is.
+        u64 GetSourceHash(u32 chunkX, u32 chunkY, u32 agentIndex) const;
+
+        // Builds the requested agents' Detour tiles and the terrain height tile into memory. agentTiles holds
+        // one entry per agent, the result is Success when at least one requested agent produced a tile.
+        TileBuildResult BuildTile(u32 chunkX, u32 chunkY, std::vector<AgentTile>& agentTiles, std::vector<u8>& heightData);
+
+        // Writes them as loose files, agentTiles also receives the Detour tile bytes
+        TileBuildResult BuildTile(const std::filesystem::path& outputDirectory, const std::string& mapName, u32 chunkX, u32 chunkY, std::vector<AgentTile>& agentTiles);
         const BuildTimings& GetBuildTimings() const;
 
     private:
         struct Impl;
         std::unique_ptr<Impl> _impl;
     };
+
+    // dtTileCache parameters matching the agent's layers, maxTiles and maxObstacles are left to the caller
+    void GetTileCacheParams(const BuildSettings& buildSettings, u32 agentIndex, TileCache::Params& params);
 }
@@ -0,0 +1,20 @@
+#include "NavMeshCommon.h"
+
+#include <Detour/DetourCommon.h>
+#include <Detour/DetourNavMesh.h>
+
+#include <algorithm>
+
+void NavMesh::GetPolyCenter(const dtMeshTile& tile, const dtPoly& poly, f32* center)
+{
+    center[0] = 0.0f;
+    center[1] = 0.0f;
+    center[2] = 0.0f;
+
+    for (u32 vertexIndex = 0; vertexIndex < poly.vertCount; vertexIndex++)
+    {
+        dtVadd(center, center, &tile.verts[poly.verts[vertexIndex] * 3]);
+    }
+
+    dtVscale(center, center, 1.0f / static_cast<f32>(std::max<u32>(1, poly.vertCount)));
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <Base/Types.h>
+
+struct dtMeshTile;
+struct dtPoly;
+
+namespace NavMesh
+{
+    // Set by the builder on every polygon with walkable area, queries only include polygons carrying it
+    constexpr u16 WALKABLE_POLY_FLAG = 0x1;
+
+    // Tolerance for seam portal positions across and along the seam. The validator and the path graph both match
+    // portals with it, so they agree on which polygons connect across a seam.
+    constexpr f32 PORTAL_HORIZONTAL_EPSILON = 0.01f;
+
+    // Average of the polygon's vertices
+    void GetPolyCenter(const dtMeshTile& tile, const dtPoly& poly, f32* center);
+}
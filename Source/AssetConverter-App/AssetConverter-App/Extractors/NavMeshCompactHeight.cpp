@@ -0,0 +1,118 @@
+#include "NavMeshCompactHeight.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace
+{
+    constexpr u32 MAX_QUANTIZED_HEIGHT = std::numeric_limits<u16>::max();
+
+    NavMesh::CompactTerrainHeight::PyramidEntry MergeEntries(const NavMesh::CompactTerrainHeight::PyramidEntry& a, const NavMesh::CompactTerrainHeight::PyramidEntry& b)
+    {
+        return { std::min(a.min, b.min), std::max(a.max, b.max) };
+    }
+}
+
+bool NavMesh::CompactTerrainHeight::CreateTileData(const Header& baseHeader, const f32* heights, const u64* holes, std::vector<u8>& heightData)
+{
+    if (baseHeader.cellsPerChunkStride != Terrain::CHUNK_NUM_CELLS_PER_STRIDE ||
+        baseHeader.verticesPerCell != Terrain::CELL_TOTAL_GRID_SIZE ||
+        baseHeader.heightCount != Terrain::CHUNK_NUM_CELLS * Terrain::CELL_TOTAL_GRID_SIZE ||
+        baseHeader.holeCount != Terrain::CHUNK_NUM_CELLS)
+    {
+        return false;
+    }
+
+    Header header = baseHeader;
+    header.magic = MAGIC;
+    header.version = VERSION;
+    header.headerSize = sizeof(Header);
+    header.patchesPerBlockStride = PATCHES_PER_BLOCK_STRIDE;
+    header.pyramidLevelCount = PYRAMID_LEVEL_COUNT;
+
+    const auto [minHeight, maxHeight] = std::minmax_element(heights, heights + header.heightCount);
+    if (!std::isfinite(*minHeight) || !std::isfinite(*maxHeight))
+        return false;
+
+    header.minHeight = *minHeight;
+    header.heightScale = (*maxHeight - *minHeight) / static_cast<f32>(MAX_QUANTIZED_HEIGHT);
+
+    const size_t heightsSize = header.heightCount * sizeof(u16);
+    const size_t holesSize = header.holeCount * sizeof(u64);
+    static_assert((Terrain::CHUNK_NUM_CELLS * Terrain::CELL_TOTAL_GRID_SIZE * sizeof(u16)) % alignof(u64) == 0);
+
+    heightData.assign(sizeof(Header) + heightsSize + holesSize + PYRAMID_ENTRY_COUNT * sizeof(PyramidEntry), 0);
+    u16* quantizedHeights = reinterpret_cast<u16*>(heightData.data() + sizeof(Header));
+    PyramidEntry* pyramid = reinterpret_cast<PyramidEntry*>(heightData.data() + sizeof(Header) + heightsSize + holesSize);
+    std::memcpy(heightData.data(), &header, sizeof(header));
+    std::memcpy(heightData.data() + sizeof(Header) + heightsSize, holes, holesSize);
+
+    const f32 inverseScale = header.heightScale > 0.0f ? 1.0f / header.heightScale : 0.0f;
+    for (u32 heightIndex = 0; heightIndex < header.heightCount; heightIndex++)
+    {
+        const f32 quantized = std::round((heights[heightIndex] - header.minHeight) * inverseScale);
+        quantizedHeights[heightIndex] = static_cast<u16>(std::clamp(quantized, 0.0f, static_cast<f32>(MAX_QUANTIZED_HEIGHT)));
+    }
+
+    // The bounds are taken from the quantized heights, so they contain exactly the surface the server decodes
+    for (u32 blockY = 0; blockY < BLOCKS_PER_CHUNK_STRIDE; blockY++)
+    {
+        for (u32 blockX = 0; blockX < BLOCKS_PER_CHUNK_STRIDE; blockX++)
+        {
+            PyramidEntry entry = { static_cast<u16>(MAX_QUANTIZED_HEIGHT), 0 };
+            for (u32 patchY = blockY * PATCHES_PER_BLOCK_STRIDE; patchY < (blockY + 1) * PATCHES_PER_BLOCK_STRIDE; patchY++)
+            {
+                for (u32 patchX = blockX * PATCHES_PER_BLOCK_STRIDE; patchX < (blockX + 1) * PATCHES_PER_BLOCK_STRIDE; patchX++)
+                {
+                    const u32 cellID = (patchX / Terrain::CELL_NUM_PATCHES_PER_STRIDE) + (patchY / Terrain::CELL_NUM_PATCHES_PER_STRIDE) * Terrain::CHUNK_NUM_CELLS_PER_STRIDE;
+                    const u32 patchRow = patchY % Terrain::CELL_NUM_PATCHES_PER_STRIDE;
+                    const u32 patchColumn = patchX % Terrain::CELL_NUM_PATCHES_PER_STRIDE;
+                    const u32 patchID = patchColumn + patchRow * Terrain::CELL_NUM_PATCHES_PER_STRIDE;
+                    if ((holes[cellID] & (1ull << patchID)) != 0)
+                        continue;
+
+                    // The four outer corners of the patch and the inner vertex at its center
+                    std::array<u32, 5> patchVertexIDs;
+                    patchVertexIDs[0] = patchColumn + patchRow * Terrain::CELL_GRID_ROW_SIZE;
+                    patchVertexIDs[1] = patchVertexIDs[0] + 1;
+                    patchVertexIDs[2] = patchVertexIDs[0] + Terrain::CELL_GRID_ROW_SIZE;
+                    patchVertexIDs[3] = patchVertexIDs[2] + 1;
+                    patchVertexIDs[4] = patchVertexIDs[0] + Terrain::CELL_OUTER_GRID_STRIDE;
+
+                    for (u32 vertexID : patchVertexIDs)
+                    {
+                        const u16 height = quantizedHeights[cellID * Terrain::CELL_TOTAL_GRID_SIZE + vertexID];
+                        entry.min = std::min(entry.min, height);
+                        entry.max = std::max(entry.max, height);
+                    }
+                }
+            }
+
+            pyramid[blockX + blockY * BLOCKS_PER_CHUNK_STRIDE] = entry;
+        }
+    }
+
+    u32 levelOffset = 0;
+    for (u32 blocksPerStride = BLOCKS_PER_CHUNK_STRIDE; blocksPerStride > 1; blocksPerStride /= 2)
+    {
+        const u32 parentOffset = levelOffset + blocksPerStride * blocksPerStride;
+        const u32 parentsPerStride = blocksPerStride / 2;
+        for (u32 parentY = 0; parentY < parentsPerStride; parentY++)
+        {
+            for (u32 parentX = 0; parentX < parentsPerStride; parentX++)
+            {
+                const u32 childIndex = levelOffset + (parentX * 2) + (parentY * 2) * blocksPerStride;
+                const PyramidEntry top = MergeEntries(pyramid[childIndex], pyramid[childIndex + 1]);
+                const PyramidEntry bottom = MergeEntries(pyramid[childIndex + blocksPerStride], pyramid[childIndex + blocksPerStride + 1]);
+                pyramid[parentOffset + parentX + parentY * parentsPerStride] = MergeEntries(top, bottom);
+            }
+        }
+
+        levelOffset = parentOffset;
+    }
+
+    return true;
+}
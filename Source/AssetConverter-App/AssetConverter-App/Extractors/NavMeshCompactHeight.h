@@ -0,0 +1,82 @@
+#pragma once
+
+#include <Base/Types.h>
+
+#include <FileFormat/Shared.h>
+
+#include <vector>
+
+namespace NavMesh::CompactTerrainHeight
+{
+    // Compact variant of the TerrainHeight tiles. Heights are stored as 16 bit values quantized against the
+    // tile's own height range, followed by the unchanged hole bits and a min/max pyramid over blocks of
+    // terrain patches. Line of sight and raycast queries can skip every block the ray passes above or below.
+    constexpr u32 MAGIC = 0x48434E4E; // "NNCH"
+    constexpr u32 VERSION = 1;
+    constexpr const char* FILE_EXTENSION = ".nmcheight";
+
+    // Level 0 covers 4x4 patches, each level above halves the blocks per side down to one for the whole tile
+    constexpr u32 PATCHES_PER_BLOCK_STRIDE = 4;
+    constexpr u32 PATCHES_PER_CHUNK_STRIDE = Terrain::CHUNK_NUM_CELLS_PER_STRIDE * Terrain::CELL_NUM_PATCHES_PER_STRIDE;
+    constexpr u32 BLOCKS_PER_CHUNK_STRIDE = PATCHES_PER_CHUNK_STRIDE / PATCHES_PER_BLOCK_STRIDE;
+    static_assert(PATCHES_PER_CHUNK_STRIDE % PATCHES_PER_BLOCK_STRIDE == 0);
+
+    constexpr u32 GetPyramidLevelCount()
+    {
+        u32 levelCount = 1;
+        for (u32 blocksPerStride = BLOCKS_PER_CHUNK_STRIDE; blocksPerStride > 1; blocksPerStride /= 2)
+        {
+            levelCount++;
+        }
+
+        return levelCount;
+    }
+
+    constexpr u32 GetPyramidEntryCount()
+    {
+        u32 entryCount = 0;
+        for (u32 blocksPerStride = BLOCKS_PER_CHUNK_STRIDE; blocksPerStride > 0; blocksPerStride /= 2)
+        {
+            entryCount += blocksPerStride * blocksPerStride;
+        }
+
+        return entryCount;
+    }
+
+    constexpr u32 PYRAMID_LEVEL_COUNT = GetPyramidLevelCount();
+    constexpr u32 PYRAMID_ENTRY_COUNT = GetPyramidEntryCount();
+
+    // Followed by heightCount quantized heights in the native 145 value ADT cell order, holeCount hole masks
+    // and the pyramid levels from the finest up. A height decodes to minHeight + value * heightScale.
+    struct Header
+    {
+        u32 magic = MAGIC;
+        u32 version = VERSION;
+        u32 headerSize = sizeof(Header);
+        u32 chunkX = 0;
+        u32 chunkY = 0;
+        f32 originX = 0.0f;
+        f32 originZ = 0.0f;
+        f32 chunkSize = 0.0f;
+        f32 minHeight = 0.0f;
+        f32 heightScale = 0.0f;
+        u32 cellsPerChunkStride = 0;
+        u32 verticesPerCell = 0;
+        u32 heightCount = 0;
+        u32 holeCount = 0;
+        u32 patchesPerBlockStride = PATCHES_PER_BLOCK_STRIDE;
+        u32 pyramidLevelCount = PYRAMID_LEVEL_COUNT;
+    };
+    static_assert(sizeof(Header) == 64);
+
+    // Bounds of one block in quantized heights, rows of blocks run along the patch rows of the cells.
+    // A block that only covers holes has min above max.
+    struct PyramidEntry
+    {
+        u16 min = 0;
+        u16 max = 0;
+    };
+    static_assert(sizeof(PyramidEntry) == 4);
+
+    bool CreateTileData(const Header& baseHeader, const f32* heights, const u64* holes, std::vector<u8>& heightData);
+}
@@ -0,0 +1,232 @@
+#include "NavMeshContainer.h"
+
+#include <FileFormat/Novus/NavMesh/NavMesh.h>
+
+#include <Detour/DetourNavMesh.h>
+
+#include <algorithm>
+#include <limits>
+
+namespace
+{
+    static_assert(sizeof(NavMesh::Container::NavMeshParams) == sizeof(dtNavMeshParams));
+
+    bool WritePadding(std::ofstream& output, u64& offset)
+    {
+        const u64 padding = (NavMesh::Container::BLOB_ALIGNMENT - (offset % NavMesh::Container::BLOB_ALIGNMENT)) % NavMesh::Container::BLOB_ALIGNMENT;
+        const u8 zeroes[NavMesh::Container::BLOB_ALIGNMENT] = { };
+        output.write(reinterpret_cast<const char*>(zeroes), static_cast<std::streamsize>(padding));
+        offset += padding;
+        return output.good();
+    }
+}
+
+NavMesh::Container::Writer::~Writer()
+{
+    Abort();
+}
+
+bool NavMesh::Container::Writer::Open(const std::filesystem::path& path)
+{
+    std::scoped_lock lock(_mutex);
+
+    _path = path;
+    _temporaryPath = path;
+    _temporaryPath += ".tmp";
+    _tileEntries.clear();
+    _header = NavMesh::Container::Header();
+    _minHeight = std::numeric_limits<f32>::max();
+    _failed = false;
+
+    _output.open(_temporaryPath, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!_output)
+    {
+        _failed = true;
+        return false;
+    }
+
+    // Reserve the header, it is rewritten once every tile is known
+    _output.write(reinterpret_cast<const char*>(&_header), sizeof(_header));
+    _offset = sizeof(_header);
+    _failed = !_output.good();
+    return !_failed;
+}
+
+bool NavMesh::Container::Writer::AddTile(u32 tileID, u64 sourceHash, const std::vector<u8>& navMeshData, const std::vector<u8>& heightData)
+{
+    if (navMeshData.size() < sizeof(dtMeshHeader) ||
+        navMeshData.size() > std::numeric_limits<u32>::max() ||
+        heightData.size() > std::numeric_limits<u32>::max())
+    {
+        return false;
+    }
+
+    std::scoped_lock lock(_mutex);
+    if (_failed || !_output.is_open())
+        return false;
+
+    NavMesh::Container::TileEntry& tileEntry = _tileEntries.emplace_back();
+    tileEntry.tileID = tileID;
+    tileEntry.navMeshSize = static_cast<u32>(navMeshData.size());
+    tileEntry.heightSize = static_cast<u32>(heightData.size());
+    tileEntry.sourceHash = sourceHash;
+    if (!WriteBlob(navMeshData, tileEntry.navMeshOffset) || !WriteBlob(heightData, tileEntry.heightOffset))
+    {
+        _failed = true;
+        return false;
+    }
+
+    const dtMeshHeader* meshHeader = reinterpret_cast<const dtMeshHeader*>(navMeshData.data());
+    _minHeight = std::min(_minHeight, meshHeader->bmin[1]);
+    _header.params.maxPolys = std::max(_header.params.maxPolys, meshHeader->polyCount);
+    return true;
+}
+
+bool NavMesh::Container::Writer::Finish()
+{
+    std::scoped_lock lock(_mutex);
+    if (_failed || !_output.is_open())
+        return false;
+
+    std::sort(_tileEntries.begin(), _tileEntries.end(), [](const NavMesh::Container::TileEntry& a, const NavMesh::Container::TileEntry& b)
+    {
+        return a.tileID < b.tileID;
+    });
+
+    WritePadding(_output, _offset);
+
+    _header.tileCount = static_cast<u32>(_tileEntries.size());
+    _header.tileTableOffset = _offset;
+    _header.params.origin[0] = -Terrain::MAP_HALF_SIZE;
+    _header.params.origin[1] = _tileEntries.empty() ? 0.0f : _minHeight;
+    _header.params.origin[2] = -Terrain::MAP_HALF_SIZE;
+    _header.params.tileWidth = Terrain::CHUNK_SIZE;
+    _header.params.tileHeight = Terrain::CHUNK_SIZE;
+    _header.params.maxTiles = std::max(1, static_cast<i32>(_tileEntries.size()));
+
+    _output.write(reinterpret_cast<const char*>(_tileEntries.data()), static_cast<std::streamsize>(_tileEntries.size() * sizeof(NavMesh::Container::TileEntry)));
+    _output.seekp(0);
+    _output.write(reinterpret_cast<const char*>(&_header), sizeof(_header));
+    _output.flush();
+    const bool written = _output.good();
+    _output.close();
+
+    std::error_code error;
+    if (written)
+        std::filesystem::rename(_temporaryPath, _path, error);
+
+    if (!written || error)
+    {
+        _failed = true;
+        std::filesystem::remove(_temporaryPath, error);
+        return false;
+    }
+
+    return true;
+}
+
+void NavMesh::Container::Writer::Abort()
+{
+    std::scoped_lock lock(_mutex);
+    if (!_output.is_open())
+        return;
+
+    _output.close();
+    _failed = true;
+
+    std::error_code error;
+    std::filesystem::remove(_temporaryPath, error);
+}
+
+bool NavMesh::Container::Writer::WriteBlob(const std::vector<u8>& data, u64& offset)
+{
+    WritePadding(_output, _offset);
+
+    offset = _offset;
+    _output.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+    _offset += data.size();
+    return _output.good();
+}
+
+bool NavMesh::Container::Reader::Open(const std::filesystem::path& path)
+{
+    std::scoped_lock lock(_mutex);
+    _tileEntries.clear();
+
+    std::error_code error;
+    _fileSize = std::filesystem::file_size(path, error);
+    if (error || _fileSize < sizeof(NavMesh::Container::Header))
+        return false;
+
+    _input.open(path, std::ios::in | std::ios::binary);
+    if (!_input)
+        return false;
+
+    NavMesh::Container::Header header;
+    _input.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!_input ||
+        header.magic != MAGIC ||
+        header.version != VERSION ||
+        header.headerSize != sizeof(header) ||
+        header.tileTableOffset > _fileSize ||
+        header.tileCount > (_fileSize - header.tileTableOffset) / sizeof(NavMesh::Container::TileEntry))
+    {
+        _input.close();
+        return false;
+    }
+
+    _tileEntries.resize(header.tileCount);
+    _input.seekg(static_cast<std::streamoff>(header.tileTableOffset));
+    _input.read(reinterpret_cast<char*>(_tileEntries.data()), static_cast<std::streamsize>(_tileEntries.size() * sizeof(NavMesh::Container::TileEntry)));
+    if (!_input)
+    {
+        _tileEntries.clear();
+        _input.close();
+        return false;
+    }
+
+    _params = header.params;
+    return true;
+}
+
+const NavMesh::Container::TileEntry* NavMesh::Container::Reader::FindTile(u32 tileID) const
+{
+    auto it = std::lower_bound(_tileEntries.begin(), _tileEntries.end(), tileID, [](const NavMesh::Container::TileEntry& tileEntry, u32 id)
+    {
+        return tileEntry.tileID < id;
+    });
+
+    if (it == _tileEntries.end() || it->tileID != tileID)
+        return nullptr;
+
+    return &*it;
+}
+
+bool NavMesh::Container::Reader::ReadTile(const NavMesh::Container::TileEntry& tileEntry, std::vector<u8>& navMeshData, std::vector<u8>& heightData)
+{
+    if (tileEntry.navMeshOffset > _fileSize || tileEntry.navMeshSize > _fileSize - tileEntry.navMeshOffset ||
+        tileEntry.heightOffset > _fileSize || tileEntry.heightSize > _fileSize - tileEntry.heightOffset)
+    {
+        return false;
+    }
+
+    std::scoped_lock lock(_mutex);
+    if (!_input.is_open())
+        return false;
+
+    navMeshData.resize(tileEntry.navMeshSize);
+    _input.seekg(static_cast<std::streamoff>(tileEntry.navMeshOffset));
+    _input.read(reinterpret_cast<char*>(navMeshData.data()), static_cast<std::streamsize>(navMeshData.size()));
+
+    heightData.resize(tileEntry.heightSize);
+    _input.seekg(static_cast<std::streamoff>(tileEntry.heightOffset));
+    _input.read(reinterpret_cast<char*>(heightData.data()), static_cast<std::streamsize>(heightData.size()));
+
+    if (!_input)
+    {
+        _input.clear();
+        return false;
+    }
+
+    return true;
+}
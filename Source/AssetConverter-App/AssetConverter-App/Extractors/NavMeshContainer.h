@@ -0,0 +1,102 @@
+#pragma once
+
+#include <Base/Types.h>
+
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <vector>
+
+namespace NavMesh::Container
+{
+    // One file per map holding every Detour tile and terrain height tile. Blobs are 16 byte aligned so
+    // a reader can mmap the file and hand the Detour tiles to dtNavMesh::addTile without copying them.
+    // addTile writes the tile's links into the blob, so the mapping has to be writable or private
+    // (copy-on-write), never read-only, and DT_TILE_FREE_DATA must not be set.
+    constexpr u32 MAGIC = 0x4B504E4E; // "NNPK"
+    constexpr u32 VERSION = 2;
+    constexpr const char* FILE_EXTENSION = ".nmpack";
+    constexpr u64 BLOB_ALIGNMENT = 16;
+
+    // Mirrors dtNavMeshParams so it can be passed to dtNavMesh::init as is
+    struct NavMeshParams
+    {
+        f32 origin[3] = { 0.0f, 0.0f, 0.0f };
+        f32 tileWidth = 0.0f;
+        f32 tileHeight = 0.0f;
+        i32 maxTiles = 0;
+        i32 maxPolys = 0;
+    };
+
+    struct Header
+    {
+        u32 magic = MAGIC;
+        u32 version = VERSION;
+        u32 headerSize = sizeof(Header);
+        u32 tileCount = 0;
+        u64 tileTableOffset = 0;
+        NavMeshParams params;
+        u32 reserved = 0;
+    };
+    static_assert(sizeof(Header) == 56);
+
+    // The tile table is sorted by tileID, which is chunkX + chunkY * Terrain::CHUNK_NUM_PER_MAP_STRIDE.
+    // sourceHash identifies everything the tile was built from, see NavMesh::Worker::GetSourceHash.
+    struct TileEntry
+    {
+        u32 tileID = 0;
+        u32 navMeshSize = 0;
+        u32 heightSize = 0;
+        u32 reserved = 0;
+        u64 navMeshOffset = 0;
+        u64 heightOffset = 0;
+        u64 sourceHash = 0;
+    };
+    static_assert(sizeof(TileEntry) == 40);
+
+    // Appends tiles from any thread as they are built, the tile table and header are written by Finish.
+    // Everything goes to a temporary file first so an aborted build never leaves a truncated container.
+    class Writer
+    {
+    public:
+        ~Writer();
+
+        bool Open(const std::filesystem::path& path);
+        bool AddTile(u32 tileID, u64 sourceHash, const std::vector<u8>& navMeshData, const std::vector<u8>& heightData);
+        bool Finish();
+        void Abort();
+
+    private:
+        bool WriteBlob(const std::vector<u8>& data, u64& offset);
+
+    private:
+        std::mutex _mutex;
+        std::ofstream _output;
+        std::filesystem::path _path;
+        std::filesystem::path _temporaryPath;
+        std::vector<TileEntry> _tileEntries;
+        Header _header;
+        u64 _offset = 0;
+        f32 _minHeight = 0.0f;
+        bool _failed = false;
+    };
+
+    // Reads tiles back out of a previous container so unchanged tiles can be carried over, ReadTile is thread safe
+    class Reader
+    {
+    public:
+        bool Open(const std::filesystem::path& path);
+        const TileEntry* FindTile(u32 tileID) const;
+        bool ReadTile(const TileEntry& tileEntry, std::vector<u8>& navMeshData, std::vector<u8>& heightData);
+
+        const NavMeshParams& GetParams() const { return _params; }
+        const std::vector<TileEntry>& GetTileEntries() const { return _tileEntries; }
+
+    private:
+        std::mutex _mutex;
+        std::ifstream _input;
+        u64 _fileSize = 0;
+        NavMeshParams _params;
+        std::vector<TileEntry> _tileEntries;
+    };
+}
@@ -0,0 +1,571 @@
+#include "NavMeshPathGraph.h"
+#include "NavMeshCommon.h"
+
+#include <FileFormat/Shared.h>
+
+#include <Detour/DetourCommon.h>
+#include <Detour/DetourNavMesh.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <utility>
+
+namespace
+{
+    // One polygon's portal on a tile seam, min and max run along the seam
+    struct SeamPortal
+    {
+        u32 polyIndex = 0;
+        f32 min = 0.0f;
+        f32 max = 0.0f;
+        f32 minHeight = 0.0f;
+        f32 maxHeight = 0.0f;
+        f32 seamPosition = 0.0f;
+    };
+
+    // polys holds the polygons touching the entrance on the seam owner's side and on its neighbour's side
+    struct SeamEntrance
+    {
+        f32 position[3] = { 0.0f, 0.0f, 0.0f };
+        f32 width = 0.0f;
+        std::array<std::vector<u32>, 2> polys;
+    };
+
+    // Seam axis 0 is the +X seam of the owner tile, axis 1 its +Z seam
+    struct EntranceKey
+    {
+        u32 ownerTileID = 0;
+        u32 axis = 0;
+        u32 index = 0;
+    };
+
+    struct TilePathGraphEdge
+    {
+        EntranceKey source;
+        EntranceKey target;
+        f32 cost = 0.0f;
+    };
+
+    struct TilePathGraph
+    {
+        std::array<std::vector<NavMesh::PathGraph::Node>, 2> nodes;
+        std::vector<TilePathGraphEdge> edges;
+    };
+
+    u32 GetSeamNeighbourTileID(u32 tileID, u32 axis)
+    {
+        return axis == 0 ? tileID + 1 : tileID + Terrain::CHUNK_NUM_PER_MAP_STRIDE;
+    }
+
+    void CollectSeamPortals(const dtNavMesh& navMesh, const dtMeshTile& tile, const dtMeshTile& neighbourTile, i32 alongAxis, std::vector<SeamPortal>& portals)
+    {
+        constexpr f32 linkScale = 1.0f / 255.0f;
+        const i32 acrossAxis = 2 - alongAxis;
+        portals.clear();
+
+        for (i32 polyIndex = 0; polyIndex < tile.header->polyCount; polyIndex++)
+        {
+            const dtPoly& poly = tile.polys[polyIndex];
+            if ((poly.flags & NavMesh::WALKABLE_POLY_FLAG) == 0)
+                continue;
+
+            for (u32 linkIndex = poly.firstLink; linkIndex != DT_NULL_LINK; linkIndex = tile.links[linkIndex].next)
+            {
+                const dtLink& link = tile.links[linkIndex];
+                if (!link.ref)
+                    continue;
+
+                const dtMeshTile* linkedTile = nullptr;
+                const dtPoly* linkedPoly = nullptr;
+                navMesh.getTileAndPolyByRefUnsafe(link.ref, &linkedTile, &linkedPoly);
+                if (linkedTile != &neighbourTile)
+                    continue;
+
+                // Boundary links only cover the part of the edge the neighbour overlaps
+                const f32* edgeStart = &tile.verts[poly.verts[link.edge] * 3];
+                const f32* edgeEnd = &tile.verts[poly.verts[(link.edge + 1) % poly.vertCount] * 3];
+                f32 start[3];
+                f32 end[3];
+                dtVlerp(start, edgeStart, edgeEnd, static_cast<f32>(link.bmin) * linkScale);
+                dtVlerp(end, edgeStart, edgeEnd, static_cast<f32>(link.bmax) * linkScale);
+                if (start[alongAxis] > end[alongAxis])
+                    std::swap(start, end);
+
+                SeamPortal& portal = portals.emplace_back();
+                portal.polyIndex = static_cast<u32>(polyIndex);
+                portal.min = start[alongAxis];
+                portal.max = end[alongAxis];
+                portal.minHeight = start[1];
+                portal.maxHeight = end[1];
+                portal.seamPosition = start[acrossAxis];
+            }
+        }
+    }
+
+    f32 GetPortalHeight(const SeamPortal& portal, f32 coordinate)
+    {
+        const f32 length = portal.max - portal.min;
+        if (length <= 0.0f)
+            return portal.minHeight;
+
+        const f32 t = std::clamp((coordinate - portal.min) / length, 0.0f, 1.0f);
+        return portal.minHeight + (portal.maxHeight - portal.minHeight) * t;
+    }
+
+    // Groups the portals between the seam owner tile and its +X or +Z neighbour into entrances. The result only
+    // depends on the two tiles, so both derive the same entrances in the same order.
+    void CollectSeamEntrances(const dtNavMesh& navMesh, const dtMeshTile& ownerTile, const dtMeshTile& neighbourTile, u32 axis, std::vector<SeamEntrance>& entrances)
+    {
+        struct SeamRun
+        {
+            f32 min = 0.0f;
+            f32 max = 0.0f;
+            f32 maxHeight = 0.0f;
+        };
+
+        const i32 alongAxis = axis == 0 ? 2 : 0;
+        const f32 walkableClimb = ownerTile.header->walkableClimb;
+        entrances.clear();
+
+        std::vector<SeamPortal> portals;
+        std::vector<SeamPortal> neighbourPortals;
+        CollectSeamPortals(navMesh, ownerTile, neighbourTile, alongAxis, portals);
+        CollectSeamPortals(navMesh, neighbourTile, ownerTile, alongAxis, neighbourPortals);
+        std::sort(portals.begin(), portals.end(), [](const SeamPortal& a, const SeamPortal& b)
+        {
+            return a.min != b.min ? a.min < b.min : (a.minHeight != b.minHeight ? a.minHeight < b.minHeight : a.polyIndex < b.polyIndex);
+        });
+
+        // Portals continuing each other along the seam within a climbable step form one entrance, floors stacked
+        // above each other stay separate
+        std::vector<SeamRun> runs;
+        std::vector<u32> portalRuns(portals.size());
+        for (u32 portalIndex = 0; portalIndex < portals.size(); portalIndex++)
+        {
+            const SeamPortal& portal = portals[portalIndex];
+            u32 runIndex = 0;
+            for (; runIndex < runs.size(); runIndex++)
+            {
+                const SeamRun& run = runs[runIndex];
+                if (portal.min <= run.max + NavMesh::PORTAL_HORIZONTAL_EPSILON && std::abs(portal.minHeight - run.maxHeight) <= walkableClimb)
+                    break;
+            }
+
+            if (runIndex == runs.size())
+                runs.push_back({ portal.min, portal.max, portal.maxHeight });
+
+            SeamRun& run = runs[runIndex];
+            if (portal.max >= run.max)
+            {
+                run.max = portal.max;
+                run.maxHeight = portal.maxHeight;
+            }
+            portalRuns[portalIndex] = runIndex;
+        }
+
+        entrances.resize(runs.size());
+        std::vector<f32> centerDistances(runs.size(), std::numeric_limits<f32>::max());
+        for (u32 portalIndex = 0; portalIndex < portals.size(); portalIndex++)
+        {
+            const SeamPortal& portal = portals[portalIndex];
+            const SeamRun& run = runs[portalRuns[portalIndex]];
+            SeamEntrance& entrance = entrances[portalRuns[portalIndex]];
+            entrance.polys[0].push_back(portal.polyIndex);
+
+            // The entrance sits on the portal closest to the middle of its run
+            const f32 center = (run.min + run.max) * 0.5f;
+            const f32 centerDistance = std::max({ 0.0f, portal.min - center, center - portal.max });
+            if (centerDistance < centerDistances[portalRuns[portalIndex]])
+            {
+                centerDistances[portalRuns[portalIndex]] = centerDistance;
+                entrance.position[alongAxis] = std::clamp(center, portal.min, portal.max);
+                entrance.position[1] = GetPortalHeight(portal, entrance.position[alongAxis]);
+                entrance.position[2 - alongAxis] = portal.seamPosition;
+                entrance.width = run.max - run.min;
+            }
+        }
+
+        for (const SeamPortal& neighbourPortal : neighbourPortals)
+        {
+            const f32 center = (neighbourPortal.min + neighbourPortal.max) * 0.5f;
+            const f32 neighbourHeight = GetPortalHeight(neighbourPortal, center);
+
+            u32 bestPortal = static_cast<u32>(portals.size());
+            f32 bestHeightDifference = walkableClimb * 2.0f;
+            for (u32 portalIndex = 0; portalIndex < portals.size(); portalIndex++)
+            {
+                const SeamPortal& portal = portals[portalIndex];
+                if (portal.max < neighbourPortal.min - NavMesh::PORTAL_HORIZONTAL_EPSILON || portal.min > neighbourPortal.max + NavMesh::PORTAL_HORIZONTAL_EPSILON)
+                    continue;
+
+                const f32 heightDifference = std::abs(GetPortalHeight(portal, center) - neighbourHeight);
+                if (heightDifference <= bestHeightDifference)
+                {
+                    bestPortal = portalIndex;
+                    bestHeightDifference = heightDifference;
+                }
+            }
+
+            if (bestPortal < portals.size())
+                entrances[portalRuns[bestPortal]].polys[1].push_back(neighbourPortal.polyIndex);
+        }
+
+        for (SeamEntrance& entrance : entrances)
+        {
+            for (std::vector<u32>& polys : entrance.polys)
+            {
+                std::sort(polys.begin(), polys.end());
+                polys.erase(std::unique(polys.begin(), polys.end()), polys.end());
+            }
+        }
+    }
+
+    // Finds the entrances on all four seams of a tile and connects them with the shortest paths between their
+    // polygons inside the tile. Path lengths run between polygon centers, which keeps them cheap to derive
+    // while staying close to what findPath will cost at runtime.
+    void BuildTilePathGraph(const dtNavMesh& navMesh, u32 tileID, TilePathGraph& tileGraph)
+    {
+        struct TileSeam
+        {
+            EntranceKey key;
+            u32 side = 0;
+            std::vector<SeamEntrance> entrances;
+        };
+
+        const i32 chunkX = static_cast<i32>(tileID % Terrain::CHUNK_NUM_PER_MAP_STRIDE);
+        const i32 chunkY = static_cast<i32>(tileID / Terrain::CHUNK_NUM_PER_MAP_STRIDE);
+        const dtMeshTile* tile = navMesh.getTileAt(chunkX, chunkY, 0);
+        if (!tile || !tile->header)
+            return;
+
+        // The -X and -Z seams are owned by the neighbours, this tile is their neighbour side
+        const struct
+        {
+            i32 ownerX;
+            i32 ownerY;
+            u32 axis;
+            u32 side;
+        } seams[] =
+        {
+            { chunkX, chunkY, 0, 0 },
+            { chunkX, chunkY, 1, 0 },
+            { chunkX - 1, chunkY, 0, 1 },
+            { chunkX, chunkY - 1, 1, 1 }
+        };
+
+        std::vector<TileSeam> tileSeams;
+        for (const auto& seam : seams)
+        {
+            const i32 neighbourX = seam.ownerX + (seam.axis == 0 ? 1 : 0);
+            const i32 neighbourY = seam.ownerY + (seam.axis == 1 ? 1 : 0);
+            if (seam.ownerX < 0 || seam.ownerY < 0 ||
+                neighbourX >= static_cast<i32>(Terrain::CHUNK_NUM_PER_MAP_STRIDE) ||
+                neighbourY >= static_cast<i32>(Terrain::CHUNK_NUM_PER_MAP_STRIDE))
+            {
+                continue;
+            }
+
+            const dtMeshTile* ownerTile = navMesh.getTileAt(seam.ownerX, seam.ownerY, 0);
+            const dtMeshTile* neighbourTile = navMesh.getTileAt(neighbourX, neighbourY, 0);
+            if (!ownerTile || !neighbourTile)
+                continue;
+
+            TileSeam& tileSeam = tileSeams.emplace_back();
+            tileSeam.key.ownerTileID = static_cast<u32>(seam.ownerX + seam.ownerY * static_cast<i32>(Terrain::CHUNK_NUM_PER_MAP_STRIDE));
+            tileSeam.key.axis = seam.axis;
+            tileSeam.side = seam.side;
+            CollectSeamEntrances(navMesh, *ownerTile, *neighbourTile, seam.axis, tileSeam.entrances);
+
+            if (seam.side != 0)
+                continue;
+
+            std::vector<NavMesh::PathGraph::Node>& nodes = tileGraph.nodes[seam.axis];
+            for (const SeamEntrance& entrance : tileSeam.entrances)
+            {
+                NavMesh::PathGraph::Node& node = nodes.emplace_back();
+                dtVcopy(node.position, entrance.position);
+                node.width = entrance.width;
+                node.tileIDs[0] = tileID;
+                node.tileIDs[1] = GetSeamNeighbourTileID(tileID, seam.axis);
+            }
+        }
+
+        const i32 polyCount = tile->header->polyCount;
+        std::vector<f32> polyCenters(static_cast<size_t>(polyCount) * 3);
+        std::vector<u32> firstNeighbours(static_cast<size_t>(polyCount) + 1, 0);
+        std::vector<u32> neighbours;
+        for (i32 polyIndex = 0; polyIndex < polyCount; polyIndex++)
+        {
+            const dtPoly& poly = tile->polys[polyIndex];
+            NavMesh::GetPolyCenter(*tile, poly, &polyCenters[static_cast<size_t>(polyIndex) * 3]);
+
+            firstNeighbours[polyIndex] = static_cast<u32>(neighbours.size());
+            if ((poly.flags & NavMesh::WALKABLE_POLY_FLAG) == 0)
+                continue;
+
+            for (u32 linkIndex = poly.firstLink; linkIndex != DT_NULL_LINK; linkIndex = tile->links[linkIndex].next)
+            {
+                const dtLink& link = tile->links[linkIndex];
+                const dtMeshTile* linkedTile = nullptr;
+                const dtPoly* linkedPoly = nullptr;
+                if (link.ref)
+                    navMesh.getTileAndPolyByRefUnsafe(link.ref, &linkedTile, &linkedPoly);
+
+                if (linkedTile == tile && (linkedPoly->flags & NavMesh::WALKABLE_POLY_FLAG) != 0)
+                    neighbours.push_back(static_cast<u32>(linkedPoly - tile->polys));
+            }
+        }
+        firstNeighbours[polyCount] = static_cast<u32>(neighbours.size());
+
+        using QueueEntry = std::pair<f32, u32>;
+        std::vector<f32> distances;
+        std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> queue;
+
+        for (const TileSeam& sourceSeam : tileSeams)
+        {
+            for (u32 sourceIndex = 0; sourceIndex < sourceSeam.entrances.size(); sourceIndex++)
+            {
+                const SeamEntrance& source = sourceSeam.entrances[sourceIndex];
+                const std::vector<u32>& sourcePolys = source.polys[sourceSeam.side];
+                if (sourcePolys.empty())
+                    continue;
+
+                distances.assign(polyCount, std::numeric_limits<f32>::max());
+                for (u32 polyIndex : sourcePolys)
+                {
+                    distances[polyIndex] = dtVdist(source.position, &polyCenters[static_cast<size_t>(polyIndex) * 3]);
+                    queue.push({ distances[polyIndex], polyIndex });
+                }
+
+                while (!queue.empty())
+                {
+                    const auto [distance, polyIndex] = queue.top();
+                    queue.pop();
+                    if (distance > distances[polyIndex])
+                        continue;
+
+                    const f32* center = &polyCenters[static_cast<size_t>(polyIndex) * 3];
+                    for (u32 neighbourIndex = firstNeighbours[polyIndex]; neighbourIndex < firstNeighbours[polyIndex + 1]; neighbourIndex++)
+                    {
+                        const u32 neighbour = neighbours[neighbourIndex];
+                        const f32 neighbourDistance = distance + dtVdist(center, &polyCenters[static_cast<size_t>(neighbour) * 3]);
+                        if (neighbourDistance >= distances[neighbour])
+                            continue;
+
+                        distances[neighbour] = neighbourDistance;
+                        queue.push({ neighbourDistance, neighbour });
+                    }
+                }
+
+                for (const TileSeam& targetSeam : tileSeams)
+                {
+                    for (u32 targetIndex = 0; targetIndex < targetSeam.entrances.size(); targetIndex++)
+                    {
+                        if (&targetSeam == &sourceSeam && targetIndex == sourceIndex)
+                            continue;
+
+                        const SeamEntrance& target = targetSeam.entrances[targetIndex];
+                        f32 cost = std::numeric_limits<f32>::max();
+                        for (u32 polyIndex : target.polys[targetSeam.side])
+                        {
+                            if (distances[polyIndex] == std::numeric_limits<f32>::max())
+                                continue;
+
+                            cost = std::min(cost, distances[polyIndex] + dtVdist(&polyCenters[static_cast<size_t>(polyIndex) * 3], target.position));
+                        }
+
+                        if (cost == std::numeric_limits<f32>::max())
+                            continue;
+
+                        EntranceKey sourceKey = sourceSeam.key;
+                        sourceKey.index = sourceIndex;
+                        EntranceKey targetKey = targetSeam.key;
+                        targetKey.index = targetIndex;
+                        tileGraph.edges.push_back({ sourceKey, targetKey, cost });
+                    }
+                }
+            }
+        }
+    }
+
+    template <typename T>
+    void WriteTable(std::ofstream& output, const std::vector<T>& table)
+    {
+        if (!table.empty())
+            output.write(reinterpret_cast<const char*>(table.data()), static_cast<std::streamsize>(table.size() * sizeof(T)));
+    }
+}
+
+struct NavMesh::PathGraph::Builder::Impl
+{
+    Impl(const dtNavMesh& navMesh)
+        : navMesh(navMesh)
+    {
+    }
+
+    const dtNavMesh& navMesh;
+
+    // Indexed like tileIDs, which lists the loaded tiles by tileID
+    std::vector<u32> tileIDs;
+    std::vector<TilePathGraph> tileGraphs;
+};
+
+NavMesh::PathGraph::Builder::Builder(const dtNavMesh& navMesh)
+    : _impl(std::make_unique<Impl>(navMesh))
+{
+    for (u32 tileID = 0; tileID < Terrain::CHUNK_NUM_PER_MAP; tileID++)
+    {
+        const i32 chunkX = static_cast<i32>(tileID % Terrain::CHUNK_NUM_PER_MAP_STRIDE);
+        const i32 chunkY = static_cast<i32>(tileID / Terrain::CHUNK_NUM_PER_MAP_STRIDE);
+        const dtMeshTile* tile = navMesh.getTileAt(chunkX, chunkY, 0);
+        if (tile && tile->header)
+            _impl->tileIDs.push_back(tileID);
+    }
+
+    _impl->tileGraphs.resize(_impl->tileIDs.size());
+}
+
+NavMesh::PathGraph::Builder::~Builder() = default;
+
+u32 NavMesh::PathGraph::Builder::GetNumTiles() const
+{
+    return static_cast<u32>(_impl->tileIDs.size());
+}
+
+void NavMesh::PathGraph::Builder::BuildTiles(u32 firstTile, u32 endTile)
+{
+    endTile = std::min(endTile, static_cast<u32>(_impl->tileIDs.size()));
+    for (u32 tileIndex = firstTile; tileIndex < endTile; tileIndex++)
+    {
+        BuildTilePathGraph(_impl->navMesh, _impl->tileIDs[tileIndex], _impl->tileGraphs[tileIndex]);
+    }
+}
+
+void NavMesh::PathGraph::Builder::GetGraph(Graph& graph) const
+{
+    constexpr u32 numSeams = Terrain::CHUNK_NUM_PER_MAP * 2;
+    graph = Graph();
+
+    // Every seam's entrances become consecutive nodes, ordered by owner tile and axis
+    std::vector<u32> seamFirstNodes(numSeams, 0);
+    std::vector<u32> seamNodeCounts(numSeams, 0);
+    for (u32 tileIndex = 0; tileIndex < _impl->tileIDs.size(); tileIndex++)
+    {
+        const u32 tileID = _impl->tileIDs[tileIndex];
+        for (u32 axis = 0; axis < 2; axis++)
+        {
+            const std::vector<Node>& nodes = _impl->tileGraphs[tileIndex].nodes[axis];
+            seamFirstNodes[tileID * 2 + axis] = static_cast<u32>(graph.nodes.size());
+            seamNodeCounts[tileID * 2 + axis] = static_cast<u32>(nodes.size());
+            graph.nodes.insert(graph.nodes.end(), nodes.begin(), nodes.end());
+        }
+    }
+
+    auto getNodeID = [&seamFirstNodes](const EntranceKey& key)
+    {
+        return seamFirstNodes[key.ownerTileID * 2 + key.axis] + key.index;
+    };
+
+    std::vector<std::pair<u32, Edge>> edges;
+    for (u32 tileIndex = 0; tileIndex < _impl->tileIDs.size(); tileIndex++)
+    {
+        for (const TilePathGraphEdge& tileEdge : _impl->tileGraphs[tileIndex].edges)
+        {
+            Edge edge;
+            edge.targetNode = getNodeID(tileEdge.target);
+            edge.tileID = _impl->tileIDs[tileIndex];
+            edge.cost = tileEdge.cost;
+            edges.push_back({ getNodeID(tileEdge.source), edge });
+        }
+    }
+
+    std::stable_sort(edges.begin(), edges.end(), [](const std::pair<u32, Edge>& a, const std::pair<u32, Edge>& b)
+    {
+        return a.first < b.first;
+    });
+
+    graph.edges.reserve(edges.size());
+    for (const auto& [sourceNode, edge] : edges)
+    {
+        Node& node = graph.nodes[sourceNode];
+        if (node.edgeCount == 0)
+            node.firstEdge = static_cast<u32>(graph.edges.size());
+
+        node.edgeCount++;
+        graph.edges.push_back(edge);
+    }
+
+    for (u32 tileID : _impl->tileIDs)
+    {
+        const u32 chunkX = tileID % Terrain::CHUNK_NUM_PER_MAP_STRIDE;
+        const u32 chunkY = tileID / Terrain::CHUNK_NUM_PER_MAP_STRIDE;
+
+        TileEntry& tileEntry = graph.tiles.emplace_back();
+        tileEntry.tileID = tileID;
+        tileEntry.firstNode = static_cast<u32>(graph.tileNodes.size());
+
+        std::array<u32, 4> tileSeams = { tileID * 2, tileID * 2 + 1, numSeams, numSeams };
+        if (chunkX > 0)
+            tileSeams[2] = (tileID - 1) * 2;
+
+        if (chunkY > 0)
+            tileSeams[3] = (tileID - Terrain::CHUNK_NUM_PER_MAP_STRIDE) * 2 + 1;
+
+        for (u32 seam : tileSeams)
+        {
+            if (seam >= numSeams)
+                continue;
+
+            for (u32 nodeIndex = 0; nodeIndex < seamNodeCounts[seam]; nodeIndex++)
+            {
+                graph.tileNodes.push_back(seamFirstNodes[seam] + nodeIndex);
+            }
+        }
+
+        tileEntry.nodeCount = static_cast<u32>(graph.tileNodes.size()) - tileEntry.firstNode;
+    }
+}
+
+bool NavMesh::PathGraph::WriteFile(const std::filesystem::path& path, const Graph& graph)
+{
+    if (graph.nodes.size() > std::numeric_limits<u32>::max() ||
+        graph.edges.size() > std::numeric_limits<u32>::max() ||
+        graph.tiles.size() > std::numeric_limits<u32>::max() ||
+        graph.tileNodes.size() > std::numeric_limits<u32>::max())
+    {
+        return false;
+    }
+
+    NavMesh::PathGraph::Header header;
+    header.nodeCount = static_cast<u32>(graph.nodes.size());
+    header.edgeCount = static_cast<u32>(graph.edges.size());
+    header.tileCount = static_cast<u32>(graph.tiles.size());
+    header.tileNodeCount = static_cast<u32>(graph.tileNodes.size());
+
+    std::ofstream output(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (output)
+    {
+        output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        WriteTable(output, graph.nodes);
+        WriteTable(output, graph.edges);
+        WriteTable(output, graph.tiles);
+        WriteTable(output, graph.tileNodes);
+        output.flush();
+    }
+
+    const bool written = output.good();
+    output.close();
+
+    if (!written)
+    {
+        std::error_code error;
+        std::filesystem::remove(path, error);
+    }
+
+    return written;
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <Base/Types.h>
+
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+class dtNavMesh;
+
+namespace NavMesh::PathGraph
+{
+    // HPA* style abstract graph of one map. Every node is an entrance, a run of connected portals on the seam
+    // between two tiles, and every edge is the shortest path between two entrances through the tile they share.
+    // A long route is planned on the graph first and only refined with findPath within the tiles it crosses.
+    constexpr u32 MAGIC = 0x47504E4E; // "NNPG"
+    constexpr u32 VERSION = 1;
+    constexpr const char* FILE_EXTENSION = ".nmgraph";
+
+    // Followed by the node, edge and tile tables and the tile node list, in that order
+    struct Header
+    {
+        u32 magic = MAGIC;
+        u32 version = VERSION;
+        u32 headerSize = sizeof(Header);
+        u32 nodeCount = 0;
+        u32 edgeCount = 0;
+        u32 tileCount = 0;
+        u32 tileNodeCount = 0;
+        u32 reserved = 0;
+    };
+    static_assert(sizeof(Header) == 32);
+
+    // position is the middle of the entrance on the seam in NavMesh space, tileIDs are the two tiles it joins.
+    // The node's edges are edgeCount consecutive entries starting at firstEdge.
+    struct Node
+    {
+        f32 position[3] = { 0.0f, 0.0f, 0.0f };
+        f32 width = 0.0f;
+        u32 tileIDs[2] = { 0, 0 };
+        u32 firstEdge = 0;
+        u32 edgeCount = 0;
+    };
+    static_assert(sizeof(Node) == 32);
+
+    // cost is the path length from the source node to targetNode through tileID
+    struct Edge
+    {
+        u32 targetNode = 0;
+        u32 tileID = 0;
+        f32 cost = 0.0f;
+    };
+    static_assert(sizeof(Edge) == 12);
+
+    // The entrances on the border of a tile are nodeCount consecutive node IDs in the tile node list, a route
+    // starts and ends by connecting its endpoints to them. Sorted by tileID.
+    struct TileEntry
+    {
+        u32 tileID = 0;
+        u32 firstNode = 0;
+        u32 nodeCount = 0;
+        u32 reserved = 0;
+    };
+    static_assert(sizeof(TileEntry) == 16);
+
+    struct Graph
+    {
+        std::vector<Node> nodes;
+        std::vector<Edge> edges;
+        std::vector<TileEntry> tiles;
+        std::vector<u32> tileNodes;
+    };
+
+    // Builds the graph of one map from the linked dtNavMesh holding all of its tiles, the dtNavMesh is only read
+    // and must outlive the builder. BuildTiles can be called from any number of threads at once for distinct
+    // tiles, GetGraph only once every tile has been built.
+    class Builder
+    {
+    public:
+        explicit Builder(const dtNavMesh& navMesh);
+        ~Builder();
+
+        Builder(const Builder&) = delete;
+        Builder& operator=(const Builder&) = delete;
+
+        u32 GetNumTiles() const;
+        void BuildTiles(u32 firstTile, u32 endTile);
+        void GetGraph(Graph& graph) const;
+
+    private:
+        struct Impl;
+        std::unique_ptr<Impl> _impl;
+    };
+
+    bool WriteFile(const std::filesystem::path& path, const Graph& graph);
+}
@@ -0,0 +1,227 @@
+#include "NavMeshTileCache.h"
+
+#include <Detour/DetourNavMesh.h>
+#include <Detour/DetourStatus.h>
+#include <DetourTileCache/DetourTileCache.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+namespace
+{
+    static_assert(sizeof(NavMesh::TileCache::Params) == sizeof(dtTileCacheParams));
+    static_assert(sizeof(dtPolyRef) == sizeof(u64), "maxPolys assumes 64-bit Detour polygon references");
+
+    constexpr i32 MAX_LITERAL_RUN = 128;
+    constexpr i32 MIN_REPEAT_RUN = 3;
+    constexpr i32 REPEAT_BIAS = 125;
+    constexpr i32 MAX_REPEAT_RUN = 255 - REPEAT_BIAS;
+
+    u64 AlignOffset(u64 offset)
+    {
+        return (offset + (NavMesh::TileCache::BLOB_ALIGNMENT - 1)) & ~(NavMesh::TileCache::BLOB_ALIGNMENT - 1);
+    }
+
+    bool WriteFile(const std::filesystem::path& path, const void* data, size_t size)
+    {
+        std::ofstream output(path, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (output)
+        {
+            output.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+            output.flush();
+        }
+
+        const bool written = output.good();
+        output.close();
+
+        if (!written)
+        {
+            std::error_code error;
+            std::filesystem::remove(path, error);
+        }
+
+        return written;
+    }
+}
+
+int NavMesh::TileCache::RunLengthCompressor::maxCompressedSize(const int bufferSize)
+{
+    // Literals cost one control byte per run, every repeated run saves at least the one of the literals after it
+    return bufferSize + (bufferSize / MAX_LITERAL_RUN) + 2;
+}
+
+dtStatus NavMesh::TileCache::RunLengthCompressor::compress(const unsigned char* buffer, const int bufferSize, unsigned char* compressed, const int maxCompressedSize, int* compressedSize)
+{
+    if ((!buffer && bufferSize > 0) || !compressed || !compressedSize || bufferSize < 0)
+        return DT_FAILURE | DT_INVALID_PARAM;
+
+    i32 outputSize = 0;
+    i32 literalStart = 0;
+    auto writeLiterals = [&](i32 literalEnd)
+    {
+        while (literalStart < literalEnd)
+        {
+            const i32 numLiterals = std::min(literalEnd - literalStart, MAX_LITERAL_RUN);
+            if (outputSize + 1 + numLiterals > maxCompressedSize)
+                return false;
+
+            compressed[outputSize++] = static_cast<u8>(numLiterals - 1);
+            std::memcpy(compressed + outputSize, buffer + literalStart, numLiterals);
+            outputSize += numLiterals;
+            literalStart += numLiterals;
+        }
+
+        return true;
+    };
+
+    i32 position = 0;
+    while (position < bufferSize)
+    {
+        i32 runLength = 1;
+        while (position + runLength < bufferSize && runLength < MAX_REPEAT_RUN && buffer[position + runLength] == buffer[position])
+        {
+            runLength++;
+        }
+
+        if (runLength < MIN_REPEAT_RUN)
+        {
+            position += runLength;
+            continue;
+        }
+
+        if (!writeLiterals(position) || outputSize + 2 > maxCompressedSize)
+            return DT_FAILURE | DT_BUFFER_TOO_SMALL;
+
+        compressed[outputSize++] = static_cast<u8>(runLength + REPEAT_BIAS);
+        compressed[outputSize++] = buffer[position];
+        position += runLength;
+        literalStart = position;
+    }
+
+    if (!writeLiterals(bufferSize))
+        return DT_FAILURE | DT_BUFFER_TOO_SMALL;
+
+    *compressedSize = outputSize;
+    return DT_SUCCESS;
+}
+
+dtStatus NavMesh::TileCache::RunLengthCompressor::decompress(const unsigned char* compressed, const int compressedSize, unsigned char* buffer, const int maxBufferSize, int* bufferSize)
+{
+    if ((!compressed && compressedSize > 0) || !bufferSize)
+        return DT_FAILURE | DT_INVALID_PARAM;
+
+    i32 inputPosition = 0;
+    i32 outputSize = 0;
+    while (inputPosition < compressedSize)
+    {
+        const u8 control = compressed[inputPosition++];
+        if (control < MAX_LITERAL_RUN)
+        {
+            const i32 numLiterals = control + 1;
+            if (inputPosition + numLiterals > compressedSize)
+                return DT_FAILURE | DT_INVALID_PARAM;
+
+            if (outputSize + numLiterals > maxBufferSize)
+                return DT_FAILURE | DT_BUFFER_TOO_SMALL;
+
+            std::memcpy(buffer + outputSize, compressed + inputPosition, numLiterals);
+            inputPosition += numLiterals;
+            outputSize += numLiterals;
+            continue;
+        }
+
+        const i32 runLength = control - REPEAT_BIAS;
+        if (inputPosition >= compressedSize)
+            return DT_FAILURE | DT_INVALID_PARAM;
+
+        if (outputSize + runLength > maxBufferSize)
+            return DT_FAILURE | DT_BUFFER_TOO_SMALL;
+
+        std::memset(buffer + outputSize, compressed[inputPosition++], runLength);
+        outputSize += runLength;
+    }
+
+    *bufferSize = outputSize;
+    return DT_SUCCESS;
+}
+
+bool NavMesh::TileCache::CreateLayersData(u32 chunkX, u32 chunkY, const std::vector<std::vector<u8>>& layers, std::vector<u8>& layersData)
+{
+    if (layers.size() > std::numeric_limits<u32>::max())
+        return false;
+
+    std::vector<NavMesh::TileCache::LayerEntry> layerEntries(layers.size());
+    u64 offset = sizeof(NavMesh::TileCache::LayersHeader) + layers.size() * sizeof(NavMesh::TileCache::LayerEntry);
+    for (size_t layerIndex = 0; layerIndex < layers.size(); layerIndex++)
+    {
+        offset = AlignOffset(offset);
+        if (offset + layers[layerIndex].size() > std::numeric_limits<u32>::max())
+            return false;
+
+        layerEntries[layerIndex].offset = static_cast<u32>(offset);
+        layerEntries[layerIndex].size = static_cast<u32>(layers[layerIndex].size());
+        offset += layers[layerIndex].size();
+    }
+
+    NavMesh::TileCache::LayersHeader header;
+    header.layerCount = static_cast<u32>(layers.size());
+    header.chunkX = chunkX;
+    header.chunkY = chunkY;
+
+    layersData.assign(offset, 0);
+    std::memcpy(layersData.data(), &header, sizeof(header));
+    if (!layerEntries.empty())
+        std::memcpy(layersData.data() + sizeof(header), layerEntries.data(), layerEntries.size() * sizeof(NavMesh::TileCache::LayerEntry));
+
+    for (size_t layerIndex = 0; layerIndex < layers.size(); layerIndex++)
+    {
+        if (!layers[layerIndex].empty())
+            std::memcpy(layersData.data() + layerEntries[layerIndex].offset, layers[layerIndex].data(), layers[layerIndex].size());
+    }
+
+    return true;
+}
+
+bool NavMesh::TileCache::ReadLayersHeader(const std::filesystem::path& path, LayersHeader& header)
+{
+    std::ifstream input(path, std::ios::in | std::ios::binary);
+    if (!input)
+        return false;
+
+    input.read(reinterpret_cast<char*>(&header), sizeof(header));
+    return input.good() &&
+        header.magic == LAYERS_MAGIC &&
+        header.version == VERSION &&
+        header.headerSize == sizeof(LayersHeader);
+}
+
+bool NavMesh::TileCache::WriteLayersFile(const std::filesystem::path& path, const std::vector<u8>& layersData)
+{
+    if (layersData.size() < sizeof(LayersHeader))
+        return false;
+
+    return WriteFile(path, layersData.data(), layersData.size());
+}
+
+bool NavMesh::TileCache::WriteParamsFile(const std::filesystem::path& path, const Params& params)
+{
+    if (params.width <= 0 || params.height <= 0 || params.maxTiles <= 0)
+        return false;
+
+    NavMesh::TileCache::ParamsHeader header;
+    header.tileCacheParams = params;
+
+    Container::NavMeshParams& navMeshParams = header.navMeshParams;
+    std::memcpy(navMeshParams.origin, params.origin, sizeof(navMeshParams.origin));
+    navMeshParams.tileWidth = static_cast<f32>(params.width) * params.cellSize;
+    navMeshParams.tileHeight = static_cast<f32>(params.height) * params.cellSize;
+    navMeshParams.maxTiles = params.maxTiles;
+
+    // The tiles are rebuilt from the layers at runtime so their polygon counts aren't known yet. 64-bit polygon
+    // references give the polygon index its own DT_POLY_BITS, independent of how many bits maxTiles takes.
+    navMeshParams.maxPolys = 1 << DT_POLY_BITS;
+
+    return WriteFile(path, &header, sizeof(header));
+}
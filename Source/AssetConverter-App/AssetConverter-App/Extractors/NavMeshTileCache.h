@@ -0,0 +1,91 @@
+#pragma once
+
+#include "NavMeshContainer.h"
+
+#include <Base/Types.h>
+
+#include <DetourTileCache/DetourTileCacheBuilder.h>
+
+#include <filesystem>
+#include <vector>
+
+namespace NavMesh::TileCache
+{
+    // Compressed dtTileCacheLayer data for carving temporary obstacles at runtime. dtTileCacheLayerHeader stores
+    // layer sizes in a byte, so every NavMesh tile is split into a grid of smaller TileCache tiles.
+    constexpr u32 TILES_PER_CHUNK_STRIDE = 10;
+
+    constexpr u32 PARAMS_MAGIC = 0x50434E4E; // "NNCP"
+    constexpr u32 LAYERS_MAGIC = 0x4C434E4E; // "NNCL"
+    constexpr u32 VERSION = 1;
+    constexpr const char* PARAMS_FILE_EXTENSION = ".nmcache";
+    constexpr const char* LAYERS_FILE_EXTENSION = ".nmlayers";
+    constexpr u64 BLOB_ALIGNMENT = 16;
+
+    // Mirrors dtTileCacheParams so it can be passed to dtTileCache::init as is
+    struct Params
+    {
+        f32 origin[3] = { 0.0f, 0.0f, 0.0f };
+        f32 cellSize = 0.0f;
+        f32 cellHeight = 0.0f;
+        i32 width = 0;
+        i32 height = 0;
+        f32 walkableHeight = 0.0f;
+        f32 walkableRadius = 0.0f;
+        f32 walkableClimb = 0.0f;
+        f32 maxSimplificationError = 0.0f;
+        i32 maxTiles = 0;
+        i32 maxObstacles = 0;
+    };
+
+    // One per map and agent, navMeshParams initializes the dtNavMesh the dtTileCache builds its tiles into
+    struct ParamsHeader
+    {
+        u32 magic = PARAMS_MAGIC;
+        u32 version = VERSION;
+        u32 headerSize = sizeof(ParamsHeader);
+        u32 tilesPerChunkStride = TILES_PER_CHUNK_STRIDE;
+        Params tileCacheParams;
+        Container::NavMeshParams navMeshParams;
+    };
+    static_assert(sizeof(ParamsHeader) == 96);
+
+    // One per NavMesh tile, followed by layerCount entries. Every layer is a complete compressed tile as
+    // dtTileCache::addTile expects it, stored 16 byte aligned.
+    struct LayersHeader
+    {
+        u32 magic = LAYERS_MAGIC;
+        u32 version = VERSION;
+        u32 headerSize = sizeof(LayersHeader);
+        u32 layerCount = 0;
+        u32 chunkX = 0;
+        u32 chunkY = 0;
+        u32 reserved[2] = { 0, 0 };
+    };
+    static_assert(sizeof(LayersHeader) == 32);
+
+    struct LayerEntry
+    {
+        u32 offset = 0;
+        u32 size = 0;
+    };
+    static_assert(sizeof(LayerEntry) == 8);
+
+    // Byte oriented run length coding, the layer grids are mostly long runs of equal heights and areas. A control
+    // byte below 128 is followed by that many plus one literal bytes, any other control byte repeats the next
+    // byte (control - 125) times. The server has to decompress with the same scheme.
+    class RunLengthCompressor final : public dtTileCacheCompressor
+    {
+    public:
+        int maxCompressedSize(const int bufferSize) override;
+        dtStatus compress(const unsigned char* buffer, const int bufferSize, unsigned char* compressed, const int maxCompressedSize, int* compressedSize) override;
+        dtStatus decompress(const unsigned char* compressed, const int compressedSize, unsigned char* buffer, const int maxBufferSize, int* bufferSize) override;
+    };
+
+    bool CreateLayersData(u32 chunkX, u32 chunkY, const std::vector<std::vector<u8>>& layers, std::vector<u8>& layersData);
+    bool ReadLayersHeader(const std::filesystem::path& path, LayersHeader& header);
+    bool WriteLayersFile(const std::filesystem::path& path, const std::vector<u8>& layersData);
+
+    // Derives the matching dtNavMeshParams from params before writing both
+    bool WriteParamsFile(const std::filesystem::path& path, const Params& params);
+}
@@ -1,4 +1,5 @@
 #include "NavMeshValidator.h"
+#include "NavMeshCommon.h"
 
 #include <FileFormat/Novus/NavMesh/NavMesh.h>
 
@@ -6,13 +7,13 @@
 
 #include <FileFormat/Shared.h>
 
+#include <Detour/DetourCommon.h>
 #include <Detour/DetourNavMesh.h>
 #include <Detour/DetourNavMeshQuery.h>
 
 #include <algorithm>
 #include <array>
 #include <cmath>
-#include <fstream>
 #include <limits>
 #include <memory>
 #include <utility>
@@ -22,18 +23,7 @@ namespace
     static_assert(NavMesh::USE_64BIT_POLY_REFS);
     static_assert(sizeof(dtPolyRef) == sizeof(u64), "AssetConverter requires 64-bit Detour polygon references");
 
-    constexpr f32 PORTAL_HORIZONTAL_EPSILON = 0.01f;
-    constexpr u16 WALKABLE_POLY_FLAG = 0x1;
     constexpr u32 MAX_DETAILED_FAILURES = 16;
-    struct TileData
-    {
-        std::vector<u8> bytes;
-
-        dtMeshHeader* GetHeader()
-        {
-            return reinterpret_cast<dtMeshHeader*>(bytes.data());
-        }
-    };
 
     struct PortalEdge
     {
@@ -52,39 +42,37 @@ namespace
         }
     };
 
-    enum class PairValidationResult
+    enum class PairValidationResult : u8
     {
         Valid,
         NotTraversable,
         Failed
     };
 
-    std::filesystem::path GetTilePath(const std::filesystem::path& outputDirectory, const std::string& mapName, u32 chunkX, u32 chunkY)
+    struct TilePair
     {
-        return outputDirectory / (mapName + "_" + std::to_string(chunkX) + "_" + std::to_string(chunkY) + NavMesh::TILE_FILE_EXTENSION);
+        u32 sourceTileID = 0;
+        u32 targetTileID = 0;
+        i32 sourceSide = 0;
+        i32 targetSide = 0;
+    };
+
+    const dtMeshHeader* GetTileHeader(const NavMesh::TileData& tileData)
+    {
+        return reinterpret_cast<const dtMeshHeader*>(tileData.bytes.data());
     }
 
-    bool LoadTile(const std::filesystem::path& path, u32 expectedChunkX, u32 expectedChunkY, TileData& tileData)
+    bool IsValidTile(const NavMesh::TileData& tileData)
     {
-        std::error_code error;
-        const uintmax_t fileSize = std::filesystem::file_size(path, error);
-        if (error ||
-            fileSize < sizeof(dtMeshHeader) ||
-            fileSize > static_cast<uintmax_t>(std::numeric_limits<i32>::max()))
+        if (tileData.bytes.size() < sizeof(dtMeshHeader) ||
+            tileData.bytes.size() > static_cast<size_t>(std::numeric_limits<i32>::max()))
         {
             return false;
         }
 
-        std::ifstream input(path, std::ios::in | std::ios::binary);
-        if (!input)
-            return false;
-
-        tileData.bytes.resize(static_cast<size_t>(fileSize));
-        input.read(reinterpret_cast<char*>(tileData.bytes.data()), static_cast<std::streamsize>(tileData.bytes.size()));
-        if (!input)
-            return false;
-
-        const dtMeshHeader* header = tileData.GetHeader();
+        const u32 expectedChunkX = tileData.tileID % Terrain::CHUNK_NUM_PER_MAP_STRIDE;
+        const u32 expectedChunkY = tileData.tileID / Terrain::CHUNK_NUM_PER_MAP_STRIDE;
+        const dtMeshHeader* header = GetTileHeader(tileData);
         return header->magic == DT_NAVMESH_MAGIC &&
             header->version == DT_NAVMESH_VERSION &&
             header->x == static_cast<i32>(expectedChunkX) &&
@@ -122,8 +110,8 @@ namespace
 
     bool SlabsOverlap(const f32* firstMin, const f32* firstMax, const f32* secondMin, const f32* secondMax, f32 walkableClimb)
     {
-        const f32 overlapMin = std::max(firstMin[0] + PORTAL_HORIZONTAL_EPSILON, secondMin[0] + PORTAL_HORIZONTAL_EPSILON);
-        const f32 overlapMax = std::min(firstMax[0] - PORTAL_HORIZONTAL_EPSILON, secondMax[0] - PORTAL_HORIZONTAL_EPSILON);
+        const f32 overlapMin = std::max(firstMin[0] + NavMesh::PORTAL_HORIZONTAL_EPSILON, secondMin[0] + NavMesh::PORTAL_HORIZONTAL_EPSILON);
+        const f32 overlapMax = std::min(firstMax[0] - NavMesh::PORTAL_HORIZONTAL_EPSILON, secondMax[0] - NavMesh::PORTAL_HORIZONTAL_EPSILON);
         if (overlapMin > overlapMax)
             return false;
 
@@ -182,7 +170,7 @@ namespace
 
             for (const PortalEdge& targetEdge : targetEdges)
             {
-                if (std::abs(sourcePosition - GetSlabCoordinate(targetEdge.start, targetSide)) > PORTAL_HORIZONTAL_EPSILON)
+                if (std::abs(sourcePosition - GetSlabCoordinate(targetEdge.start, targetSide)) > NavMesh::PORTAL_HORIZONTAL_EPSILON)
                     continue;
 
                 f32 targetMin[2];
@@ -227,22 +215,7 @@ namespace
         if (dtStatusFailed(navMesh.getTileAndPolyByRef(polyRef, &tile, &poly)) || !tile || !poly || poly->vertCount == 0)
             return false;
 
-        center[0] = 0.0f;
-        center[1] = 0.0f;
-        center[2] = 0.0f;
-
-        for (u32 vertexIndex = 0; vertexIndex < poly->vertCount; vertexIndex++)
-        {
-            const f32* vertex = &tile->verts[poly->verts[vertexIndex] * 3];
-            center[0] += vertex[0];
-            center[1] += vertex[1];
-            center[2] += vertex[2];
-        }
-
-        const f32 inverseVertexCount = 1.0f / static_cast<f32>(poly->vertCount);
-        center[0] *= inverseVertexCount;
-        center[1] *= inverseVertexCount;
-        center[2] *= inverseVertexCount;
+        NavMesh::GetPolyCenter(*tile, *poly, center);
         return true;
     }
 
@@ -286,48 +259,65 @@ namespace
 
         return result;
     }
+
 }
 
-NavMesh::SeamValidationResult NavMesh::ValidateSeams(const std::filesystem::path& outputDirectory, const std::string& mapName, const std::vector<u32>& tileIDs)
+struct NavMesh::SeamValidator::Impl
 {
-    std::array<bool, Terrain::CHUNK_NUM_PER_MAP> availableTiles{};
-    for (u32 tileID : tileIDs)
-    {
-        if (tileID < availableTiles.size())
-            availableTiles[tileID] = true;
-    }
+    std::string mapName;
 
-    SeamValidationResult result;
-    std::array<std::unique_ptr<TileData>, Terrain::CHUNK_NUM_PER_MAP> tileData;
+    // Declared before the dtNavMesh that links into them so they outlive it
+    std::vector<TileData> tiles;
+    std::unique_ptr<dtNavMesh, decltype(&dtFreeNavMesh)> navMesh{ nullptr, &dtFreeNavMesh };
     std::array<bool, Terrain::CHUNK_NUM_PER_MAP> loadedTiles{};
+    dtQueryFilter filter;
+
+    // Queries keep per search state, so each thread gets its own against the shared dtNavMesh
+    std::vector<std::unique_ptr<dtNavMeshQuery, decltype(&dtFreeNavMeshQuery)>> queries;
+
+    std::vector<TilePair> pairs;
+    std::vector<PairValidationResult> pairResults;
+};
+
+NavMesh::SeamValidator::SeamValidator(const std::string& mapName, std::vector<TileData>&& tiles, u32 numThreads)
+    : _impl(std::make_unique<Impl>())
+{
+    _impl->mapName = mapName;
+    _impl->tiles = std::move(tiles);
+    std::sort(_impl->tiles.begin(), _impl->tiles.end(), [](const TileData& a, const TileData& b)
+    {
+        return a.tileID < b.tileID;
+    });
+
+    std::array<bool, Terrain::CHUNK_NUM_PER_MAP> availableTiles{};
+    std::vector<TileData*> validTiles;
+    validTiles.reserve(_impl->tiles.size());
     f32 minimumHeight = std::numeric_limits<f32>::max();
     i32 maximumPolys = 0;
-    i32 loadedTileCount = 0;
 
-    for (u32 tileID = 0; tileID < availableTiles.size(); tileID++)
+    for (TileData& tileData : _impl->tiles)
     {
-        if (!availableTiles[tileID])
+        if (tileData.tileID >= availableTiles.size())
             continue;
 
-        const u32 chunkX = tileID % Terrain::CHUNK_NUM_PER_MAP_STRIDE;
-        const u32 chunkY = tileID / Terrain::CHUNK_NUM_PER_MAP_STRIDE;
-        std::unique_ptr<TileData> data = std::make_unique<TileData>();
-        if (!LoadTile(GetTilePath(outputDirectory, mapName, chunkX, chunkY), chunkX, chunkY, *data))
+        availableTiles[tileData.tileID] = true;
+        if (!IsValidTile(tileData))
         {
-            NC_LOG_ERROR("[NavMesh Validator] Failed to load NavMesh tile ({}_{}_{})", mapName, chunkX, chunkY);
+            const u32 chunkX = tileData.tileID % Terrain::CHUNK_NUM_PER_MAP_STRIDE;
+            const u32 chunkY = tileData.tileID / Terrain::CHUNK_NUM_PER_MAP_STRIDE;
+            NC_LOG_ERROR("[NavMesh Validator] Invalid NavMesh tile data ({}_{}_{})", mapName, chunkX, chunkY);
             continue;
         }
 
-        const dtMeshHeader* header = data->GetHeader();
+        const dtMeshHeader* header = GetTileHeader(tileData);
         minimumHeight = std::min(minimumHeight, header->bmin[1]);
         maximumPolys = std::max(maximumPolys, header->polyCount);
-        tileData[tileID] = std::move(data);
-        loadedTileCount++;
+        validTiles.push_back(&tileData);
     }
 
-    std::unique_ptr<dtNavMesh, decltype(&dtFreeNavMesh)> navMesh(dtAllocNavMesh(), &dtFreeNavMesh);
+    _impl->navMesh.reset(dtAllocNavMesh());
     bool navMeshReady = false;
-    if (navMesh && loadedTileCount > 0)
+    if (_impl->navMesh && !validTiles.empty())
     {
         dtNavMeshParams params{};
         params.orig[0] = -Terrain::MAP_HALF_SIZE;
@@ -335,36 +325,38 @@ NavMesh::SeamValidationResult NavMesh::ValidateSeams(const std::filesystem::path
         params.orig[2] = -Terrain::MAP_HALF_SIZE;
         params.tileWidth = Terrain::CHUNK_SIZE;
         params.tileHeight = Terrain::CHUNK_SIZE;
-        params.maxTiles = loadedTileCount;
+        params.maxTiles = static_cast<i32>(validTiles.size());
         params.maxPolys = maximumPolys;
-        navMeshReady = dtStatusSucceed(navMesh->init(&params));
+        navMeshReady = dtStatusSucceed(_impl->navMesh->init(&params));
     }
 
     if (navMeshReady)
     {
-        for (u32 tileID = 0; tileID < tileData.size(); tileID++)
+        // Detour links the tiles in place, the bytes stay owned by this validator
+        for (TileData* tileData : validTiles)
         {
-            if (!tileData[tileID])
-                continue;
-
-            TileData& data = *tileData[tileID];
-            if (dtStatusFailed(navMesh->addTile(data.bytes.data(), static_cast<i32>(data.bytes.size()), 0, 0, nullptr)))
+            if (dtStatusFailed(_impl->navMesh->addTile(tileData->bytes.data(), static_cast<i32>(tileData->bytes.size()), 0, 0, nullptr)))
             {
-                const u32 chunkX = tileID % Terrain::CHUNK_NUM_PER_MAP_STRIDE;
-                const u32 chunkY = tileID / Terrain::CHUNK_NUM_PER_MAP_STRIDE;
+                const u32 chunkX = tileData->tileID % Terrain::CHUNK_NUM_PER_MAP_STRIDE;
+                const u32 chunkY = tileData->tileID / Terrain::CHUNK_NUM_PER_MAP_STRIDE;
                 NC_LOG_ERROR("[NavMesh Validator] Failed to add NavMesh tile ({}_{}_{})", mapName, chunkX, chunkY);
                 continue;
             }
 
-            loadedTiles[tileID] = true;
+            _impl->loadedTiles[tileData->tileID] = true;
+        }
+
+        _impl->queries.reserve(std::max(1u, numThreads));
+        for (u32 threadNum = 0; threadNum < std::max(1u, numThreads); threadNum++)
+        {
+            auto& query = _impl->queries.emplace_back(dtAllocNavMeshQuery(), &dtFreeNavMeshQuery);
+            if (query && dtStatusFailed(query->init(_impl->navMesh.get(), 64)))
+                query.reset();
         }
     }
 
-    dtNavMeshQuery query;
-    const bool queryReady = navMeshReady && dtStatusSucceed(query.init(navMesh.get(), 64));
-    dtQueryFilter filter;
-    filter.setIncludeFlags(WALKABLE_POLY_FLAG);
-    filter.setExcludeFlags(0);
+    _impl->filter.setIncludeFlags(NavMesh::WALKABLE_POLY_FLAG);
+    _impl->filter.setExcludeFlags(0);
 
     for (u32 tileID = 0; tileID < availableTiles.size(); tileID++)
     {
@@ -398,29 +390,76 @@ NavMesh::SeamValidationResult NavMesh::ValidateSeams(const std::filesystem::path
             if (!availableTiles[targetTileID])
                 continue;
 
-            result.adjacentPairs++;
-            const PairValidationResult pairResult =
-                queryReady && loadedTiles[tileID] && loadedTiles[targetTileID]
-                ? ValidatePair(*navMesh, query, filter, chunkX, chunkY, neighbor.targetX, neighbor.targetY, neighbor.sourceSide, neighbor.targetSide)
-                : PairValidationResult::Failed;
-            if (pairResult == PairValidationResult::Valid)
-            {
-                result.validatedPairs++;
-            }
-            else if (pairResult == PairValidationResult::NotTraversable)
-            {
-                result.skippedPairs++;
-            }
-            else
+            _impl->pairs.push_back({ tileID, targetTileID, neighbor.sourceSide, neighbor.targetSide });
+        }
+    }
+
+    _impl->pairResults.resize(_impl->pairs.size(), PairValidationResult::Failed);
+}
+
+NavMesh::SeamValidator::~SeamValidator() = default;
+
+u32 NavMesh::SeamValidator::GetNumPairs() const
+{
+    return static_cast<u32>(_impl->pairs.size());
+}
+
+void NavMesh::SeamValidator::ValidatePairs(u32 firstPair, u32 endPair, u32 threadNum)
+{
+    endPair = std::min(endPair, static_cast<u32>(_impl->pairs.size()));
+    dtNavMeshQuery* query = threadNum < _impl->queries.size() ? _impl->queries[threadNum].get() : nullptr;
+
+    for (u32 pairIndex = firstPair; pairIndex < endPair; pairIndex++)
+    {
+        const TilePair& pair = _impl->pairs[pairIndex];
+        if (!query || !_impl->loadedTiles[pair.sourceTileID] || !_impl->loadedTiles[pair.targetTileID])
+        {
+            _impl->pairResults[pairIndex] = PairValidationResult::Failed;
+            continue;
+        }
+
+        const u32 sourceX = pair.sourceTileID % Terrain::CHUNK_NUM_PER_MAP_STRIDE;
+        const u32 sourceY = pair.sourceTileID / Terrain::CHUNK_NUM_PER_MAP_STRIDE;
+        const u32 targetX = pair.targetTileID % Terrain::CHUNK_NUM_PER_MAP_STRIDE;
+        const u32 targetY = pair.targetTileID / Terrain::CHUNK_NUM_PER_MAP_STRIDE;
+        _impl->pairResults[pairIndex] = ValidatePair(*_impl->navMesh, *query, _impl->filter, sourceX, sourceY, targetX, targetY, pair.sourceSide, pair.targetSide);
+    }
+}
+
+NavMesh::SeamValidationResult NavMesh::SeamValidator::GetResult() const
+{
+    SeamValidationResult result;
+    result.adjacentPairs = static_cast<u32>(_impl->pairs.size());
+
+    for (u32 pairIndex = 0; pairIndex < _impl->pairs.size(); pairIndex++)
+    {
+        const PairValidationResult pairResult = _impl->pairResults[pairIndex];
+        if (pairResult == PairValidationResult::Valid)
+        {
+            result.validatedPairs++;
+        }
+        else if (pairResult == PairValidationResult::NotTraversable)
+        {
+            result.skippedPairs++;
+        }
+        else
+        {
+            result.failedPairs++;
+            if (result.failedPairs <= MAX_DETAILED_FAILURES)
             {
-                result.failedPairs++;
-                if (result.failedPairs <= MAX_DETAILED_FAILURES)
-                {
-                    NC_LOG_ERROR("[NavMesh Validator] Failed seam validation for {} tiles ({}_{} -> {}_{})", mapName, chunkX, chunkY, neighbor.targetX, neighbor.targetY);
-                }
+                const TilePair& pair = _impl->pairs[pairIndex];
+                NC_LOG_ERROR("[NavMesh Validator] Failed seam validation for {} tiles ({}_{} -> {}_{})", _impl->mapName,
+                    pair.sourceTileID % Terrain::CHUNK_NUM_PER_MAP_STRIDE, pair.sourceTileID / Terrain::CHUNK_NUM_PER_MAP_STRIDE,
+                    pair.targetTileID % Terrain::CHUNK_NUM_PER_MAP_STRIDE, pair.targetTileID / Terrain::CHUNK_NUM_PER_MAP_STRIDE);
             }
         }
     }
 
     return result;
 }
+
+const dtNavMesh* NavMesh::SeamValidator::GetNavMesh() const
+{
+    const bool hasLoadedTiles = std::any_of(_impl->loadedTiles.begin(), _impl->loadedTiles.end(), [](bool loaded) { return loaded; });
+    return hasLoadedTiles ? _impl->navMesh.get() : nullptr;
+}
@@ -2,10 +2,12 @@
 
 #include <Base/Types.h>
 
-#include <filesystem>
+#include <memory>
 #include <string>
 #include <vector>
 
+class dtNavMesh;
+
 namespace NavMesh
 {
     struct SeamValidationResult
@@ -16,5 +18,36 @@ namespace NavMesh
         u32 failedPairs = 0;
     };
 
-    SeamValidationResult ValidateSeams(const std::filesystem::path& outputDirectory, const std::string& mapName, const std::vector<u32>& tileIDs);
+    struct TileData
+    {
+        u32 tileID = 0;
+        std::vector<u8> bytes;
+    };
+
+    // Validates the seams between the tiles of one map. The tiles are taken straight from the build
+    // workers and added to one shared, read only dtNavMesh, ValidatePairs can then be called from any
+    // number of threads at once as long as every thread passes its own threadNum.
+    class SeamValidator
+    {
+    public:
+        SeamValidator(const std::string& mapName, std::vector<TileData>&& tiles, u32 numThreads);
+        ~SeamValidator();
+
+        SeamValidator(const SeamValidator&) = delete;
+        SeamValidator& operator=(const SeamValidator&) = delete;
+
+        u32 GetNumPairs() const;
+        void ValidatePairs(u32 firstPair, u32 endPair, u32 threadNum);
+
+        // Only valid once every pair has been validated
+        SeamValidationResult GetResult() const;
+
+        // The linked dtNavMesh of every loaded tile, nullptr when none could be loaded. It stays owned
+        // by the validator and is only read from, so other passes can share it.
+        const dtNavMesh* GetNavMesh() const;
+
+    private:
+        struct Impl;
+        std::unique_ptr<Impl> _impl;
+    };
 }
@@ -1,6 +1,8 @@
 #include "TextureExtractor.h"
+#include "DependencyResolver.h"
 #include "AssetConverter-App/Runtime.h"
 #include "AssetConverter-App/Blp/BlpConvert.h"
+#include "AssetConverter-App/Blp/DdsLayout.h"
 #include "AssetConverter-App/Casc/CascLoader.h"
 #include "AssetConverter-App/Util/ServiceLocator.h"
 
@@ -9,13 +11,61 @@
 
 #include <enkiTS/TaskScheduler.h>
 
+#include <algorithm>
+#include <array>
 #include <filesystem>
+#include <string_view>
 namespace fs = std::filesystem;
 
+namespace
+{
+    enum class OutputType
+    {
+        Texture,
+        MipStream,
+        LowTier
+    };
+
+    constexpr std::string_view TEXTURE_PATH_PREFIX = "texture/";
+    constexpr std::string_view LOW_TIER_PATH_PREFIX = "texturelow/";
+
+    std::string GetOutputPath(const std::string& texturePath, OutputType type)
+    {
+        switch (type)
+        {
+            case OutputType::MipStream:
+            {
+                fs::path mipStreamPath = texturePath;
+                mipStreamPath.replace_extension("mips");
+
+                std::string mipStreamPathStr = mipStreamPath.string();
+                std::replace(mipStreamPathStr.begin(), mipStreamPathStr.end(), '\\', '/');
+                return mipStreamPathStr;
+            }
+
+            case OutputType::LowTier:
+            {
+                if (!StringUtils::BeginsWith(texturePath, std::string(TEXTURE_PATH_PREFIX)))
+                    return std::string(LOW_TIER_PATH_PREFIX) + texturePath;
+
+                return std::string(LOW_TIER_PATH_PREFIX) + texturePath.substr(TEXTURE_PATH_PREFIX.size());
+            }
+
+            default: return texturePath;
+        }
+    }
+}
+
 void TextureExtractor::Process()
 {
     Runtime* runtime = ServiceLocator::GetRuntime();
     CascLoader* cascLoader = ServiceLocator::GetCascLoader(); 
+
+    const auto& textureConfig = runtime->json["Extraction"]["Texture"];
+    const bool splitMips = textureConfig.value("SplitMips", false);
+    const u32 mipTailSize = textureConfig.value("MipTailSize", 64u);
+    const bool generateLowTier = textureConfig.value("GenerateLowTier", false);
+    const u32 lowTierMaxSize = textureConfig.value("LowTierMaxSize", 512u);
     
     const CascListFile& listFile = cascLoader->GetListFile();
     const robin_hood::unordered_map<std::string, u32>& filePathToIDMap = listFile.GetFilePathToIDMap();
@@ -25,6 +75,7 @@ void TextureExtractor::Process()
         u32 fileID = 0;
         std::string fileName;
         std::string path;
+        std::array<u8, MD5_HASH_SIZE> contentKey = { };
 
         struct Flags
         {
@@ -35,6 +86,13 @@ void TextureExtractor::Process()
         Flags flags;
     };
 
+    // A unique (content, conversion settings) pair, converted once and aliased for every other path sharing it
+    struct ConversionEntry
+    {
+        u32 sourceIndex = 0;
+        std::vector<u32> aliasIndices;
+    };
+
     std::vector<FileListEntry> fileList = { };
     fileList.reserve(filePathToIDMap.size());
 
@@ -42,37 +100,156 @@ void TextureExtractor::Process()
     {
         if (!StringUtils::EndsWith(itr.first, ".blp"))
             continue;
-    
-        if (!cascLoader->InCascAndListFile(itr.second))
-            continue;
-    
+
         std::string pathStr = itr.first;
         std::transform(pathStr.begin(), pathStr.end(), pathStr.begin(), ::tolower);
+
+        if (!DependencyResolver::IsTextureReachable(itr.second, pathStr))
+            continue;
+
+        if (!cascLoader->InCascAndListFile(itr.second))
+            continue;
+
+        std::array<u8, MD5_HASH_SIZE> contentKey;
+        if (!cascLoader->GetFileContentKeyByID(itr.second, contentKey))
+            continue;
     
         fs::path outputPath = fs::path("texture") / pathStr;
         outputPath.replace_extension("dds");
 
+        std::string textureName = outputPath.string();
+        std::replace(textureName.begin(), textureName.end(), '\\', '/');
+
         FileListEntry& fileListEntry = fileList.emplace_back();
         fileListEntry.fileID = itr.second;
         fileListEntry.fileName = outputPath.filename().string();
-        fileListEntry.path = outputPath.string();
+        fileListEntry.path = textureName;
+        fileListEntry.contentKey = contentKey;
         fileListEntry.flags.isInterfaceFile = StringUtils::BeginsWith(pathStr, "interface");
         fileListEntry.flags.useCompression = !fileListEntry.flags.isInterfaceFile;
     }
 
+    // Group files by their CASC content key and conversion settings, ordered by path so the chosen source is deterministic
+    std::vector<u32> sortedIndices(fileList.size());
+    for (u32 i = 0; i < sortedIndices.size(); i++)
+        sortedIndices[i] = i;
+
+    auto GetFlagsKey = [](const FileListEntry& entry) -> u8
+    {
+        return static_cast<u8>(entry.flags.isInterfaceFile | (entry.flags.useCompression << 1));
+    };
+
+    std::sort(sortedIndices.begin(), sortedIndices.end(), [&](u32 a, u32 b)
+    {
+        const FileListEntry& entryA = fileList[a];
+        const FileListEntry& entryB = fileList[b];
+
+        if (entryA.contentKey != entryB.contentKey)
+            return entryA.contentKey < entryB.contentKey;
+
+        if (GetFlagsKey(entryA) != GetFlagsKey(entryB))
+            return GetFlagsKey(entryA) < GetFlagsKey(entryB);
+
+        return entryA.path < entryB.path;
+    });
+
+    std::vector<ConversionEntry> conversionList = { };
+    conversionList.reserve(fileList.size());
+
+    for (u32 index : sortedIndices)
+    {
+        const FileListEntry& fileListEntry = fileList[index];
+
+        if (!conversionList.empty())
+        {
+            ConversionEntry& previous = conversionList.back();
+            const FileListEntry& previousSource = fileList[previous.sourceIndex];
+
+            if (previousSource.contentKey == fileListEntry.contentKey && GetFlagsKey(previousSource) == GetFlagsKey(fileListEntry))
+            {
+                previous.aliasIndices.push_back(index);
+                continue;
+            }
+        }
+
+        ConversionEntry& conversionEntry = conversionList.emplace_back();
+        conversionEntry.sourceIndex = index;
+    }
+
     BLP::BlpConvert blpConvert;
-    u32 numFiles = static_cast<u32>(fileList.size());
+    u32 numFiles = static_cast<u32>(conversionList.size());
+    u32 numAliases = static_cast<u32>(fileList.size()) - numFiles;
     std::atomic<u32> numFilesConverted = 0;
     std::atomic<u16> progressFlags = 0;
-    NC_LOG_INFO("[Texture Extractor] Processing {0} files", numFiles);
+    NC_LOG_INFO("[Texture Extractor] Processing {0} files ({1} duplicates will be stored as aliases)", numFiles, numAliases);
+
+    struct StoredOutput
+    {
+        PactManifestInfo* manifest = nullptr;
+        u32 entryIndex = 0;
+    };
+
+    // Stores the data for the conversion source and aliases it for every duplicate of the source
+    auto AddOutput = [&](const ConversionEntry& conversionEntry, std::vector<u8>& bytes, OutputType type) -> StoredOutput
+    {
+        StoredOutput output;
+        const std::string path = GetOutputPath(fileList[conversionEntry.sourceIndex].path, type);
+
+        auto& manifest = runtime->pactInfo.GetManifestForFile(runtime, bytes.size());
+        if (!manifest.AddFile(runtime, path, bytes, nullptr, &output.entryIndex))
+        {
+            NC_LOG_WARNING("[Texture Extractor] Failed to add {0} to PACT storage", path);
+            return output;
+        }
+
+        output.manifest = &manifest;
+
+        for (u32 aliasIndex : conversionEntry.aliasIndices)
+        {
+            const std::string aliasPath = GetOutputPath(fileList[aliasIndex].path, type);
+            if (!manifest.AddAlias(runtime, aliasPath, output.entryIndex))
+            {
+                NC_LOG_WARNING("[Texture Extractor] Failed to add {0} to PACT storage", aliasPath);
+            }
+        }
+
+        return output;
+    };
+
+    // Stores an already added output under another output type for the conversion source and all of its duplicates
+    auto AddOutputAlias = [&](const ConversionEntry& conversionEntry, const StoredOutput& source, OutputType type)
+    {
+        if (!source.manifest)
+            return;
+
+        const std::string path = GetOutputPath(fileList[conversionEntry.sourceIndex].path, type);
+        if (!source.manifest->AddAlias(runtime, path, source.entryIndex))
+        {
+            NC_LOG_WARNING("[Texture Extractor] Failed to add {0} to PACT storage", path);
+        }
+
+        for (u32 aliasIndex : conversionEntry.aliasIndices)
+        {
+            const std::string aliasPath = GetOutputPath(fileList[aliasIndex].path, type);
+            if (!source.manifest->AddAlias(runtime, aliasPath, source.entryIndex))
+            {
+                NC_LOG_WARNING("[Texture Extractor] Failed to add {0} to PACT storage", aliasPath);
+            }
+        }
+    };
 
     enki::TaskSet convertTexturesTask(numFiles, [&](enki::TaskSetPartition range, uint32_t threadNum)
     {
         std::vector<u8> outBytes;
+        std::vector<u8> tailBytes;
+        std::vector<u8> streamBytes;
+        std::vector<u8> lowTierBytes;
+        BLP::DdsLayout ddsLayout;
 
         for (u32 i = range.start; i < range.end; i++)
         {
-            const FileListEntry& fileListEntry = fileList[i];
+            const ConversionEntry& conversionEntry = conversionList[i];
+            const FileListEntry& fileListEntry = fileList[conversionEntry.sourceIndex];
 
             std::shared_ptr<Bytebuffer> buffer = cascLoader->GetFileByID(fileListEntry.fileID);
             if (!buffer)
@@ -89,14 +266,72 @@ void TextureExtractor::Process()
                 outBytes.reserve(buffer->writtenData);
                 if (blpConvert.ConvertBLPToBuffer(buffer->GetDataPointer(), buffer->writtenData, outBytes, generateMips, useCompression, ivec2(256, 256)))
                 {
-                    std::string textureName = fileListEntry.path;
-                    std::transform(textureName.begin(), textureName.end(), textureName.begin(), ::tolower);
-                    std::replace(textureName.begin(), textureName.end(), '\\', '/');
+                    const bool hasLayout = (splitMips || generateLowTier) && ddsLayout.Parse(outBytes.data(), outBytes.size());
 
-                    auto& manifest = runtime->pactInfo.GetManifestForFile(runtime, outBytes.size());
-                    if (!manifest.AddFile(runtime, textureName, outBytes))
+                    // Split the high resolution mips into their own sidecar so the DDS itself only holds the mip tail
+                    u32 numStreamedMips = 0;
+                    if (splitMips && hasLayout)
                     {
-                        NC_LOG_WARNING("[Texture Extractor] Failed to add {0} to PACT storage", textureName);
+                        numStreamedMips = ddsLayout.GetFirstMipWithinSize(mipTailSize);
+                    }
+
+                    StoredOutput textureOutput;
+                    bool isTextureSplit = false;
+
+                    if (numStreamedMips > 0)
+                    {
+                        const u32 numTailMips = static_cast<u32>(ddsLayout.mips.size()) - numStreamedMips;
+
+                        if (ddsLayout.WriteMipStream(outBytes.data(), numStreamedMips, streamBytes) && ddsLayout.WriteMipRange(outBytes.data(), numStreamedMips, numTailMips, tailBytes))
+                        {
+                            textureOutput = AddOutput(conversionEntry, tailBytes, OutputType::Texture);
+                            AddOutput(conversionEntry, streamBytes, OutputType::MipStream);
+                            isTextureSplit = true;
+                        }
+                        else
+                        {
+                            NC_LOG_WARNING("[Texture Extractor] Failed to split the mips of {0}, storing it whole", fileListEntry.path);
+                            textureOutput = AddOutput(conversionEntry, outBytes, OutputType::Texture);
+                        }
+                    }
+                    else
+                    {
+                        textureOutput = AddOutput(conversionEntry, outBytes, OutputType::Texture);
+                    }
+
+                    // The low tier is sliced from the mip chain we already have, textures that already fit are aliased instead of stored twice
+                    if (generateLowTier)
+                    {
+                        const u32 firstLowTierMip = hasLayout ? ddsLayout.GetFirstMipWithinSize(lowTierMaxSize) : 0;
+
+                        if (firstLowTierMip == 0)
+                        {
+                            if (isTextureSplit)
+                            {
+                                AddOutput(conversionEntry, outBytes, OutputType::LowTier);
+                            }
+                            else
+                            {
+                                AddOutputAlias(conversionEntry, textureOutput, OutputType::LowTier);
+                            }
+                        }
+                        else if (isTextureSplit && firstLowTierMip == numStreamedMips)
+                        {
+                            AddOutputAlias(conversionEntry, textureOutput, OutputType::LowTier);
+                        }
+                        else
+                        {
+                            const u32 numLowTierMips = static_cast<u32>(ddsLayout.mips.size()) - firstLowTierMip;
+
+                            if (ddsLayout.WriteMipRange(outBytes.data(), firstLowTierMip, numLowTierMips, lowTierBytes))
+                            {
+                                AddOutput(conversionEntry, lowTierBytes, OutputType::LowTier);
+                            }
+                            else
+                            {
+                                NC_LOG_WARNING("[Texture Extractor] Failed to create the low tier of {0}", fileListEntry.path);
+                            }
+                        }
                     }
                 }
                 else
@@ -174,7 +174,7 @@ bool PactManifestInfo::Initialize(const u64 manifestID, const std::filesystem::p
     return true;
 }
 
-bool PactManifestInfo::AddFile(Runtime* runtime, const std::string& path, std::shared_ptr<Bytebuffer>& data, PACT::PactFileID* outFileID)
+bool PactManifestInfo::AddFile(Runtime* runtime, const std::string& path, std::shared_ptr<Bytebuffer>& data, PACT::PactFileID* outFileID, u32* outEntryIndex)
 {
     u64 hash = XXHash64::hash(path.c_str(), path.length(), 0);
 
@@ -211,6 +211,7 @@ bool PactManifestInfo::AddFile(Runtime* runtime, const std::string& path, std::s
         writtenData += data->writtenData;
     }
 
+    const u32 entryIndex = static_cast<u32>(manifest.entries.size());
     PACT::ManifestEntry& entry = manifest.entries.emplace_back();
     entry.fileID = fileID;
     entry.flags = {};
@@ -280,10 +281,13 @@ bool PactManifestInfo::AddFile(Runtime* runtime, const std::string& path, std::s
     if (outFileID)
         *outFileID = fileID;
 
+    if (outEntryIndex)
+        *outEntryIndex = entryIndex;
+
     return true;
 }
 
-bool PactManifestInfo::AddFile(Runtime* runtime, const std::string& path, std::vector<u8>& data, PACT::PactFileID* outFileID)
+bool PactManifestInfo::AddFile(Runtime* runtime, const std::string& path, std::vector<u8>& data, PACT::PactFileID* outFileID, u32* outEntryIndex)
 {
     u64 hash = XXHash64::hash(path.c_str(), path.length(), 0);
 
@@ -320,6 +324,7 @@ bool PactManifestInfo::AddFile(Runtime* runtime, const std::string& path, std::v
         writtenData += data.size();
     }
 
+    const u32 entryIndex = static_cast<u32>(manifest.entries.size());
     PACT::ManifestEntry& entry = manifest.entries.emplace_back();
     entry.fileID = fileID;
     entry.flags = {};
@@ -386,6 +391,50 @@ bool PactManifestInfo::AddFile(Runtime* runtime, const std::string& path, std::v
         crypto_hash_sha256(entry.contentDigest.data(), &emptyContent, 0);
     }
 
+    if (outFileID)
+        *outFileID = fileID;
+
+    if (outEntryIndex)
+        *outEntryIndex = entryIndex;
+
+    return true;
+}
+
+bool PactManifestInfo::AddAlias(Runtime* runtime, const std::string& path, u32 sourceEntryIndex, PACT::PactFileID* outFileID)
+{
+    u64 hash = XXHash64::hash(path.c_str(), path.length(), 0);
+
+    PACT::PactFileID fileID = 0;
+    if (!runtime->pactInfo.AddFile(hash, fileID))
+    {
+        runtime->pactInfo.MarkFailed();
+        NC_LOG_ERROR("PactBuilder : Duplicate file path (\"{0}\")", path);
+        return false;
+    }
+
+    std::scoped_lock lock(addFileMutex);
+    if (sourceEntryIndex >= manifest.entries.size())
+    {
+        runtime->pactInfo.RemoveFile(hash, fileID);
+        runtime->pactInfo.MarkFailed();
+        NC_LOG_ERROR("PactBuilder : Invalid alias source entry {0} for (\"{1}\")", sourceEntryIndex, path);
+        return false;
+    }
+
+    // Copy the source before emplacing, the emplace may reallocate the entries
+    const PACT::ManifestEntry sourceEntry = manifest.entries[sourceEntryIndex];
+
+    PACT::ManifestEntry& entry = manifest.entries.emplace_back();
+    entry.fileID = fileID;
+    entry.flags = sourceEntry.flags;
+    entry.pathIndex = manifest.stringTable.AddString(path);
+    entry.pathHash = hash;
+    entry.dataOffset = sourceEntry.dataOffset;
+    entry.dataSize = sourceEntry.dataSize;
+    entry.chunkIndex = sourceEntry.chunkIndex;
+    entry.chunkCount = sourceEntry.chunkCount;
+    entry.contentDigest = sourceEntry.contentDigest;
+
     if (outFileID)
         *outFileID = fileID;
 
@@ -24,8 +24,11 @@ public:
     PactManifestInfo() {}
 
     bool Initialize(const u64 manifestID, const std::filesystem::path& manifestPath, const std::filesystem::path& manifestDataPath, size_t entryCount);
-    bool AddFile(Runtime* runtime, const std::string& path, std::shared_ptr<Bytebuffer>& data, PACT::PactFileID* fileID = nullptr);
-    bool AddFile(Runtime* runtime, const std::string& path, std::vector<u8>& data, PACT::PactFileID* fileID = nullptr);
+    bool AddFile(Runtime* runtime, const std::string& path, std::shared_ptr<Bytebuffer>& data, PACT::PactFileID* fileID = nullptr, u32* entryIndex = nullptr);
+    bool AddFile(Runtime* runtime, const std::string& path, std::vector<u8>& data, PACT::PactFileID* fileID = nullptr, u32* entryIndex = nullptr);
+
+    // Adds a new path that shares the stored data, chunks and digest of an existing entry in this manifest
+    bool AddAlias(Runtime* runtime, const std::string& path, u32 sourceEntryIndex, PACT::PactFileID* fileID = nullptr);
 
     bool Finalize();
 
@@ -0,0 +1,50 @@
+#include "MapSelection.h"
+#include "AssetConverter-App/Runtime.h"
+#include "AssetConverter-App/Util/ServiceLocator.h"
+
+#include <Base/Util/StringUtils.h>
+
+#include <limits>
+
+MapSelection LoadMapSelection()
+{
+    Runtime* runtime = ServiceLocator::GetRuntime();
+    MapSelection selection;
+
+    const auto& extractionConfig = runtime->json["Extraction"];
+    if (!extractionConfig.contains("MapSelection"))
+        return selection;
+
+    const auto& mapSelectionConfig = extractionConfig["MapSelection"];
+    if (mapSelectionConfig.contains("IDs") && mapSelectionConfig["IDs"].is_array())
+    {
+        for (const auto& idValue : mapSelectionConfig["IDs"])
+        {
+            if (idValue.is_number_unsigned())
+            {
+                selection.ids.insert(idValue.get<u32>());
+            }
+            else if (idValue.is_number_integer())
+            {
+                const i64 signedID = idValue.get<i64>();
+                if (signedID >= 0 && signedID <= std::numeric_limits<u32>::max())
+                    selection.ids.insert(static_cast<u32>(signedID));
+            }
+        }
+    }
+
+    if (mapSelectionConfig.contains("InternalNames") && mapSelectionConfig["InternalNames"].is_array())
+    {
+        for (const auto& nameValue : mapSelectionConfig["InternalNames"])
+        {
+            if (!nameValue.is_string())
+                continue;
+
+            std::string internalName = nameValue.get<std::string>();
+            StringUtils::ToLower(internalName);
+            selection.internalNames.insert(std::move(internalName));
+        }
+    }
+
+    return selection;
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <Base/Types.h>
+
+#include <robinhood/robinhood.h>
+
+#include <string>
+
+struct MapSelection
+{
+public:
+    bool IsRestricted() const
+    {
+        return !ids.empty() || !internalNames.empty();
+    }
+
+    bool Contains(u32 id, const std::string& internalName) const
+    {
+        if (!IsRestricted())
+            return true;
+
+        return ids.contains(id) || internalNames.contains(internalName);
+    }
+
+public:
+    robin_hood::unordered_set<u32> ids;
+    robin_hood::unordered_set<std::string> internalNames;
+};
+
+// Reads Extraction.MapSelection from the config, an empty selection means every map is selected
+MapSelection LoadMapSelection();
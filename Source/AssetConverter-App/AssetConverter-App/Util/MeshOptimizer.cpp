@@ -0,0 +1,483 @@
+#include "MeshOptimizer.h"
+#include "AssetConverter-App/Runtime.h"
+#include "AssetConverter-App/Util/ServiceLocator.h"
+
+#include <Base/Util/DebugHandler.h>
+
+#include <FileFormat/Novus/Model/ComplexModel.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <type_traits>
+
+namespace
+{
+    constexpr u32 INVALID_ID = std::numeric_limits<u32>::max();
+
+    // Scoring constants from Tom Forsyth's "Linear-Speed Vertex Cache Optimisation", the cache being simulated is
+    // a 32 entry LRU which also produces good orders for the smaller FIFO caches the result is measured against
+    constexpr u32 SCORE_CACHE_SIZE = 32;
+    constexpr f32 CACHE_DECAY_POWER = 1.5f;
+    constexpr f32 LAST_TRIANGLE_SCORE = 0.75f;
+    constexpr f32 VALENCE_BOOST_SCALE = 2.0f;
+    constexpr f32 VALENCE_BOOST_POWER = 0.5f;
+
+    // Overdraw ordering may cost this much ACMR relative to the cache optimized order before it is rejected
+    constexpr f32 MAX_OVERDRAW_ACMR_INCREASE = 0.05f;
+
+    f32 GetVertexScore(i32 cachePosition, u32 remainingTriangles)
+    {
+        if (remainingTriangles == 0)
+            return -1.0f;
+
+        f32 score = 0.0f;
+        if (cachePosition >= 0)
+        {
+            // The vertices of the last triangle get a fixed score so the next triangle isn't biased towards any edge
+            if (cachePosition < 3)
+            {
+                score = LAST_TRIANGLE_SCORE;
+            }
+            else
+            {
+                const f32 scaler = 1.0f / static_cast<f32>(SCORE_CACHE_SIZE - 3);
+                score = std::pow(1.0f - static_cast<f32>(cachePosition - 3) * scaler, CACHE_DECAY_POWER);
+            }
+        }
+
+        // Vertices with few triangles left are preferred so they can leave the cache for good
+        score += VALENCE_BOOST_SCALE * std::pow(static_cast<f32>(remainingTriangles), -VALENCE_BOOST_POWER);
+        return score;
+    }
+
+    struct IndexRange
+    {
+    public:
+        u32 indexStart = 0;
+        u32 indexCount = 0;
+        u32 vertexStart = 0;
+        u32 vertexCount = 0;
+    };
+}
+
+u32 MeshOptimizer::CountCacheMisses(const u32* indices, u32 indexCount, u32 cacheSize)
+{
+    if (cacheSize == 0)
+        return indexCount;
+
+    std::vector<u32> cache(cacheSize);
+    u32 cacheHead = 0;
+    u32 numCached = 0;
+    u32 numMisses = 0;
+
+    for (u32 i = 0; i < indexCount; i++)
+    {
+        const u32 vertexID = indices[i];
+        if (std::find(cache.begin(), cache.begin() + numCached, vertexID) != cache.begin() + numCached)
+            continue;
+
+        cache[cacheHead] = vertexID;
+        cacheHead = (cacheHead + 1) % cacheSize;
+        numCached = std::min(numCached + 1, cacheSize);
+        numMisses++;
+    }
+
+    return numMisses;
+}
+
+void MeshOptimizer::OptimizeVertexCache(u32* indices, u32 indexCount)
+{
+    const u32 numTriangles = indexCount / 3;
+    if (numTriangles < 2)
+        return;
+
+    // Compact the vertex IDs so the per vertex state only covers the vertices this list references
+    std::vector<u32> uniqueVertexIDs(indices, indices + numTriangles * 3);
+    std::sort(uniqueVertexIDs.begin(), uniqueVertexIDs.end());
+    uniqueVertexIDs.erase(std::unique(uniqueVertexIDs.begin(), uniqueVertexIDs.end()), uniqueVertexIDs.end());
+
+    const u32 numVertices = static_cast<u32>(uniqueVertexIDs.size());
+    std::vector<u32> localIndices(numTriangles * 3);
+    for (u32 i = 0; i < numTriangles * 3; i++)
+    {
+        localIndices[i] = static_cast<u32>(std::lower_bound(uniqueVertexIDs.begin(), uniqueVertexIDs.end(), indices[i]) - uniqueVertexIDs.begin());
+    }
+
+    // Per vertex lists of the triangles not emitted yet, the live part of each list is [offset, offset + remaining)
+    std::vector<u32> remainingTriangles(numVertices, 0);
+    for (u32 vertexID : localIndices)
+    {
+        remainingTriangles[vertexID]++;
+    }
+
+    std::vector<u32> adjacencyOffsets(numVertices + 1, 0);
+    std::partial_sum(remainingTriangles.begin(), remainingTriangles.end(), adjacencyOffsets.begin() + 1);
+
+    std::vector<u32> adjacency(numTriangles * 3);
+    {
+        std::vector<u32> writeOffsets(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (u32 i = 0; i < numTriangles * 3; i++)
+        {
+            adjacency[writeOffsets[localIndices[i]]++] = i / 3;
+        }
+    }
+
+    std::vector<i32> cachePositions(numVertices, -1);
+    std::vector<f32> vertexScores(numVertices);
+    for (u32 vertexID = 0; vertexID < numVertices; vertexID++)
+    {
+        vertexScores[vertexID] = GetVertexScore(-1, remainingTriangles[vertexID]);
+    }
+
+    std::vector<f32> triangleScores(numTriangles);
+    for (u32 triangleID = 0; triangleID < numTriangles; triangleID++)
+    {
+        const u32* triangle = &localIndices[triangleID * 3];
+        triangleScores[triangleID] = vertexScores[triangle[0]] + vertexScores[triangle[1]] + vertexScores[triangle[2]];
+    }
+
+    std::vector<bool> isTriangleEmitted(numTriangles, false);
+    std::vector<u32> optimizedIndices;
+    optimizedIndices.reserve(numTriangles * 3);
+
+    std::array<u32, SCORE_CACHE_SIZE + 3> cache;
+    std::array<u32, SCORE_CACHE_SIZE + 3> nextCache;
+    u32 numCached = 0;
+
+    u32 bestTriangle = static_cast<u32>(std::max_element(triangleScores.begin(), triangleScores.end()) - triangleScores.begin());
+    u32 nextUnemittedTriangle = 0;
+
+    for (u32 numEmitted = 0; numEmitted < numTriangles; numEmitted++)
+    {
+        if (bestTriangle == INVALID_ID)
+        {
+            // None of the cached vertices have triangles left, continue with the next triangle in source order
+            while (isTriangleEmitted[nextUnemittedTriangle])
+            {
+                nextUnemittedTriangle++;
+            }
+
+            bestTriangle = nextUnemittedTriangle;
+        }
+
+        const u32 triangleID = bestTriangle;
+        const u32* triangle = &localIndices[triangleID * 3];
+        isTriangleEmitted[triangleID] = true;
+        optimizedIndices.insert(optimizedIndices.end(), indices + triangleID * 3, indices + triangleID * 3 + 3);
+
+        u32 numNextCached = 0;
+        for (u32 corner = 0; corner < 3; corner++)
+        {
+            const u32 vertexID = triangle[corner];
+
+            u32* triangles = &adjacency[adjacencyOffsets[vertexID]];
+            u32& numRemaining = remainingTriangles[vertexID];
+            u32* emitted = std::find(triangles, triangles + numRemaining, triangleID);
+            std::swap(*emitted, triangles[numRemaining - 1]);
+            numRemaining--;
+
+            // Degenerate triangles reference a vertex more than once, it only enters the cache once
+            if (std::find(nextCache.begin(), nextCache.begin() + numNextCached, vertexID) == nextCache.begin() + numNextCached)
+                nextCache[numNextCached++] = vertexID;
+        }
+
+        for (u32 i = 0; i < numCached; i++)
+        {
+            const u32 vertexID = cache[i];
+            if (vertexID != triangle[0] && vertexID != triangle[1] && vertexID != triangle[2])
+                nextCache[numNextCached++] = vertexID;
+        }
+
+        // Entries pushed past the end of the cache are evicted but still need their score lowered
+        for (u32 i = 0; i < numNextCached; i++)
+        {
+            const u32 vertexID = nextCache[i];
+            cachePositions[vertexID] = i < SCORE_CACHE_SIZE ? static_cast<i32>(i) : -1;
+
+            const f32 score = GetVertexScore(cachePositions[vertexID], remainingTriangles[vertexID]);
+            const f32 scoreDelta = score - vertexScores[vertexID];
+            vertexScores[vertexID] = score;
+
+            const u32* triangles = &adjacency[adjacencyOffsets[vertexID]];
+            for (u32 j = 0; j < remainingTriangles[vertexID]; j++)
+            {
+                triangleScores[triangles[j]] += scoreDelta;
+            }
+        }
+
+        numCached = std::min(numNextCached, SCORE_CACHE_SIZE);
+        std::copy(nextCache.begin(), nextCache.begin() + numCached, cache.begin());
+
+        // Only triangles touching the cache can score above the rest, so the search stays local
+        bestTriangle = INVALID_ID;
+        f32 bestScore = -std::numeric_limits<f32>::max();
+        for (u32 i = 0; i < numCached; i++)
+        {
+            const u32 vertexID = cache[i];
+            const u32* triangles = &adjacency[adjacencyOffsets[vertexID]];
+            for (u32 j = 0; j < remainingTriangles[vertexID]; j++)
+            {
+                const u32 candidate = triangles[j];
+                if (triangleScores[candidate] > bestScore)
+                {
+                    bestScore = triangleScores[candidate];
+                    bestTriangle = candidate;
+                }
+            }
+        }
+    }
+
+    std::copy(optimizedIndices.begin(), optimizedIndices.end(), indices);
+}
+
+void MeshOptimizer::OptimizeOverdraw(u32* indices, u32 indexCount, const std::vector<vec3>& positions, f32 maxACMRIncrease)
+{
+    const u32 numTriangles = indexCount / 3;
+    if (numTriangles < 2)
+        return;
+
+    for (u32 i = 0; i < numTriangles * 3; i++)
+    {
+        if (indices[i] >= positions.size())
+            return;
+    }
+
+    // A triangle missing the cache on all three vertices starts a new cluster, reordering whole clusters
+    // only costs the misses at the cluster boundaries
+    std::vector<u32> clusterStarts;
+    {
+        std::array<u32, FIFO_CACHE_SIZE> cache;
+        u32 cacheHead = 0;
+        u32 numCached = 0;
+
+        for (u32 triangleID = 0; triangleID < numTriangles; triangleID++)
+        {
+            u32 numMisses = 0;
+            for (u32 corner = 0; corner < 3; corner++)
+            {
+                const u32 vertexID = indices[triangleID * 3 + corner];
+                if (std::find(cache.begin(), cache.begin() + numCached, vertexID) != cache.begin() + numCached)
+                    continue;
+
+                cache[cacheHead] = vertexID;
+                cacheHead = (cacheHead + 1) % FIFO_CACHE_SIZE;
+                numCached = std::min(numCached + 1, FIFO_CACHE_SIZE);
+                numMisses++;
+            }
+
+            if (triangleID == 0 || numMisses == 3)
+                clusterStarts.push_back(triangleID);
+        }
+    }
+
+    const u32 numClusters = static_cast<u32>(clusterStarts.size());
+    if (numClusters < 2)
+        return;
+
+    clusterStarts.push_back(numTriangles);
+
+    struct Cluster
+    {
+    public:
+        vec3 centroid = vec3(0.0f);
+        vec3 normal = vec3(0.0f);
+        f32 area = 0.0f;
+        f32 sortKey = 0.0f;
+    };
+
+    std::vector<Cluster> clusters(numClusters);
+    vec3 meshCentroid = vec3(0.0f);
+    f32 meshArea = 0.0f;
+
+    for (u32 clusterID = 0; clusterID < numClusters; clusterID++)
+    {
+        Cluster& cluster = clusters[clusterID];
+        for (u32 triangleID = clusterStarts[clusterID]; triangleID < clusterStarts[clusterID + 1]; triangleID++)
+        {
+            const vec3& a = positions[indices[triangleID * 3 + 0]];
+            const vec3& b = positions[indices[triangleID * 3 + 1]];
+            const vec3& c = positions[indices[triangleID * 3 + 2]];
+
+            // The cross product is twice the area along the normal, so summing it weighs normals by area
+            const vec3 areaNormal = glm::cross(b - a, c - a);
+            const f32 area = glm::length(areaNormal) * 0.5f;
+            const vec3 triangleCentroid = (a + b + c) / 3.0f;
+
+            cluster.centroid += triangleCentroid * area;
+            cluster.normal += areaNormal;
+            cluster.area += area;
+        }
+
+        meshCentroid += cluster.centroid;
+        meshArea += cluster.area;
+
+        if (cluster.area > 0.0f)
+            cluster.centroid /= cluster.area;
+    }
+
+    if (meshArea <= 0.0f)
+        return;
+
+    meshCentroid /= meshArea;
+
+    // Clusters on the outside facing away from the center are the likeliest to occlude the rest, draw them first
+    for (Cluster& cluster : clusters)
+    {
+        const f32 normalLength = glm::length(cluster.normal);
+        cluster.sortKey = normalLength > 0.0f ? glm::dot(cluster.centroid - meshCentroid, cluster.normal / normalLength) : 0.0f;
+    }
+
+    std::vector<u32> clusterOrder(numClusters);
+    std::iota(clusterOrder.begin(), clusterOrder.end(), 0);
+    std::stable_sort(clusterOrder.begin(), clusterOrder.end(), [&clusters](u32 a, u32 b)
+    {
+        return clusters[a].sortKey > clusters[b].sortKey;
+    });
+
+    std::vector<u32> sortedIndices;
+    sortedIndices.reserve(numTriangles * 3);
+    for (u32 clusterID : clusterOrder)
+    {
+        sortedIndices.insert(sortedIndices.end(), indices + clusterStarts[clusterID] * 3, indices + clusterStarts[clusterID + 1] * 3);
+    }
+
+    const u32 missesBefore = CountCacheMisses(indices, numTriangles * 3);
+    const u32 missesAfter = CountCacheMisses(sortedIndices.data(), numTriangles * 3);
+    if (static_cast<f32>(missesAfter) > static_cast<f32>(missesBefore) * (1.0f + maxACMRIncrease))
+        return;
+
+    std::copy(sortedIndices.begin(), sortedIndices.end(), indices);
+}
+
+MeshOptimizer::ModelResult MeshOptimizer::OptimizeComplexModel(Model::ComplexModel& cmodel)
+{
+    ModelResult result;
+
+    auto& vertices = cmodel.vertices;
+    auto& indices = cmodel.modelData.indices;
+    using IndexType = std::decay_t<decltype(indices[0])>;
+
+    // Batches drawing the same index range (one per material or texture unit) are optimized once. Ranges that
+    // partially overlap another can't be reordered without breaking one of them, so the model is left as is.
+    std::vector<IndexRange> ranges;
+    bool hasSharedIndexRanges = false;
+    for (const auto& renderBatch : cmodel.modelData.renderBatches)
+    {
+        IndexRange range;
+        range.indexStart = renderBatch.indexStart;
+        range.indexCount = renderBatch.indexCount;
+        range.vertexStart = renderBatch.vertexStart;
+        range.vertexCount = renderBatch.vertexCount;
+
+        const bool isValid = range.indexCount >= 3 && range.indexCount % 3 == 0 &&
+                             static_cast<size_t>(range.indexStart) + range.indexCount <= indices.size() &&
+                             static_cast<size_t>(range.vertexStart) + range.vertexCount <= vertices.size();
+        if (!isValid)
+            continue;
+
+        auto duplicate = std::find_if(ranges.begin(), ranges.end(), [&range](const IndexRange& other)
+        {
+            return other.indexStart == range.indexStart && other.indexCount == range.indexCount;
+        });
+
+        if (duplicate != ranges.end())
+        {
+            if (duplicate->vertexStart != range.vertexStart || duplicate->vertexCount != range.vertexCount)
+                hasSharedIndexRanges = true;
+
+            continue;
+        }
+
+        ranges.push_back(range);
+    }
+
+    std::sort(ranges.begin(), ranges.end(), [](const IndexRange& a, const IndexRange& b) { return a.indexStart < b.indexStart; });
+    for (u32 i = 1; i < ranges.size(); i++)
+    {
+        if (ranges[i - 1].indexStart + ranges[i - 1].indexCount > ranges[i].indexStart)
+            return result;
+    }
+
+    // ComplexModel::FromM2 and FromMapObject don't define whether batch indices are absolute or relative to the
+    // batch's vertexStart. The cache reorder is the same either way, the overdraw pass needs positions and only
+    // runs when the indices of every batch fit exactly one of the two readings and no index range is drawn with
+    // two different vertex ranges.
+    bool isAbsolute = true;
+    bool isRelative = true;
+    for (const IndexRange& range : ranges)
+    {
+        for (u32 i = range.indexStart; i < range.indexStart + range.indexCount; i++)
+        {
+            const u32 index = static_cast<u32>(indices[i]);
+            isAbsolute &= index >= range.vertexStart && index < range.vertexStart + range.vertexCount;
+            isRelative &= index < range.vertexCount;
+        }
+    }
+
+    const bool hasKnownVertices = isAbsolute != isRelative && !hasSharedIndexRanges;
+    std::vector<vec3> positions;
+    if (hasKnownVertices)
+    {
+        positions.resize(vertices.size());
+        for (u32 i = 0; i < vertices.size(); i++)
+        {
+            positions[i] = vertices[i].position;
+        }
+    }
+
+    std::vector<u32> scratch;
+    for (const IndexRange& range : ranges)
+    {
+        const u32 indexBase = isRelative && hasKnownVertices ? range.vertexStart : 0;
+        scratch.resize(range.indexCount);
+        for (u32 i = 0; i < range.indexCount; i++)
+        {
+            scratch[i] = static_cast<u32>(indices[range.indexStart + i]) + indexBase;
+        }
+
+        const u32 missesBefore = CountCacheMisses(scratch.data(), range.indexCount);
+        result.numTriangles += range.indexCount / 3;
+        result.cacheMissesBefore += missesBefore;
+
+        OptimizeVertexCache(scratch.data(), range.indexCount);
+        if (hasKnownVertices)
+            OptimizeOverdraw(scratch.data(), range.indexCount, positions, MAX_OVERDRAW_ACMR_INCREASE);
+
+        // Keep the source order for the rare list the optimizer can't improve on
+        const u32 missesAfter = CountCacheMisses(scratch.data(), range.indexCount);
+        if (missesAfter > missesBefore)
+        {
+            result.cacheMissesAfter += missesBefore;
+            continue;
+        }
+
+        result.cacheMissesAfter += missesAfter;
+        for (u32 i = 0; i < range.indexCount; i++)
+        {
+            indices[range.indexStart + i] = static_cast<IndexType>(scratch[i] - indexBase);
+        }
+    }
+
+    return result;
+}
+
+void MeshOptimizer::Optimize(Model::ComplexModel& cmodel, const std::string& name, const std::string& logPrefix, Statistics& statistics)
+{
+    const ModelResult result = OptimizeComplexModel(cmodel);
+    statistics.Add(result);
+
+    Runtime* runtime = ServiceLocator::GetRuntime();
+    if (runtime->isInDebugMode && result.numTriangles > 0)
+    {
+        const f64 numTriangles = static_cast<f64>(result.numTriangles);
+        NC_LOG_INFO("[{0}] Optimized {1} (ACMR {2:.3f} -> {3:.3f})", logPrefix, name, result.cacheMissesBefore / numTriangles, result.cacheMissesAfter / numTriangles);
+    }
+}
+
+void MeshOptimizer::LogStatistics(const std::string& logPrefix, const Statistics& statistics)
+{
+    NC_LOG_INFO("[{0}] Optimized {1} models, {2} triangles (ACMR {3:.3f} -> {4:.3f})", logPrefix, statistics.numModels.load(), statistics.numTriangles.load(), statistics.GetACMRBefore(), statistics.GetACMRAfter());
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <Base/Types.h>
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+namespace Model
+{
+    struct ComplexModel;
+}
+
+namespace MeshOptimizer
+{
+    // ACMR is measured against a FIFO cache of this size, close to what current GPUs reuse
+    constexpr u32 FIFO_CACHE_SIZE = 16;
+
+    struct ModelResult
+    {
+    public:
+        u32 numTriangles = 0;
+        u32 cacheMissesBefore = 0;
+        u32 cacheMissesAfter = 0;
+    };
+
+    // Totals over every model an extractor optimized, safe to add to from any thread
+    struct Statistics
+    {
+    public:
+        void Add(const ModelResult& result)
+        {
+            numModels.fetch_add(1, std::memory_order_relaxed);
+            numTriangles.fetch_add(result.numTriangles, std::memory_order_relaxed);
+            cacheMissesBefore.fetch_add(result.cacheMissesBefore, std::memory_order_relaxed);
+            cacheMissesAfter.fetch_add(result.cacheMissesAfter, std::memory_order_relaxed);
+        }
+
+        f64 GetACMRBefore() const
+        {
+            const u64 triangles = numTriangles.load(std::memory_order_relaxed);
+            return triangles > 0 ? static_cast<f64>(cacheMissesBefore.load(std::memory_order_relaxed)) / static_cast<f64>(triangles) : 0.0;
+        }
+
+        f64 GetACMRAfter() const
+        {
+            const u64 triangles = numTriangles.load(std::memory_order_relaxed);
+            return triangles > 0 ? static_cast<f64>(cacheMissesAfter.load(std::memory_order_relaxed)) / static_cast<f64>(triangles) : 0.0;
+        }
+
+    public:
+        std::atomic<u64> numModels = 0;
+        std::atomic<u64> numTriangles = 0;
+        std::atomic<u64> cacheMissesBefore = 0;
+        std::atomic<u64> cacheMissesAfter = 0;
+    };
+
+    // Indices only need to identify vertices, the triangles keep their winding
+    u32 CountCacheMisses(const u32* indices, u32 indexCount, u32 cacheSize = FIFO_CACHE_SIZE);
+    void OptimizeVertexCache(u32* indices, u32 indexCount);
+
+    // Reorders the clusters a cache optimized list naturally splits into so triangles facing outwards from the
+    // mesh center are drawn first. positions is indexed by the index values.
+    void OptimizeOverdraw(u32* indices, u32 indexCount, const std::vector<vec3>& positions, f32 maxACMRIncrease);
+
+    // Reorders the triangles of every render batch, batches sharing an index range are optimized together.
+    // Only the index buffer is rewritten, the vertices and every other per vertex stream keep their order.
+    ModelResult OptimizeComplexModel(Model::ComplexModel& cmodel);
+
+    // Shared by the extractors, logPrefix is the tag their log lines start with. Optimize adds the model to
+    // statistics and logs its ACMR in debug mode, LogStatistics logs the totals once every model is done.
+    void Optimize(Model::ComplexModel& cmodel, const std::string& name, const std::string& logPrefix, Statistics& statistics);
+    void LogStatistics(const std::string& logPrefix, const Statistics& statistics);
+}
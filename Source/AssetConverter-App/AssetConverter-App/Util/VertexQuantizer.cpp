@@ -0,0 +1,197 @@
+#include "VertexQuantizer.h"
+#include "AssetConverter-App/Runtime.h"
+#include "AssetConverter-App/Util/ServiceLocator.h"
+
+#include <Base/Util/DebugHandler.h>
+
+#include <FileFormat/Novus/Model/ComplexModel.h>
+
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+
+namespace
+{
+    constexpr f32 MAX_UNORM16 = static_cast<f32>(std::numeric_limits<u16>::max());
+    constexpr f32 MAX_SNORM16 = static_cast<f32>(std::numeric_limits<i16>::max());
+    constexpr f32 RADIANS_TO_DEGREES = 57.29577951308232f;
+
+    f32 SignNotZero(f32 value)
+    {
+        return value >= 0.0f ? 1.0f : -1.0f;
+    }
+
+    void EncodeOctahedral(const vec3& normal, i16* octNormal)
+    {
+        // Project onto the octahedron, the lower hemisphere is folded over the diagonals
+        const f32 inverseNorm = 1.0f / (std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z));
+        f32 x = normal.x * inverseNorm;
+        f32 y = normal.y * inverseNorm;
+
+        if (normal.z < 0.0f)
+        {
+            const f32 foldedX = (1.0f - std::abs(y)) * SignNotZero(x);
+            const f32 foldedY = (1.0f - std::abs(x)) * SignNotZero(y);
+            x = foldedX;
+            y = foldedY;
+        }
+
+        octNormal[0] = static_cast<i16>(std::round(std::clamp(x, -1.0f, 1.0f) * MAX_SNORM16));
+        octNormal[1] = static_cast<i16>(std::round(std::clamp(y, -1.0f, 1.0f) * MAX_SNORM16));
+    }
+
+    vec3 DecodeOctahedral(const i16* octNormal)
+    {
+        const f32 x = std::max(static_cast<f32>(octNormal[0]) / MAX_SNORM16, -1.0f);
+        const f32 y = std::max(static_cast<f32>(octNormal[1]) / MAX_SNORM16, -1.0f);
+
+        vec3 normal = vec3(x, y, 1.0f - std::abs(x) - std::abs(y));
+        if (normal.z < 0.0f)
+        {
+            normal.x = (1.0f - std::abs(y)) * SignNotZero(x);
+            normal.y = (1.0f - std::abs(x)) * SignNotZero(y);
+        }
+
+        return glm::normalize(normal);
+    }
+}
+
+bool VertexQuantizer::CreateVertexData(const Model::ComplexModel& cmodel, const Tolerances& tolerances, std::vector<u8>& vertexData, PrecisionReport& report)
+{
+    const auto& vertices = cmodel.vertices;
+
+    report = { };
+    report.vertexCount = static_cast<u32>(vertices.size());
+    if (vertices.empty())
+        return false;
+
+    Header header;
+    header.vertexCount = report.vertexCount;
+
+    vec3 boundsMin = vertices[0].position;
+    vec3 boundsMax = vertices[0].position;
+    for (const auto& vertex : vertices)
+    {
+        boundsMin = glm::min(boundsMin, vertex.position);
+        boundsMax = glm::max(boundsMax, vertex.position);
+    }
+
+    for (u32 axis = 0; axis < 3; axis++)
+    {
+        header.boundsMin[axis] = boundsMin[axis];
+        header.boundsScale[axis] = (boundsMax[axis] - boundsMin[axis]) / MAX_UNORM16;
+    }
+
+    std::vector<CompactVertex> compactVertices(vertices.size());
+    for (u32 vertexIndex = 0; vertexIndex < vertices.size(); vertexIndex++)
+    {
+        const auto& vertex = vertices[vertexIndex];
+        CompactVertex& compactVertex = compactVertices[vertexIndex];
+
+        for (u32 axis = 0; axis < 3; axis++)
+        {
+            const f32 scale = header.boundsScale[axis];
+            const f32 quantized = scale > 0.0f ? std::round((vertex.position[axis] - header.boundsMin[axis]) / scale) : 0.0f;
+            compactVertex.position[axis] = static_cast<u16>(std::clamp(quantized, 0.0f, MAX_UNORM16));
+
+            const f32 decoded = header.boundsMin[axis] + static_cast<f32>(compactVertex.position[axis]) * scale;
+            report.maxPositionError = std::max(report.maxPositionError, std::abs(decoded - vertex.position[axis]));
+        }
+
+        // Zero length normals stay zero in the source and have no direction to lose
+        const f32 normalLength = glm::length(vertex.normal);
+        if (normalLength > 0.0f)
+        {
+            const vec3 normal = vertex.normal / normalLength;
+            EncodeOctahedral(normal, compactVertex.octNormal);
+
+            const f32 cosAngle = std::clamp(glm::dot(normal, DecodeOctahedral(compactVertex.octNormal)), -1.0f, 1.0f);
+            report.maxNormalErrorDegrees = std::max(report.maxNormalErrorDegrees, std::acos(cosAngle) * RADIANS_TO_DEGREES);
+        }
+
+        for (u32 uvSet = 0; uvSet < UV_SET_COUNT; uvSet++)
+        {
+            for (u32 component = 0; component < 2; component++)
+            {
+                const f32 uv = vertex.uvCoords[uvSet][component];
+                const u16 packed = glm::packHalf1x16(uv);
+                compactVertex.uvCoords[uvSet * 2 + component] = packed;
+
+                // Values outside the half float range decode to infinity and fail the tolerance below
+                const f32 error = std::abs(glm::unpackHalf1x16(packed) - uv);
+                report.maxUVError = std::max(report.maxUVError, std::isnan(error) ? std::numeric_limits<f32>::infinity() : error);
+            }
+        }
+    }
+
+    report.requiresFullFormat = !(report.maxPositionError <= tolerances.maxPositionError &&
+                                  report.maxNormalErrorDegrees <= tolerances.maxNormalErrorDegrees &&
+                                  report.maxUVError <= tolerances.maxUVError);
+    if (report.requiresFullFormat)
+        return false;
+
+    const size_t verticesSize = compactVertices.size() * sizeof(CompactVertex);
+    vertexData.resize(sizeof(Header) + verticesSize);
+    std::memcpy(vertexData.data(), &header, sizeof(Header));
+    std::memcpy(vertexData.data() + sizeof(Header), compactVertices.data(), verticesSize);
+
+    return true;
+}
+
+bool VertexQuantizer::LoadTolerances(const std::string& configName, Tolerances& tolerances)
+{
+    Runtime* runtime = ServiceLocator::GetRuntime();
+
+    const auto& extractionConfig = runtime->json["Extraction"];
+    if (!extractionConfig.contains(configName) || !extractionConfig[configName].contains("CompactVertices"))
+        return false;
+
+    const auto& compactVerticesConfig = extractionConfig[configName]["CompactVertices"];
+    tolerances.maxPositionError = compactVerticesConfig.value("MaxPositionError", tolerances.maxPositionError);
+    tolerances.maxNormalErrorDegrees = compactVerticesConfig.value("MaxNormalErrorDegrees", tolerances.maxNormalErrorDegrees);
+    tolerances.maxUVError = compactVerticesConfig.value("MaxUVError", tolerances.maxUVError);
+
+    return compactVerticesConfig.value("Enabled", false);
+}
+
+void VertexQuantizer::SaveCompactVertices(const Model::ComplexModel& cmodel, const Tolerances& tolerances, const std::string& path, const std::string& logPrefix, Statistics& statistics)
+{
+    std::vector<u8> vertexData;
+    PrecisionReport report;
+    const bool quantized = CreateVertexData(cmodel, tolerances, vertexData, report);
+    if (report.vertexCount == 0)
+        return;
+
+    statistics.Add(report);
+    if (!quantized)
+    {
+        NC_LOG_WARNING("[{0}] {1} requires full precision vertices (Position Error: {2:.5f}, Normal Error: {3:.3f} degrees, UV Error: {4:.6f})", logPrefix, path, report.maxPositionError, report.maxNormalErrorDegrees, report.maxUVError);
+        return;
+    }
+
+    std::filesystem::path vertexPath = path;
+    vertexPath.replace_extension(FILE_EXTENSION);
+
+    Runtime* runtime = ServiceLocator::GetRuntime();
+    auto& manifest = runtime->pactInfo.GetManifestForFile(runtime, vertexData.size());
+    if (!manifest.AddFile(runtime, vertexPath.generic_string(), vertexData))
+    {
+        NC_LOG_WARNING("[{0}] Failed to add {1} to PACT storage", logPrefix, vertexPath.generic_string());
+        return;
+    }
+
+    if (runtime->isInDebugMode)
+    {
+        NC_LOG_INFO("[{0}] Quantized {1} (Position Error: {2:.5f}, Normal Error: {3:.3f} degrees, UV Error: {4:.6f})", logPrefix, path, report.maxPositionError, report.maxNormalErrorDegrees, report.maxUVError);
+    }
+}
+
+void VertexQuantizer::LogStatistics(const std::string& logPrefix, const Statistics& statistics)
+{
+    const u64 numFullFormat = statistics.numFullFormat.load();
+    NC_LOG_INFO("[{0}] Quantized vertices of {1} models ({2} -> {3} bytes), {4} models require full precision", logPrefix, statistics.numModels.load() - numFullFormat, statistics.fullVertexBytes.load(), statistics.compactVertexBytes.load(), numFullFormat);
+}
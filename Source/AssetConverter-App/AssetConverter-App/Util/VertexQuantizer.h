@@ -0,0 +1,103 @@
+#pragma once
+#include <Base/Types.h>
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+namespace Model
+{
+    struct ComplexModel;
+}
+
+namespace VertexQuantizer
+{
+    // Compact copy of a ComplexModel's vertex stream, stored next to the model and in the same vertex order.
+    // Bone data stays in the model, only the position, normal and UV channels are replaced.
+    constexpr u32 MAGIC = 0x5856434E; // "NCVX"
+    constexpr u32 VERSION = 1;
+    constexpr const char* FILE_EXTENSION = ".cmvtx";
+    constexpr u32 UV_SET_COUNT = 2;
+
+    // A position decodes to boundsMin + value * boundsScale per axis
+    struct Header
+    {
+        u32 magic = MAGIC;
+        u32 version = VERSION;
+        u32 headerSize = sizeof(Header);
+        u32 vertexCount = 0;
+        u32 uvSetCount = UV_SET_COUNT;
+        u32 reserved = 0;
+        f32 boundsMin[3] = { 0.0f, 0.0f, 0.0f };
+        f32 boundsScale[3] = { 0.0f, 0.0f, 0.0f };
+    };
+    static_assert(sizeof(Header) == 48);
+
+    // Positions are unorm16 against the model bounds, normals octahedral snorm16 and UVs half floats
+    struct CompactVertex
+    {
+        u16 position[3] = { 0, 0, 0 };
+        u16 padding = 0;
+        i16 octNormal[2] = { 0, 0 };
+        u16 uvCoords[UV_SET_COUNT * 2] = { 0, 0, 0, 0 };
+    };
+    static_assert(sizeof(CompactVertex) == 20);
+
+    // Size of the channels a CompactVertex replaces in the full precision vertex
+    constexpr u32 FULL_VERTEX_SIZE = sizeof(f32) * (3 + 3 + UV_SET_COUNT * 2);
+
+    // Position error is in world units, normal error in degrees and UV error in texture coordinate units
+    struct Tolerances
+    {
+    public:
+        f32 maxPositionError = 0.005f;
+        f32 maxNormalErrorDegrees = 0.5f;
+        f32 maxUVError = 1.0f / 2048.0f;
+    };
+
+    // Largest round trip error over all vertices of a model, requiresFullFormat is set when any channel exceeds its tolerance
+    struct PrecisionReport
+    {
+    public:
+        u32 vertexCount = 0;
+        f32 maxPositionError = 0.0f;
+        f32 maxNormalErrorDegrees = 0.0f;
+        f32 maxUVError = 0.0f;
+        bool requiresFullFormat = false;
+    };
+
+    // Totals over every model an extractor quantized, safe to add to from any thread
+    struct Statistics
+    {
+    public:
+        void Add(const PrecisionReport& report)
+        {
+            numModels.fetch_add(1, std::memory_order_relaxed);
+            if (report.requiresFullFormat)
+            {
+                numFullFormat.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+
+            fullVertexBytes.fetch_add(static_cast<u64>(report.vertexCount) * FULL_VERTEX_SIZE, std::memory_order_relaxed);
+            compactVertexBytes.fetch_add(static_cast<u64>(report.vertexCount) * sizeof(CompactVertex), std::memory_order_relaxed);
+        }
+
+    public:
+        std::atomic<u64> numModels = 0;
+        std::atomic<u64> numFullFormat = 0;
+        std::atomic<u64> fullVertexBytes = 0;
+        std::atomic<u64> compactVertexBytes = 0;
+    };
+
+    // Fills the report for every model, vertexData is only written when the model fits within the tolerances
+    bool CreateVertexData(const Model::ComplexModel& cmodel, const Tolerances& tolerances, std::vector<u8>& vertexData, PrecisionReport& report);
+
+    // Shared by the extractors, logPrefix is the tag their log lines start with.
+    // LoadTolerances reads the CompactVertices object of Extraction.<configName> and returns whether it is enabled
+    bool LoadTolerances(const std::string& configName, Tolerances& tolerances);
+
+    // Adds the model to statistics and stores its compact vertex stream next to path when it fits within the tolerances
+    void SaveCompactVertices(const Model::ComplexModel& cmodel, const Tolerances& tolerances, const std::string& path, const std::string& logPrefix, Statistics& statistics);
+    void LogStatistics(const std::string& logPrefix, const Statistics& statistics);
+}
@@ -1,6 +1,7 @@
 #include "Runtime.h"
 #include "Casc/CascLoader.h"
 #include "Extractors/ClientDBExtractor.h"
+#include "Extractors/DependencyResolver.h"
 #include "Extractors/MapExtractor.h"
 #include "Extractors/MapObjectExtractor.h"
 #include "Extractors/ComplexModelExtractor.h"
@@ -121,6 +122,7 @@ i32 main()
     bool isMapObjectEnabled = false;
     bool isComplexModelEnabled = false;
     bool isTextureEnabled = false;
+    bool isDependencyPruningEnabled = false;
     bool rebuildPact = false;
 
     // Setup Runtime
@@ -176,6 +178,7 @@ i32 main()
             isMapObjectEnabled = runtime->json["Extraction"]["MapObject"]["Enabled"];
             isComplexModelEnabled = runtime->json["Extraction"]["ComplexModel"]["Enabled"];
             isTextureEnabled = runtime->json["Extraction"]["Texture"]["Enabled"];
+            isDependencyPruningEnabled = runtime->json["Extraction"].contains("DependencyPruning") && runtime->json["Extraction"]["DependencyPruning"].value("Enabled", false);
             rebuildPact = isExtractingEnabled && (isDB2Enabled || isMapEnabled || isMapObjectEnabled || isComplexModelEnabled || isTextureEnabled);
         }
 
@@ -250,6 +253,20 @@ i32 main()
                         }
                     }
 
+                    // Dependency Pruning
+                    if (isDependencyPruningEnabled && (isMapObjectEnabled || isComplexModelEnabled || isTextureEnabled))
+                    {
+                        if (!mapDataAvailable)
+                            mapDataAvailable = ClientDBExtractor::LoadMapStorage(false);
+
+                        if (mapDataAvailable)
+                        {
+                            NC_LOG_INFO("[AssetConverter] Processing Dependency Resolver...");
+                            DependencyResolver::Process();
+                            NC_LOG_INFO("[AssetConverter] Dependency Resolver Finished\n");
+                        }
+                    }
+
                     // Map / NavMesh
                     if ((isMapEnabled || isNavMeshEnabled) && mapDataAvailable)
                     {